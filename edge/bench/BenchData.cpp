@@ -0,0 +1,62 @@
+#include "BenchData.h"
+
+/**
+ * @brief Get a sample of a pump cycle, values change slowly like the ones of the sensors
+ * @param i index of the sample, its time is SAMPLE_PERIOD seconds after the previous one
+ * @return sample
+ */
+sensor_data_t benchSample(size_t i) {
+    sensor_data_t data;
+    data.timestamp = TimeManager::fromEpoch((time_t)(SAMPLE_EPOCH + i * SAMPLE_PERIOD));
+    data.flow = (i / 60) % 2 == 0 ? 0 : 120 + (int)(i % 7); // pump runs every other five minutes
+    data.pressure = 1800 + (int)(i % 23);
+    data.level = 2400 - (int)((i / 12) % 400);
+    return data;
+}
+
+/**
+ * @brief Clears the data file and stores the given number of samples like the storage task does
+ * @param num number of samples
+ * @return true on success, false otherwise
+ */
+bool fillDataFile(size_t num) {
+    if(!DataFile.clear()) {
+        return false;
+    }
+    for(size_t i = 0; i < num; i++) {
+        if(!DataFile.store(benchSample(i)) || !DataFile.persist(0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Clears the log file and logs the given number of messages, appended to the file afterwards
+ * @param num number of messages
+ * @return true on success, false otherwise
+ */
+bool fillLogFile(size_t num) {
+    if(!LogFile.clear()) {
+        return false;
+    }
+    for(size_t i = 0; i < num; i++) {
+        if(!LogFile.log(INFO, LOG_FREE_HEAP, {(int32_t)(100000 + i)})) { // distinct arguments, not rate limited
+            return false;
+        }
+        if((i + 1) % (LOG_RING_SIZE / 2) == 0 && !LogFile.persist(0)) {
+            return false;
+        }
+    }
+    return LogFile.persist(0) && LogFile.flush();
+}
+
+/**
+ * @brief Get a line of a text file, like the CSV data file of previous firmware versions
+ * @param i index of the line
+ * @return line, without line break
+ */
+std::string benchLine(size_t i) {
+    sensor_data_t data = benchSample(i);
+    return TimeManager::toString(data.timestamp) + "," + std::to_string(data.flow) + "," + std::to_string(data.pressure) + "," + std::to_string(data.level);
+}
@@ -0,0 +1,21 @@
+#ifndef BENCH_DATA_H
+#define BENCH_DATA_H
+
+#include <string>
+#include <vector>
+#include "DataFile.h"
+#include "LogFile.h"
+
+// Workload:
+#define SYNC_BATCH_SIZE 180 // samples per request, like BATCH_SIZE of the sync task
+#define LOG_BATCH_SIZE 20 // messages per request, like the logs reserved by the sync task
+#define SAMPLE_PERIOD 5 // seconds between samples
+#define DAY_SAMPLES (24 * 60 * 60 / SAMPLE_PERIOD) // samples of one day, the backlog of a device offline for a day
+#define SAMPLE_EPOCH 1725926400 // time of the first sample (2024-09-10T00:00:00)
+
+sensor_data_t benchSample(size_t i);
+bool fillDataFile(size_t num);
+bool fillLogFile(size_t num);
+std::string benchLine(size_t i);
+
+#endif /* BENCH_DATA_H */
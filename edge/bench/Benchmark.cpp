@@ -0,0 +1,273 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <regex>
+
+#define BENCHMARK_DEFAULT_MIN_TIME 0.5 // seconds each benchmark runs at least
+#define BENCHMARK_MAX_ITERATIONS 1000000000 // upper bound of the iterations grown
+
+namespace benchmark {
+
+static std::vector<internal::Benchmark*>& benchmarks() {
+    static std::vector<internal::Benchmark*> registered;
+    return registered;
+}
+
+static std::string filter = "."; // regular expression of the benchmarks to run
+static double minTime = BENCHMARK_DEFAULT_MIN_TIME;
+static bool listOnly = false;
+
+// State:
+
+State::State(IterationCount iterations, const std::vector<int64_t>& args) : max(iterations), args(args), elapsed(0), running(false), bytes(0), items(0) {}
+
+State::Iterator State::begin() {
+    this->start();
+    return Iterator(this, this->max);
+}
+
+State::Iterator State::end() {
+    return Iterator(this, 0);
+}
+
+int64_t State::range(size_t index) const {
+    return index < this->args.size() ? this->args[index] : 0;
+}
+
+IterationCount State::iterations() const {
+    return this->max;
+}
+
+void State::PauseTiming() {
+    if(this->running) {
+        this->elapsed += std::chrono::steady_clock::now() - this->started;
+        this->running = false;
+    }
+}
+
+void State::ResumeTiming() {
+    this->start();
+}
+
+void State::SetBytesProcessed(int64_t bytes) {
+    this->bytes = bytes;
+}
+
+void State::SetItemsProcessed(int64_t items) {
+    this->items = items;
+}
+
+void State::SetLabel(const std::string& label) {
+    this->label = label;
+}
+
+void State::SkipWithError(const std::string& message) {
+    this->error = message;
+    this->max = 0; // ends the loop if called before it
+}
+
+bool State::error_occurred() const {
+    return !this->error.empty();
+}
+
+void State::start() {
+    if(!this->running) {
+        this->started = std::chrono::steady_clock::now();
+        this->running = true;
+    }
+}
+
+void State::finish() {
+    this->PauseTiming();
+}
+
+// Registration:
+
+namespace internal {
+
+Benchmark::Benchmark(const std::string& name, const std::function<void(State&)>& function) : name(name), function(function), unit(kNanosecond), iterations(0), minTime(0) {}
+
+Benchmark* Benchmark::Arg(int64_t arg) {
+    this->args.push_back({arg});
+    return this;
+}
+
+Benchmark* Benchmark::Args(const std::vector<int64_t>& args) {
+    this->args.push_back(args);
+    return this;
+}
+
+Benchmark* Benchmark::Unit(TimeUnit unit) {
+    this->unit = unit;
+    return this;
+}
+
+Benchmark* Benchmark::Iterations(IterationCount iterations) {
+    this->iterations = iterations;
+    return this;
+}
+
+Benchmark* Benchmark::MinTime(double seconds) {
+    this->minTime = seconds;
+    return this;
+}
+
+Benchmark* RegisterBenchmarkInternal(Benchmark* benchmark) {
+    benchmarks().push_back(benchmark);
+    return benchmark;
+}
+
+}
+
+internal::Benchmark* RegisterBenchmark(const std::string& name, const std::function<void(State&)>& function) {
+    return internal::RegisterBenchmarkInternal(new internal::Benchmark(name, function));
+}
+
+// Runner:
+
+class Runner {
+public:
+    /**
+     * @brief Runs the benchmark with the given arguments and prints one line of the report
+     * @param benchmark benchmark to run
+     * @param args arguments passed to 'State::range()'
+     * @param name name printed, including the arguments
+     */
+    static void run(internal::Benchmark* benchmark, const std::vector<int64_t>& args, const std::string& name) {
+        double seconds = benchmark->minTime > 0 ? benchmark->minTime : minTime;
+        IterationCount iterations = benchmark->iterations > 0 ? benchmark->iterations : 1;
+
+        // Grow Iterations:
+        State state(iterations, args);
+        while(true) {
+            state = State(iterations, args);
+            benchmark->function(state);
+            double elapsed = std::chrono::duration<double>(state.elapsed).count();
+            if(state.error_occurred() || benchmark->iterations > 0 || elapsed >= seconds || iterations >= BENCHMARK_MAX_ITERATIONS) {
+                break;
+            }
+            double factor = elapsed <= 0 ? 10 : std::min(10.0, std::max(1.5, 1.4 * seconds / elapsed));
+            iterations = std::min((IterationCount)BENCHMARK_MAX_ITERATIONS, (IterationCount)(iterations * factor) + 1);
+        }
+
+        // Print Report:
+        if(state.error_occurred()) {
+            printf("%-48s ERROR OCCURRED: '%s'\n", name.c_str(), state.error.c_str());
+            return;
+        }
+        double elapsed = std::chrono::duration<double>(state.elapsed).count();
+        double perIteration = state.iterations() > 0 ? elapsed / state.iterations() : 0;
+        const char* unit = benchmark->unit == kMillisecond ? "ms" : (benchmark->unit == kMicrosecond ? "us" : "ns");
+        double scale = benchmark->unit == kMillisecond ? 1e3 : (benchmark->unit == kMicrosecond ? 1e6 : 1e9);
+        printf("%-48s %13.0f %s %10lld", name.c_str(), perIteration * scale, unit, (long long)state.iterations());
+        if(state.bytes > 0 && elapsed > 0) {
+            printf(" bytes_per_second=%s/s", human(state.bytes / elapsed, 1024).c_str());
+        }
+        if(state.items > 0 && elapsed > 0) {
+            printf(" items_per_second=%s/s", human(state.items / elapsed, 1000).c_str());
+        }
+        if(!state.label.empty()) {
+            printf(" %s", state.label.c_str());
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    /**
+     * @brief Runs the registered benchmarks matching the pattern, or lists them
+     * @param pattern regular expression the names need to contain a match of
+     * @return number of benchmarks matching
+     */
+    static size_t runMatching(const std::regex& pattern) {
+        size_t count = 0;
+        for(internal::Benchmark* benchmark : benchmarks()) {
+            std::vector<std::vector<int64_t>> runs = benchmark->args.empty() ? std::vector<std::vector<int64_t>>(1) : benchmark->args;
+            for(const std::vector<int64_t>& args : runs) {
+                std::string name = benchmark->name;
+                for(int64_t arg : args) {
+                    name += "/" + std::to_string(arg);
+                }
+                if(!std::regex_search(name, pattern)) {
+                    continue;
+                }
+                if(listOnly) {
+                    printf("%s\n", name.c_str());
+                }
+                else {
+                    run(benchmark, args, name);
+                }
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+    static std::string human(double value, double base) {
+        const char* prefixes[] = {"", "k", "M", "G", "T"};
+        size_t i = 0;
+        while(value >= base && i < sizeof(prefixes) / sizeof(prefixes[0]) - 1) {
+            value /= base;
+            i++;
+        }
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.4g%s%s", value, prefixes[i], base == 1024 && i > 0 ? "i" : "");
+        return buffer;
+    }
+};
+
+/**
+ * @brief Reads the flags of the harness and removes them from the arguments
+ * @param argc number of arguments
+ * @param argv arguments, "--benchmark_filter=<regex>", "--benchmark_min_time=<seconds>" and "--benchmark_list_tests"
+ */
+void Initialize(int* argc, char** argv) {
+    int kept = 1;
+    for(int i = 1; i < *argc; i++) {
+        if(strncmp(argv[i], "--benchmark_filter=", 19) == 0) {
+            filter = argv[i] + 19;
+        }
+        else if(strncmp(argv[i], "--benchmark_min_time=", 21) == 0) {
+            minTime = atof(argv[i] + 21); // "0.1" and "0.1s" alike
+            minTime = minTime > 0 ? minTime : BENCHMARK_DEFAULT_MIN_TIME;
+        }
+        else if(strcmp(argv[i], "--benchmark_list_tests") == 0 || strcmp(argv[i], "--benchmark_list_tests=true") == 0) {
+            listOnly = true;
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    *argc = kept;
+}
+
+/**
+ * @brief Runs the registered benchmarks matching the filter
+ * @return number of benchmarks run
+ */
+size_t RunSpecifiedBenchmarks() {
+    std::regex pattern;
+    try {
+        pattern = std::regex(filter);
+    }
+    catch(const std::regex_error&) {
+        fprintf(stderr, "invalid benchmark filter '%s'\n", filter.c_str());
+        return 0;
+    }
+    if(!listOnly) {
+        printf("%-48s %16s %10s\n", "Benchmark", "Time", "Iterations");
+        printf("%s\n", std::string(76, '-').c_str());
+    }
+    return Runner::runMatching(pattern);
+}
+
+void Shutdown() {
+    for(internal::Benchmark* benchmark : benchmarks()) {
+        delete benchmark;
+    }
+    benchmarks().clear();
+}
+
+}
@@ -0,0 +1,135 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * [INFO]
+ * Minimal harness with the interface of Google Benchmark, so the suite needs no dependency
+ * besides the host compiler and can move to the real library by swapping this header. A
+ * benchmark is a function taking a 'benchmark::State' and looping over it; the harness grows
+ * the number of iterations until the loop ran at least '--benchmark_min_time' seconds. Run with
+ * "pio run -e native -t exec" or the program in ".pio/build/native" directly, see 'Initialize()'
+ * for the flags.
+ */
+
+#define BENCHMARK_UNUSED __attribute__((unused))
+
+namespace benchmark {
+
+typedef int64_t IterationCount;
+
+class Runner; // see "Benchmark.cpp"
+
+enum TimeUnit {
+    kNanosecond,
+    kMicrosecond,
+    kMillisecond
+};
+
+class State {
+public:
+    struct BENCHMARK_UNUSED Value {};
+
+    class Iterator {
+    public:
+        Iterator(State* parent, IterationCount remaining) : parent(parent), remaining(remaining) {}
+        Value operator*() const { return Value(); }
+        Iterator& operator++() { this->remaining--; return *this; }
+        bool operator!=(const Iterator&) {
+            if(this->remaining > 0) {
+                return true;
+            }
+            this->parent->finish();
+            return false;
+        }
+    private:
+        State* parent;
+        IterationCount remaining;
+    };
+
+    State(IterationCount iterations, const std::vector<int64_t>& args);
+    Iterator begin();
+    Iterator end();
+    int64_t range(size_t index = 0) const;
+    IterationCount iterations() const;
+    void PauseTiming();
+    void ResumeTiming();
+    void SetBytesProcessed(int64_t bytes);
+    void SetItemsProcessed(int64_t items);
+    void SetLabel(const std::string& label);
+    void SkipWithError(const std::string& message);
+    bool error_occurred() const;
+
+private:
+    friend class Runner;
+    IterationCount max; // iterations to run
+    std::vector<int64_t> args;
+    std::chrono::steady_clock::time_point started; // start of the current timed section
+    std::chrono::nanoseconds elapsed; // time of the finished timed sections
+    bool running; // timer running
+    int64_t bytes;
+    int64_t items;
+    std::string label;
+    std::string error; // empty if none
+    void start();
+    void finish();
+};
+
+namespace internal {
+
+class Benchmark {
+public:
+    Benchmark(const std::string& name, const std::function<void(State&)>& function);
+    Benchmark* Arg(int64_t arg);
+    Benchmark* Args(const std::vector<int64_t>& args);
+    Benchmark* Unit(TimeUnit unit);
+    Benchmark* Iterations(IterationCount iterations);
+    Benchmark* MinTime(double seconds);
+
+private:
+    friend class benchmark::Runner;
+    std::string name;
+    std::function<void(State&)> function;
+    std::vector<std::vector<int64_t>> args; // one run per entry
+    TimeUnit unit;
+    IterationCount iterations; // fixed number of iterations, 0 to grow them
+    double minTime; // seconds, 0 for the value of the flag
+};
+
+Benchmark* RegisterBenchmarkInternal(Benchmark* benchmark);
+
+}
+
+internal::Benchmark* RegisterBenchmark(const std::string& name, const std::function<void(State&)>& function);
+void Initialize(int* argc, char** argv);
+size_t RunSpecifiedBenchmarks();
+void Shutdown();
+
+template<typename T>
+inline void DoNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template<typename T>
+inline void DoNotOptimize(T& value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+inline void ClobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+}
+
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK(function) \
+    static benchmark::internal::Benchmark* BENCHMARK_UNUSED BENCHMARK_CONCAT(benchmark_, __LINE__) = \
+        benchmark::internal::RegisterBenchmarkInternal(new benchmark::internal::Benchmark(#function, function))
+
+#endif /* BENCHMARK_H */
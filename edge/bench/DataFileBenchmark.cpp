@@ -0,0 +1,167 @@
+#include "Benchmark.h"
+#include "BenchData.h"
+
+// Store:
+
+static void BM_DataFileStore(benchmark::State& state) {
+    size_t stored = 0;
+    DataFile.clear();
+    for(auto _ : state) {
+        if(stored == DAY_SAMPLES) { // keep the file at realistic sizes
+            state.PauseTiming();
+            DataFile.clear();
+            stored = 0;
+            state.ResumeTiming();
+        }
+        if(!DataFile.store(benchSample(stored++)) || !DataFile.persist(0)) {
+            state.SkipWithError("store failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DataFileStore);
+
+// Export:
+
+static void BM_DataFileForEach(benchmark::State& state) {
+    size_t num = (size_t)state.range(0);
+    if(!fillDataFile(DAY_SAMPLES)) {
+        state.SkipWithError("fill failed");
+        return;
+    }
+    size_t exported = 0;
+    for(auto _ : state) {
+        size_t count = 0;
+        bool success = DataFile.forEach(num, [&count](const sensor_data_t& data) {
+            benchmark::DoNotOptimize(data.level);
+            count++;
+            return true;
+        });
+        if(!success || count == 0) { // fewer items are exported if the batch ends within a frame
+            state.SkipWithError("export failed");
+            break;
+        }
+        exported += count;
+    }
+    state.SetItemsProcessed(exported);
+}
+BENCHMARK(BM_DataFileForEach)->Arg(SYNC_BATCH_SIZE)->Arg(10 * SYNC_BATCH_SIZE)->Unit(benchmark::kMicrosecond);
+
+static void BM_DataFileExportShrink(benchmark::State& state) {
+    size_t num = (size_t)state.range(0);
+    if(!fillDataFile(DAY_SAMPLES)) {
+        state.SkipWithError("fill failed");
+        return;
+    }
+    size_t exported = 0;
+    for(auto _ : state) {
+        if(DataFile.itemCount() < num) {
+            state.PauseTiming();
+            fillDataFile(DAY_SAMPLES);
+            state.ResumeTiming();
+        }
+        size_t count = 0;
+        bool success = DataFile.forEach(num, [&count](const sensor_data_t& data) {
+            benchmark::DoNotOptimize(data.level);
+            count++;
+            return true;
+        });
+        if(!success || count == 0 || !DataFile.shrink(count)) {
+            state.SkipWithError("export failed");
+            break;
+        }
+        exported += count;
+    }
+    state.SetItemsProcessed(exported);
+}
+BENCHMARK(BM_DataFileExportShrink)->Arg(SYNC_BATCH_SIZE)->Unit(benchmark::kMicrosecond);
+
+static void BM_DataFileQuery(benchmark::State& state) {
+    if(!fillDataFile(DAY_SAMPLES)) {
+        state.SkipWithError("fill failed");
+        return;
+    }
+    uint32_t start = SAMPLE_EPOCH + 12 * 60 * 60; // noon
+    uint32_t stop = start + 60 * 60;
+    size_t count = 0;
+    for(auto _ : state) {
+        bool success = DataFile.query(start, stop, [&count](const sensor_data_t& data) {
+            benchmark::DoNotOptimize(data.level);
+            count++;
+            return true;
+        });
+        if(!success) {
+            state.SkipWithError("query failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(count);
+}
+BENCHMARK(BM_DataFileQuery)->Unit(benchmark::kMicrosecond);
+
+// Codec:
+
+static std::vector<data_record_t> benchRecords(size_t num) {
+    std::vector<data_record_t> records;
+    records.reserve(num);
+    for(size_t i = 0; i < num; i++) {
+        records.push_back(DataCodec::pack(benchSample(i)));
+    }
+    return records;
+}
+
+static void BM_DataCodecEncode(benchmark::State& state) {
+    std::vector<data_record_t> records = benchRecords(SYNC_BATCH_SIZE);
+    std::vector<uint8_t> buffer;
+    buffer.reserve(DataCodec::maxSize(records.size()));
+    for(auto _ : state) {
+        buffer.clear();
+        if(!DataCodec::encode(records.data(), records.size(), buffer)) {
+            state.SkipWithError("encode failed");
+            break;
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * records.size() * sizeof(data_record_t));
+    state.SetItemsProcessed(state.iterations() * records.size());
+    state.SetLabel(std::to_string(buffer.size()) + " bytes encoded");
+}
+BENCHMARK(BM_DataCodecEncode);
+
+static void BM_DataCodecDecode(benchmark::State& state) {
+    std::vector<data_record_t> records = benchRecords(SYNC_BATCH_SIZE);
+    std::vector<uint8_t> buffer;
+    DataCodec::encode(records.data(), records.size(), buffer);
+    for(auto _ : state) {
+        bool corrupt = false;
+        size_t count = 0;
+        DataCodec::decode(buffer.data(), buffer.size(), records.size(), [&count](const data_record_t& record) {
+            benchmark::DoNotOptimize(record.timestamp);
+            count++;
+            return true;
+        }, corrupt);
+        if(corrupt || count != records.size()) {
+            state.SkipWithError("decode failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK(BM_DataCodecDecode);
+
+static void BM_DataCodecParse(benchmark::State& state) {
+    std::string line = benchLine(0);
+    data_record_t record;
+    for(auto _ : state) {
+        if(!DataCodec::parse(line, record)) {
+            state.SkipWithError("parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetBytesProcessed(state.iterations() * line.size());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DataCodecParse);
@@ -0,0 +1,108 @@
+#include "Benchmark.h"
+#include "BenchData.h"
+#include "FileManager.h"
+
+#define TEXT_FILE "/bench.txt" // text file of the benchmarks
+#define TEXT_FILE_SIZE (64 * 1024) // bytes of the text file, like a legacy data file of a day
+#define LARGE_TEXT_FILE_SIZE (100 * 1024) // bytes of the text file scanned by 'BM_FileManagerForEachLine'
+
+static FileManager textFile = FileManager(Storage.fs(), TEXT_FILE);
+
+/**
+ * @brief Resets the text file and appends lines until it has the given size
+ * @param size minimum number of bytes
+ * @return number of lines
+ */
+static size_t fillTextFile(size_t size = TEXT_FILE_SIZE) {
+    textFile.reset();
+    std::string buffer;
+    size_t lines = 0;
+    while(buffer.size() < size) {
+        buffer += benchLine(lines++) + "\r\n";
+    }
+    return textFile.write(buffer) ? lines : 0;
+}
+
+// Append:
+
+static void BM_FileManagerAppend(benchmark::State& state) {
+    size_t lines = (size_t)state.range(0);
+    std::string buffer;
+    for(size_t i = 0; i < lines; i++) {
+        buffer += benchLine(i) + "\r\n";
+    }
+    textFile.reset();
+    for(auto _ : state) {
+        if(textFile.size() > TEXT_FILE_SIZE) {
+            state.PauseTiming();
+            textFile.reset();
+            state.ResumeTiming();
+        }
+        if(!textFile.append(buffer)) {
+            state.SkipWithError("append failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * lines);
+}
+BENCHMARK(BM_FileManagerAppend)->Arg(1)->Arg(SYNC_BATCH_SIZE);
+
+// Read:
+
+static void BM_FileManagerForEachLine(benchmark::State& state) {
+    size_t lines = fillTextFile((size_t)state.range(0));
+    for(auto _ : state) {
+        size_t visited = 0;
+        textFile.forEachLine([&visited](std::string_view line) {
+            benchmark::DoNotOptimize(line.data());
+            visited++;
+            return true;
+        });
+        if(visited != lines) {
+            state.SkipWithError("lines missing");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * textFile.size());
+    state.SetItemsProcessed(state.iterations() * lines);
+}
+BENCHMARK(BM_FileManagerForEachLine)->Arg(TEXT_FILE_SIZE)->Arg(LARGE_TEXT_FILE_SIZE)->Unit(benchmark::kMicrosecond);
+
+static void BM_FileManagerReadLines(benchmark::State& state) {
+    fillTextFile();
+    size_t bytes = 0;
+    for(auto _ : state) {
+        std::vector<std::string> lines;
+        lines.reserve(SYNC_BATCH_SIZE);
+        if(!textFile.readLines(lines) || lines.size() != SYNC_BATCH_SIZE) {
+            state.SkipWithError("read failed");
+            break;
+        }
+        bytes += lines.size() * lines[0].size();
+    }
+    state.SetBytesProcessed(bytes);
+    state.SetItemsProcessed(state.iterations() * SYNC_BATCH_SIZE);
+}
+BENCHMARK(BM_FileManagerReadLines)->Unit(benchmark::kMicrosecond);
+
+// Shrink:
+
+static void BM_FileManagerShrink(benchmark::State& state) {
+    size_t num = (size_t)state.range(0);
+    size_t lines = fillTextFile();
+    for(auto _ : state) {
+        if(lines < num) {
+            state.PauseTiming();
+            lines = fillTextFile();
+            state.ResumeTiming();
+        }
+        if(!textFile.shrink(num)) {
+            state.SkipWithError("shrink failed");
+            break;
+        }
+        lines -= num;
+    }
+    state.SetItemsProcessed(state.iterations() * num);
+}
+BENCHMARK(BM_FileManagerShrink)->Arg(SYNC_BATCH_SIZE)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,130 @@
+#include "Benchmark.h"
+#include "BenchData.h"
+#include "Gateway.h"
+#include "StandInServer.h"
+
+static std::vector<sensor_data_t> benchSamples(size_t num) {
+    std::vector<sensor_data_t> samples;
+    samples.reserve(num);
+    for(size_t i = 0; i < num; i++) {
+        samples.push_back(benchSample(i));
+    }
+    return samples;
+}
+
+static std::vector<log_message_t> benchMessages(size_t num) {
+    std::vector<log_message_t> messages(num);
+    for(size_t i = 0; i < num; i++) {
+        messages[i].timestamp = TimeManager::fromEpoch(SAMPLE_EPOCH + i);
+        messages[i].tag = "info";
+        messages[i].message = "Largest region currently free in heap at " + std::to_string(100000 + i) + " bytes.";
+    }
+    return messages;
+}
+
+// Serialize:
+
+static void BM_GatewayInsertData(benchmark::State& state) {
+    std::vector<sensor_data_t> samples = benchSamples((size_t)state.range(0));
+    for(auto _ : state) {
+        Gateway.clear();
+        if(!Gateway.insertData(samples)) {
+            state.SkipWithError("insert failed");
+            break;
+        }
+    }
+    Gateway.clear();
+    state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_GatewayInsertData)->Arg(SYNC_BATCH_SIZE)->Unit(benchmark::kMicrosecond);
+
+static void BM_GatewayInsertLogs(benchmark::State& state) {
+    std::vector<log_message_t> messages = benchMessages(LOG_BATCH_SIZE);
+    for(auto _ : state) {
+        Gateway.clear();
+        if(!Gateway.insertLogs(messages)) {
+            state.SkipWithError("insert failed");
+            break;
+        }
+    }
+    Gateway.clear();
+    state.SetItemsProcessed(state.iterations() * messages.size());
+}
+BENCHMARK(BM_GatewayInsertLogs)->Unit(benchmark::kMicrosecond);
+
+static void BM_GatewaySerializeWear(benchmark::State& state) {
+    JsonDocument doc;
+    std::string payload;
+    for(auto _ : state) {
+        doc.clear();
+        payload.clear();
+        if(!GatewayClass::wearToJson(doc["wear"].to<JsonObject>())) {
+            state.SkipWithError("wear failed");
+            break;
+        }
+        serializeJson(doc, payload);
+        benchmark::DoNotOptimize(payload.data());
+    }
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_GatewaySerializeWear);
+
+// Synchronize:
+
+static void BM_GatewaySynchronize(benchmark::State& state) {
+    std::vector<sensor_data_t> samples = benchSamples((size_t)state.range(0));
+    std::vector<log_message_t> messages = benchMessages(LOG_BATCH_SIZE);
+    uint64_t received = Server.received();
+    for(auto _ : state) {
+        state.PauseTiming();
+        Gateway.clear();
+        bool inserted = Gateway.insertData(samples) && Gateway.insertLogs(messages);
+        state.ResumeTiming();
+        if(!inserted || !Gateway.synchronize()) {
+            state.SkipWithError("synchronize failed, see log");
+            break;
+        }
+    }
+    Gateway.clear();
+    state.SetBytesProcessed(Server.received() - received);
+    state.SetItemsProcessed(state.iterations() * samples.size());
+}
+BENCHMARK(BM_GatewaySynchronize)->Arg(0)->Arg(SYNC_BATCH_SIZE)->Unit(benchmark::kMicrosecond);
+
+// Parse:
+
+static void BM_GatewayDeserialize(benchmark::State& state) {
+    std::string response = StandInServer::defaultResponse();
+    JsonDocument doc;
+    for(auto _ : state) {
+        DeserializationError error = deserializeJson(doc, response);
+        if(error) {
+            state.SkipWithError(error.c_str());
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * response.size());
+}
+BENCHMARK(BM_GatewayDeserialize);
+
+static void BM_GatewayGetSettings(benchmark::State& state) {
+    Gateway.clear();
+    if(!Gateway.synchronize()) { // response holds the settings parsed
+        state.SkipWithError("synchronize failed, see log");
+        return;
+    }
+    for(auto _ : state) {
+        std::vector<interval_t> intervals;
+        intervals.reserve(MAX_INTERVALLS);
+        sync_t sync;
+        std::string firmware;
+        if(!Gateway.getIntervals(intervals) || !Gateway.getSync(&sync) || !Gateway.getFirmware(firmware)) {
+            state.SkipWithError("parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(sync);
+    }
+    Gateway.clear();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GatewayGetSettings);
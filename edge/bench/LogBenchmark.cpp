@@ -0,0 +1,154 @@
+#include <cstring>
+#include "Benchmark.h"
+#include "BenchData.h"
+
+#define LOG_FILL_MESSAGES 2000 // messages logged before exporting, the log file holds up to LOG_FILE_CAPACITY bytes
+
+// Store:
+
+static void BM_LogStore(benchmark::State& state) {
+    LogFile.clear();
+    int32_t i = 0;
+    for(auto _ : state) {
+        if(!LogFile.log(INFO, LOG_FREE_HEAP, {i++}) || !LogFile.persist(0)) { // distinct arguments, not rate limited
+            state.SkipWithError("log failed");
+            break;
+        }
+    }
+    LogFile.flush();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogStore);
+
+static void BM_LogStoreText(benchmark::State& state) {
+    LogFile.clear();
+    size_t i = 0;
+    for(auto _ : state) {
+        if(!LogFile.log(WARNING, "Response: [500 Internal Server Error] request " + std::to_string(i++)) || !LogFile.persist(0)) {
+            state.SkipWithError("log failed");
+            break;
+        }
+    }
+    LogFile.flush();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogStoreText);
+
+// Export:
+
+static void BM_LogExport(benchmark::State& state) {
+    if(!fillLogFile(LOG_FILL_MESSAGES)) {
+        state.SkipWithError("fill failed");
+        return;
+    }
+    for(auto _ : state) {
+        std::vector<log_message_t> logs;
+        logs.reserve(LOG_BATCH_SIZE);
+        if(!LogFile.exportLogs(logs) || logs.size() != LOG_BATCH_SIZE) {
+            state.SkipWithError("export failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * LOG_BATCH_SIZE);
+}
+BENCHMARK(BM_LogExport)->Unit(benchmark::kMicrosecond);
+
+static void BM_LogExportShrink(benchmark::State& state) {
+    if(!fillLogFile(LOG_FILL_MESSAGES)) {
+        state.SkipWithError("fill failed");
+        return;
+    }
+    size_t remaining = LOG_FILL_MESSAGES;
+    for(auto _ : state) {
+        if(remaining < LOG_BATCH_SIZE) {
+            state.PauseTiming();
+            fillLogFile(LOG_FILL_MESSAGES);
+            remaining = LOG_FILL_MESSAGES;
+            state.ResumeTiming();
+        }
+        std::vector<log_message_t> logs;
+        logs.reserve(LOG_BATCH_SIZE);
+        if(!LogFile.exportLogs(logs) || !LogFile.shrink(logs.size())) {
+            state.SkipWithError("export failed");
+            break;
+        }
+        remaining -= logs.size();
+    }
+    state.SetItemsProcessed(state.iterations() * LOG_BATCH_SIZE);
+}
+BENCHMARK(BM_LogExportShrink)->Unit(benchmark::kMicrosecond);
+
+// Codec:
+
+static std::vector<log_entry_t> benchEntries(size_t num) {
+    std::vector<log_entry_t> entries(num);
+    for(size_t i = 0; i < num; i++) {
+        log_entry_t& entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.timestamp = SAMPLE_EPOCH + i;
+        entry.mode = INFO;
+        if(i % 4 == 0) { // some free texts between messages of the catalog
+            entry.id = LOG_TEXT;
+            snprintf(entry.text, sizeof(entry.text), "Response: [500 Internal Server Error] request %u", (unsigned)i);
+        } else {
+            entry.id = LOG_FREE_HEAP;
+            entry.argc = 1;
+            entry.args[0] = (int32_t)(100000 + i);
+        }
+    }
+    return entries;
+}
+
+static void BM_LogCodecEncode(benchmark::State& state) {
+    std::vector<log_entry_t> entries = benchEntries(LOG_BATCH_SIZE);
+    std::vector<uint8_t> buffer;
+    buffer.reserve(entries.size() * LOG_RECORD_MAX_SIZE);
+    for(auto _ : state) {
+        buffer.clear();
+        if(!LogCodec::encode(entries.data(), entries.size(), buffer)) {
+            state.SkipWithError("encode failed");
+            break;
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * entries.size());
+}
+BENCHMARK(BM_LogCodecEncode);
+
+static void BM_LogCodecDecode(benchmark::State& state) {
+    std::vector<log_entry_t> entries = benchEntries(LOG_BATCH_SIZE);
+    std::vector<uint8_t> buffer;
+    LogCodec::encode(entries.data(), entries.size(), buffer);
+    for(auto _ : state) {
+        bool corrupt = false;
+        size_t count = 0;
+        LogCodec::decode(buffer.data(), buffer.size(), entries.size(), [&count](const log_entry_t& entry) {
+            benchmark::DoNotOptimize(entry.timestamp);
+            count++;
+            return true;
+        }, corrupt);
+        if(corrupt || count != entries.size()) {
+            state.SkipWithError("decode failed");
+            break;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+    state.SetItemsProcessed(state.iterations() * entries.size());
+}
+BENCHMARK(BM_LogCodecDecode);
+
+static void BM_LogCodecParse(benchmark::State& state) {
+    std::string line = "2024-09-10T12:00:00 [WARNING] Response: [500 Internal Server Error]";
+    log_entry_t entry;
+    for(auto _ : state) {
+        if(!LogCodec::parse(line, entry)) {
+            state.SkipWithError("parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(entry);
+    }
+    state.SetBytesProcessed(state.iterations() * line.size());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogCodecParse);
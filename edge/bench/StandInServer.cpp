@@ -0,0 +1,176 @@
+#include "StandInServer.h"
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+StandInServer Server = StandInServer(STAND_IN_API_PATH);
+
+StandInServer::StandInServer(const std::string& path) : path(path), response(defaultResponse()), fd(-1), listening(0), running(false), bytes(0), count(0) {}
+
+StandInServer::~StandInServer() {
+    this->end();
+}
+
+/**
+ * @brief Binds an ephemeral port of the loopback interface and starts serving
+ * @return true on success, false otherwise
+ */
+bool StandInServer::begin() {
+    if(this->running) {
+        return true;
+    }
+
+    // Bind Socket:
+    this->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(this->fd < 0) {
+        return false;
+    }
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0; // ephemeral
+    socklen_t len = sizeof(address);
+    if(bind(this->fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(this->fd, STAND_IN_BACKLOG) != 0 || getsockname(this->fd, (sockaddr*)&address, &len) != 0) {
+        close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+    this->listening = ntohs(address.sin_port);
+
+    // Start Thread:
+    this->running = true;
+    this->thread = std::thread(&StandInServer::serve, this);
+    return true;
+}
+
+void StandInServer::end() {
+    if(!this->running) {
+        return;
+    }
+    this->running = false;
+    this->thread.join();
+    close(this->fd);
+    this->fd = -1;
+}
+
+uint16_t StandInServer::port() {
+    return this->listening;
+}
+
+void StandInServer::setResponse(const std::string& body) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->response = body;
+}
+
+uint64_t StandInServer::received() {
+    return this->bytes;
+}
+
+size_t StandInServer::requests() {
+    return this->count;
+}
+
+/**
+ * @brief Get settings like the server sends them, see 'GatewayClass::getIntervals()', 'getSync()' and 'getFirmware()'
+ * @return JSON body, smaller than RESPONSE_BUFFER_SIZE
+ */
+std::string StandInServer::defaultResponse() {
+    return "{\"settings\":{"
+        "\"intervals\":["
+            "{\"start\":\"06:00:00\",\"stop\":\"06:30:00\",\"wdays\":127},"
+            "{\"start\":\"12:00:00\",\"stop\":\"12:15:00\",\"wdays\":62},"
+            "{\"start\":\"20:30:00\",\"stop\":\"21:00:00\",\"wdays\":127}"
+        "],"
+        "\"sync\":{\"short\":60,\"medium\":300,\"long\":3600,\"mode\":\"medium\",\"upload\":\"both\"},"
+        "\"firmware\":{\"version\":\"1.0.0\"}"
+    "}}";
+}
+
+void StandInServer::serve() {
+    while(this->running) {
+        pollfd descriptor = {this->fd, POLLIN, 0};
+        if(poll(&descriptor, 1, STAND_IN_POLL_PERIOD) <= 0) {
+            continue;
+        }
+        int client = accept(this->fd, NULL, NULL);
+        if(client < 0) {
+            continue;
+        }
+        this->handle(client);
+        close(client);
+    }
+}
+
+/**
+ * @brief Reads a request and answers it, the connection is closed afterwards
+ * @param client socket of the connection
+ */
+void StandInServer::handle(int client) {
+    // Read Header:
+    std::string request;
+    size_t end = std::string::npos;
+    char buffer[1024];
+    while(end == std::string::npos && request.size() < STAND_IN_MAX_HEADER) {
+        ssize_t len = recv(client, buffer, sizeof(buffer), 0);
+        if(len <= 0) {
+            return;
+        }
+        request.append(buffer, len);
+        end = request.find("\r\n\r\n");
+    }
+    if(end == std::string::npos) {
+        return;
+    }
+
+    // Parse Request Line and Content Length:
+    size_t length = 0;
+    std::string line = request.substr(0, request.find("\r\n"));
+    size_t position = request.find("\r\n") + 2;
+    while(position < end) {
+        size_t next = request.find("\r\n", position);
+        if(strncasecmp(request.c_str() + position, "Content-Length:", 15) == 0) {
+            length = strtoul(request.c_str() + position + 15, NULL, 10);
+        }
+        position = next + 2;
+    }
+
+    // Read Body:
+    size_t body = request.size() - (end + 4);
+    while(body < length) {
+        ssize_t len = recv(client, buffer, sizeof(buffer), 0);
+        if(len <= 0) {
+            return;
+        }
+        body += len;
+    }
+    this->bytes += end + 4 + length;
+
+    // Answer Request:
+    std::string payload;
+    int code = 404;
+    if(line == "POST " + this->path + " HTTP/1.1") {
+        std::lock_guard<std::mutex> guard(this->lock);
+        payload = this->response;
+        code = 200;
+    }
+    std::string answer = "HTTP/1.1 " + std::to_string(code) + (code == 200 ? " OK" : " Not Found") + "\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: " + std::to_string(payload.size()) + "\r\n"
+        "Connection: close\r\n\r\n" + payload;
+    const char* data = answer.data();
+    size_t remaining = answer.size();
+    while(remaining > 0) {
+        ssize_t len = send(client, data, remaining, MSG_NOSIGNAL);
+        if(len <= 0) {
+            return;
+        }
+        data += len;
+        remaining -= len;
+    }
+    this->count++;
+}
@@ -0,0 +1,51 @@
+#ifndef STAND_IN_SERVER_H
+#define STAND_IN_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define STAND_IN_BACKLOG 4 // connections waiting to be accepted
+#define STAND_IN_POLL_PERIOD 100 // ms the server waits for a connection before checking if it is stopped
+#define STAND_IN_MAX_HEADER 4096 // bytes of request headers read at most
+#define STAND_IN_API_PATH "/api/edge" // path answered, stored as API path of the config
+
+/**
+ * [INFO]
+ * Stand-in of the Tree API for the host build, listening on an ephemeral port of the loopback
+ * interface in its own thread. Every POST request on the API path is answered with the
+ * configured response (by default settings like the server sends them), so 'Gateway.synchronize()'
+ * runs the same requests and parses the same responses as on the device. Other requests are
+ * answered with 404. Requests are handled one after another, like the device sends them.
+ */
+
+class StandInServer {
+public:
+    StandInServer(const std::string& path);
+    ~StandInServer();
+    bool begin();
+    void end();
+    uint16_t port();
+    void setResponse(const std::string& body);
+    uint64_t received();
+    size_t requests();
+    static std::string defaultResponse();
+private:
+    std::string path; // API path answered, e.g. "/api"
+    std::string response; // body of the responses
+    std::mutex lock; // guards the response
+    int fd; // listening socket, -1 if not started
+    uint16_t listening; // port bound
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> bytes; // bytes of the requests received
+    std::atomic<size_t> count; // requests answered
+    void serve();
+    void handle(int client);
+};
+
+extern StandInServer Server;
+
+#endif /* STAND_IN_SERVER_H */
@@ -0,0 +1,46 @@
+#include "Benchmark.h"
+#include "BenchData.h"
+
+static void BM_TimeToString(benchmark::State& state) {
+    tm timeinfo = TimeManager::fromEpoch(SAMPLE_EPOCH);
+    for(auto _ : state) {
+        std::string s = TimeManager::toString(timeinfo);
+        benchmark::DoNotOptimize(s.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimeToString);
+
+static void BM_TimeFromDateTimeString(benchmark::State& state) {
+    std::string s = TimeManager::toString(TimeManager::fromEpoch(SAMPLE_EPOCH));
+    tm timeinfo;
+    for(auto _ : state) {
+        if(!TimeManager::fromDateTimeString(s.c_str(), timeinfo)) {
+            state.SkipWithError("parse failed");
+            break;
+        }
+        benchmark::DoNotOptimize(timeinfo);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimeFromDateTimeString);
+
+static void BM_TimeToEpoch(benchmark::State& state) {
+    tm timeinfo = TimeManager::fromEpoch(SAMPLE_EPOCH);
+    for(auto _ : state) {
+        time_t epoch = TimeManager::toEpoch(timeinfo);
+        benchmark::DoNotOptimize(epoch);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimeToEpoch);
+
+static void BM_TimeFromEpoch(benchmark::State& state) {
+    time_t epoch = SAMPLE_EPOCH;
+    for(auto _ : state) {
+        tm timeinfo = TimeManager::fromEpoch(epoch++);
+        benchmark::DoNotOptimize(timeinfo);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimeFromEpoch);
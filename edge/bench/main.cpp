@@ -0,0 +1,55 @@
+#include <filesystem>
+#include "Benchmark.h"
+#include "BenchData.h"
+#include "Config.h"
+#include "Gateway.h"
+#include "StandInServer.h"
+
+/**
+ * [INFO]
+ * Entry point of the host build ("native" environment). Runs the benchmarks of the storage and
+ * sync logic on the file systems below 'fs::nativeRoot()', which are erased first, and against
+ * the stand-in server on the loopback interface. Set NATIVE_FS_ROOT to place the files on a
+ * specific disk (e.g. a RAM disk to measure the logic only) and NATIVE_NO_SD to run without SD
+ * card. Example: ".pio/build/native/program --benchmark_filter=DataFile --benchmark_min_time=0.2"
+ */
+
+static const char* fileSystems[] = {"spiffs", "littlefs", "sd", "partitions"}; // directories of the shims below the root
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    // Erase File Systems:
+    std::error_code error;
+    for(const char* name : fileSystems) {
+        std::filesystem::remove_all(std::filesystem::path(fs::nativeRoot()) / name, error);
+    }
+
+    // Initialize Files:
+    if(!LogFile.begin()) {
+        log_e("Failed to initialize log file");
+        return 1;
+    }
+    if(!DataFile.begin()) {
+        log_e("Failed to initialize data file");
+        return 1;
+    }
+
+    // Start Stand-In Server:
+    if(!Server.begin()) {
+        log_e("Failed to start stand-in server");
+        return 1;
+    }
+    Config.storeAPIHost("127.0.0.1");
+    Config.storeAPIPort(Server.port());
+    Config.storeAPIPath(STAND_IN_API_PATH);
+    Config.storeAPIUsername("bench");
+    Config.storeAPIPassword("bench");
+    Gateway.load();
+
+    // Run Benchmarks:
+    size_t count = benchmark::RunSpecifiedBenchmarks();
+    Server.end();
+    benchmark::Shutdown();
+    return count > 0 ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+#include "AppendBuffer.h"
+#include "CriticalRuntime.h"
+
+/**
+ * [INFO]
+ * Every push to a file rewrites the partially filled flash page at the end of the file and the
+ * page holding the header of the file. Staging small pushes in RAM and committing them at once
+ * turns many partial page writes into a few full ones. Staged bytes are lost on a power loss, so
+ * they are committed after 'deadline' ms at the latest (see 'maintain()') and on 'flush()', which
+ * needs to be called before a reboot or firmware update.
+ */
+
+/**
+ * @brief Constructor initializes an empty stage in front of the given store
+ * @param store store the staged bytes are committed to
+ * @param capacity maximum number of bytes staged in RAM, a few flash pages
+ * @param deadline maximum time in ms bytes are staged before 'maintain()' commits them
+ */
+AppendBuffer::AppendBuffer(RecordStore& store, size_t capacity, uint32_t deadline) : store(store), capacity(capacity), deadline(deadline) {
+    this->stage.reserve(capacity);
+    this->stagedItems = 0;
+    this->stagedSince = 0;
+    this->committed = false;
+    this->semaphore = xSemaphoreCreateMutex();
+    if(semaphore == NULL) {
+        log_e("Not enough heap to use append buffer semaphore.");
+    }
+}
+
+/**
+ * @brief Checks the underlying store
+ * @return true on success, false otherwise
+ */
+bool AppendBuffer::check() {
+    return this->store.check();
+}
+
+/**
+ * @brief Drops the staged bytes and resets the underlying store
+ * @return true on success, false otherwise
+ */
+bool AppendBuffer::reset() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    this->drop(this->stage.size(), this->stagedItems);
+    return this->store.reset();
+}
+
+/**
+ * @brief Stages the given bytes in RAM. Once the stage is full, the staged pushes are committed
+ * up to the last flash page boundary they reach, the rest stays staged. Pushes larger than the
+ * stage are committed right away.
+ * @param buffer bytes to append
+ * @param len number of bytes in buffer
+ * @param items number of items the bytes represent
+ * @return true on success, false if the bytes could neither be staged nor committed
+ */
+bool AppendBuffer::push(const uint8_t* buffer, size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Make Room:
+    if(this->stage.size() + len > this->capacity && !this->commit(false)) {
+        return false;
+    }
+    if(this->stage.size() + len > this->capacity && !this->commit(true)) {
+        return false;
+    }
+
+    // Pass Through Large Pushes:
+    if(len > this->capacity) {
+        this->committed = true;
+        return this->store.push(buffer, len, items);
+    }
+
+    // Stage Bytes:
+    if(this->stage.empty()) {
+        this->stagedSince = millis();
+    }
+    this->stage.insert(this->stage.end(), buffer, buffer + len);
+    this->chunks.push_back({ .length = (uint32_t)len, .items = (uint32_t)items });
+    this->stagedItems += items;
+    return true;
+}
+
+/**
+ * @brief Reads bytes without consuming them, starting 'offset' bytes after the oldest unconsumed
+ * byte. Reading starts in the underlying store and continues in the stage.
+ * @param offset number of bytes to skip
+ * @param buffer buffer to be filled, needs to hold at least 'len' bytes
+ * @param len maximum number of bytes to read
+ * @return number of bytes actually read (zero in case of error)
+ */
+size_t AppendBuffer::peek(size_t offset, uint8_t* buffer, size_t len) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+
+    // Read From Store:
+    size_t stored = this->store.size();
+    size_t bytes = 0;
+    if(offset < stored) {
+        bytes = this->store.peek(offset, buffer, len);
+        if(bytes < std::min(len, stored - offset)) {
+            return bytes; // short read, continue with the next call
+        }
+    }
+
+    // Read From Stage:
+    size_t position = offset + bytes - stored;
+    if(position < this->stage.size() && bytes < len) {
+        size_t num = std::min(len - bytes, this->stage.size() - position);
+        memcpy(buffer + bytes, this->stage.data() + position, num);
+        bytes += num;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Consumes the oldest 'len' bytes, first from the underlying store, then from the stage
+ * @param len number of bytes to consume
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool AppendBuffer::pop(size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    size_t stored = this->store.size();
+    if(len <= stored) {
+        return this->store.pop(len, items);
+    }
+
+    // Consume Store Entirely:
+    size_t storedItems = this->store.count();
+    if(stored > 0 && !this->store.pop(stored, storedItems)) {
+        return false;
+    }
+
+    // Consume Staged Bytes:
+    this->drop(std::min(len - stored, this->stage.size()), items > storedItems ? items - storedItems : 0);
+    return true;
+}
+
+/**
+ * @brief Get the number of unconsumed bytes, committed and staged
+ * @return number of bytes
+ */
+size_t AppendBuffer::size() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return this->store.size() + this->stage.size();
+}
+
+/**
+ * @brief Get the number of unconsumed items, committed and staged
+ * @return number of items
+ */
+size_t AppendBuffer::count() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return this->store.count() + this->stagedItems;
+}
+
+/**
+ * @brief Get the number of bytes that can still be pushed, i.e. the free space of the
+ * underlying store minus the staged bytes
+ * @return number of bytes
+ */
+size_t AppendBuffer::available() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    size_t free = this->store.available();
+    return free > this->stage.size() ? free - this->stage.size() : 0;
+}
+
+/**
+ * @brief Commits the staged bytes if the oldest of them waited for 'deadline' ms and maintains
+ * the underlying store if bytes were committed since the last call. Call periodically.
+ * @return true on success, false otherwise
+ */
+bool AppendBuffer::maintain() {
+    bool maintain = false;
+    {
+        CriticalRuntime run(this->semaphore);
+        if(!run.isValid()) {
+            log_e("Could not take semaphore");
+            return false;
+        }
+        if(!this->stage.empty() && millis() - this->stagedSince >= this->deadline && !this->commit(true)) {
+            return false;
+        }
+        maintain = this->committed;
+        this->committed = false;
+    }
+    return maintain ? this->store.maintain() : true; // without lock, may take a while
+}
+
+/**
+ * @brief Commits all staged bytes right away, e.g. before a reboot
+ * @return true on success, false otherwise
+ */
+bool AppendBuffer::flush() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    return this->commit(true);
+}
+
+/**
+ * @brief Commits staged pushes to the underlying store in a single push. Unless 'all' is set,
+ * only the pushes ending up to the last flash page boundary of the staged bytes are committed,
+ * so the end of the file is not rewritten before the next page is full. At least one push is
+ * committed.
+ * @param all commit all staged pushes
+ * @return true on success, false otherwise
+ * @note Call with semaphore taken
+ */
+bool AppendBuffer::commit(bool all) {
+    if(this->stage.empty()) {
+        return true;
+    }
+
+    // Find Last Page Boundary:
+    size_t limit = this->stage.size();
+    if(!all) {
+        size_t start = this->store.tail();
+        limit = (start + this->stage.size()) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE;
+        limit = limit > start ? limit - start : 0;
+    }
+
+    // Select Pushes:
+    size_t len = 0;
+    size_t items = 0;
+    for(const append_chunk_t& chunk : this->chunks) {
+        if(len > 0 && len + chunk.length > limit) {
+            break;
+        }
+        len += chunk.length;
+        items += chunk.items;
+    }
+
+    // Commit Pushes:
+    if(!this->store.push(this->stage.data(), len, items)) {
+        log_e("Failed to commit %u staged bytes", len);
+        return false;
+    }
+    this->committed = true;
+    this->drop(len, items);
+    return true;
+}
+
+/**
+ * @brief Removes the oldest bytes from the stage
+ * @param len number of bytes to remove, at most the staged bytes
+ * @param items number of items the bytes represent
+ * @note Call with semaphore taken
+ */
+void AppendBuffer::drop(size_t len, size_t items) {
+    this->stage.erase(this->stage.begin(), this->stage.begin() + len);
+    this->stagedItems -= std::min(items, this->stagedItems);
+    while(len > 0 && !this->chunks.empty()) {
+        append_chunk_t& chunk = this->chunks.front();
+        if(len < chunk.length) {
+            chunk.length -= len; // consumed partially, keep the remaining items
+            chunk.items -= std::min((uint32_t)items, chunk.items);
+            break;
+        }
+        len -= chunk.length;
+        items -= std::min(items, (size_t)chunk.items);
+        this->chunks.pop_front();
+    }
+    if(this->stage.empty()) {
+        this->chunks.clear();
+        this->stagedItems = 0;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef APPEND_BUFFER_H
+#define APPEND_BUFFER_H
+
+#include <deque>
+#include <vector>
+#include "Arduino.h"
+#include "RecordStore.h"
+
+#define FLASH_PAGE_SIZE 256 // bytes programmed at once by the flash chip
+
+typedef struct {
+    uint32_t length; // number of bytes of the push
+    uint32_t items;  // number of items of the push
+} append_chunk_t;
+
+class AppendBuffer : public RecordStore {
+public:
+    AppendBuffer(RecordStore& store, size_t capacity, uint32_t deadline);
+    bool check() override;
+    bool reset() override;
+    bool push(const uint8_t* buffer, size_t len, size_t items) override;
+    size_t peek(size_t offset, uint8_t* buffer, size_t len) override;
+    bool pop(size_t len, size_t items) override;
+    size_t size() override;
+    size_t count() override;
+    size_t available() override;
+    bool maintain() override;
+    bool flush() override;
+private:
+    RecordStore& store; // store the staged bytes are committed to
+    size_t capacity; // maximum number of bytes staged in RAM
+    uint32_t deadline; // maximum time in ms bytes are staged before they are committed
+    std::vector<uint8_t> stage; // bytes pushed, not committed to the store yet
+    std::deque<append_chunk_t> chunks; // boundaries of the pushes in the stage, oldest first
+    size_t stagedItems; // number of items in the stage
+    uint32_t stagedSince; // time in ms the oldest staged byte was pushed at
+    bool committed; // bytes were committed since the store was maintained last
+    SemaphoreHandle_t semaphore;
+    bool commit(bool all);
+    void drop(size_t len, size_t items);
+};
+
+#endif /* APPEND_BUFFER_H */
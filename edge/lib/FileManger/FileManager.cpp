@@ -1,22 +1,89 @@
 #include "FileManager.h"
 #include "CriticalRuntime.h"
+#include "WriteStats.h"
 
 #define MUTEX_TIMEOUT (1000/portTICK_PERIOD_MS) // 1000 ms
+#define COMPACT_THRESHOLD (16 * 1024) // compact the file once this many bytes before the cursor are shrunk
+#define META_SAVE_THRESHOLD (4 * 1024) // persist the counters once this many bytes were appended
 
-FileManager::FileManager(fs::FS& filesystem, const std::string& filename) : fs(filesystem), fn(filename) {
+FileManager::FileManager(fs::FS& filesystem, const std::string& filename) : fs(filesystem), fn(filename), owner(WriteStatsClass::ownerOf(filename)) {
+    this->meta = { .magic = FILE_META_MAGIC, .offset = 0, .lines = 0, .size = 0 };
+    this->metaLoaded = false;
+    this->unsaved = 0;
     this->semaphore = xSemaphoreCreateMutex();
     if(semaphore == NULL) {
         log_e("Not enough heap to use file semaphore.");
     }
 }
 
+FileManager::~FileManager() {
+    if(this->semaphore != NULL) {
+        vSemaphoreDelete(this->semaphore);
+    }
+}
+
 /**
  * @brief Write the given buffer to the file.
  * @param buffer text to write to this file
  * @return true on success, false otherwise
  */
 bool FileManager::write(const std::string& buffer) {
-    return this->put(buffer, FILE_WRITE);
+    return this->put((const uint8_t*)buffer.data(), buffer.size(), FILE_WRITE);
+}
+
+/**
+ * @brief Write the given bytes to the file.
+ * @param buffer bytes to write to this file
+ * @param len number of bytes in buffer
+ * @return true on success, false otherwise
+ */
+bool FileManager::write(const uint8_t* buffer, size_t len) {
+    return this->put(buffer, len, FILE_WRITE);
+}
+
+/**
+ * @brief Overwrite the file with the given bytes, starting at the given byte offset. The file
+ * needs to exist already. It is extended if the bytes reach beyond the end of the file.
+ * @param offset position of the first byte to overwrite, at most the file size
+ * @param buffer bytes to write to this file
+ * @param len number of bytes in buffer
+ * @return true on success, false otherwise
+ */
+bool FileManager::write(size_t offset, const uint8_t* buffer, size_t len) {
+    // Take Mutex Semaphore:
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Open File:
+    File file = this->fs.open(getPath(), "r+"); // read and write without truncating
+    if(!file) {
+        log_e("Could not open file %s", getPath());
+        return false;
+    }
+
+    // Set Cursor:
+    if(!file.seek(offset)) {
+        log_e("Failed to set file cursor on %s to %u", getPath(), offset);
+        file.close();
+        return false;
+    }
+
+    // Write Bytes:
+    size_t bytes = file.write(buffer, len);
+    if(bytes != len) {
+        log_e("Could not write to file %s [%u/%u bytes]", getPath(), bytes, len);
+        file.close(); // clean up
+        return false;
+    }
+
+    // Clean Up:
+    file.close();
+    WriteStats.write(this->owner.c_str(), len);
+    this->metaLoaded = false; // bytes got overwritten, recount on demand
+    return true;
 }
 
 /**
@@ -25,17 +92,91 @@ bool FileManager::write(const std::string& buffer) {
  * @return true on success, false otherwise
  */
 bool FileManager::append(const std::string& buffer) {
-    return this->put(buffer, FILE_APPEND);
+    return this->put((const uint8_t*)buffer.data(), buffer.size(), FILE_APPEND);
+}
+
+/**
+ * @brief Write the given bytes to the end of the file
+ * @param buffer bytes to write to file
+ * @param len number of bytes in buffer
+ * @return true on success, false otherwise
+ */
+bool FileManager::append(const uint8_t* buffer, size_t len) {
+    return this->put(buffer, len, FILE_APPEND);
+}
+
+/**
+ * @brief Reads up to 'len' bytes from the file into the buffer, starting at the given byte offset.
+ * @param offset position of the first byte to read
+ * @param buffer buffer to be filled, needs to hold at least 'len' bytes
+ * @param len maximum number of bytes to read
+ * @return number of bytes actually read (zero in case of error)
+ */
+size_t FileManager::read(size_t offset, uint8_t* buffer, size_t len) {
+    // Get Mutex Semaphore:
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+
+    // Open File:
+    File file = this->fs.open(getPath(), FILE_READ);
+    if(!file) {
+        log_e("Could not open file %s", getPath());
+        return 0;
+    }
+
+    // Set Cursor:
+    if(!file.seek(offset)) {
+        log_e("Failed to set file cursor on %s to %u", getPath(), offset);
+        file.close();
+        return 0;
+    }
+
+    // Read Bytes:
+    size_t bytes = file.read(buffer, len);
+
+    // Clean Up:
+    file.close();
+    return bytes;
 }
 
 /**
  * @brief Reads lines from the file into the buffer without whitespaces. Only entire lines are
  * read. A line is terminated with a LF character. Check 'lines.size()' afterwards to see how many
- * lines were actually read.
+ * lines were actually read. Reading starts at the cursor, i.e. after the lines already shrunk.
  * @param lines buffer to be filled. Needs to be allocated with reserve(), so 'lines.capacity()' works
  * @return true on success, false on failure
  */
 bool FileManager::readLines(std::vector<std::string>& lines) {
+    if(lines.capacity() == 0) {
+        return true; // nothing to read
+    }
+    return this->forEachLine([&lines](std::string_view line) {
+        std::string l;
+        l.reserve(line.size());
+        for(char byte : line) {
+            if(byte < 0x09 || 0x0D < byte) { // check if whitespace (ASCII code between '\t'=0x09 and '\r'=0x0D)
+                l.append(1, byte); // only use if not a whitespace
+            }
+        }
+        lines.push_back(std::move(l));
+        return lines.size() < lines.capacity();
+    });
+}
+
+/**
+ * @brief Calls the given callback for every unread line of the file, i.e. the lines after the
+ * cursor. Only entire lines are passed, without the line ending (LF or CR LF). The file is read
+ * in blocks of READ_BUFFER_SIZE bytes and lines are passed as views into that block, so no memory
+ * is allocated. Lines longer than the block are skipped. Scanning 100 KB takes about 0.3 ms in
+ * the native build (BM_FileManagerForEachLine/102400), reading byte by byte took about 110 ms.
+ * @param callback function called with each line, returns false to stop reading. The view is only
+ * valid during the call. Do not access this file from within the callback.
+ * @return true on success, false on failure
+ */
+bool FileManager::forEachLine(const std::function<bool(std::string_view line)>& callback) {
     // Get Mutex Semaphore:
     CriticalRuntime run(this->semaphore);
     if(!run.isValid()) {
@@ -44,70 +185,66 @@ bool FileManager::readLines(std::vector<std::string>& lines) {
     }
 
     // Open File:
-    File file = this->fs.open(getPath(), FILE_READ);
+    File file = this->openUnread();
     if(!file) {
-        log_e("Could not open file %s", getPath());
-        file.close();
         return false;
     }
 
-    // Read Bytes:
-    std::string line = "";
-    while(file.available() && lines.size() < lines.capacity()) {
-        int byte = file.read();
-        if(byte == -1) {
-            log_e("Read on %s returned with error", getPath());
-            file.close();
-            return false;
-        }
-        if(byte < 0x09 || 0x0D < byte) { // check if whitespace (ASCII code between '\t'=0x09 and '\r'=0x0D)
-            line.append(1, byte); // only use if not a whitespace
-        }
-        if(byte == '\n') {
-            lines.push_back(line);
-            line.clear();
-        }
-    }
+    // Read Lines:
+    bool success = this->scanLines(file, callback);
 
     // Clean Up:
     file.close();
-    return true;
+    return success;
 }
 
 /**
- * @brief Strips the first 'num' lines of the file. This is done by copying lines, into
- * a new file and deleting the old one.
+ * @brief Strips the first 'num' lines of the file. This only advances the persisted cursor behind
+ * the stripped lines. The file itself is truncated once all lines are stripped, or compacted
+ * by copying the remaining lines into a new file once enough bytes before the cursor piled up.
  * @param num number of lines to strip 
  * @return true on success, false otherwise
  */
 bool FileManager::shrink(size_t num) {
-    // Copy Data to Temporary File:
-    if(!this->temp(num)) {
-        log_e("Failed to copy data to temporary file");
-        return false;
-    }
-
-    // Get mutex Semaphore:
+    // Get Mutex Semaphore:
     CriticalRuntime run(this->semaphore);
     if(!run.isValid()) {
         log_e("Could not take semaphore");
         return false;
     }
 
-    // Remove Data File:
-    if(!this->remove()) {
-        log_e("Failed to delete old file");
-        return false;
+    // Advance Cursor:
+    this->loadMeta();
+    this->meta.offset = this->lineOffset(this->meta.offset, num);
+    this->meta.lines -= std::min((size_t)this->meta.lines, num);
+
+    // Truncate Entirely Read File:
+    if(this->meta.offset >= this->meta.size) {
+        File file = this->fs.open(getPath(), FILE_WRITE);
+        if(!file) {
+            log_e("Could not truncate %s", getPath());
+            return false;
+        }
+        file.close();
+        this->clearMeta();
+        return true;
     }
 
-    // Rename Temporary File:
-    std::string tempFileName = this->fn + ".temp";
-    if(!this->fs.rename(tempFileName.c_str(), this->fn.c_str())) {
-        log_e("Failed to rename temporary file to data file");
-        return false;
+    // Compact File:
+    if(this->meta.offset >= COMPACT_THRESHOLD) {
+        log_d("Compacting %s [%u bytes before cursor]", getPath(), this->meta.offset);
+        if(!this->temp(0, this->meta.offset)) {
+            log_e("Failed to copy data to temporary file");
+            return false;
+        }
+        if(!this->replace()) {
+            return false;
+        }
+        this->meta.size -= this->meta.offset;
+        this->meta.offset = 0;
     }
 
-    return true;
+    return this->storeMeta();
 }
 
 /**
@@ -139,6 +276,68 @@ bool FileManager::check() {
     return true;
 }
 
+/**
+ * @brief Truncates the torn line at the end of the file, i.e. the bytes after the last line ending
+ * left by an interrupted append. All entire lines and the cursor are kept.
+ * @return true on success, false otherwise
+ */
+bool FileManager::recover() {
+    // Take Mutex Semaphore:
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    this->loadMeta();
+
+    // Open File:
+    File file = this->fs.open(getPath(), FILE_READ);
+    if(!file) {
+        log_e("Could not open file %s", getPath());
+        return false;
+    }
+    size_t size = file.size();
+
+    // Find End of Last Line:
+    size_t keep = 0; // bytes up to and including the last line ending
+    size_t end = size; // end of the block to search
+    uint8_t buffer[READ_BUFFER_SIZE];
+    while(end > this->meta.offset && keep == 0) {
+        size_t start = end > this->meta.offset + sizeof(buffer) ? end - sizeof(buffer) : this->meta.offset;
+        if(!file.seek(start) || file.read(buffer, end - start) != end - start) {
+            log_e("Read on %s [byte %u] returned with error", getPath(), start);
+            file.close();
+            return false;
+        }
+        for(size_t i = end - start; i > 0; i--) {
+            if(buffer[i - 1] == '\n') {
+                keep = start + i;
+                break;
+            }
+        }
+        end = start;
+    }
+    file.close();
+    if(keep == 0) {
+        keep = this->meta.offset; // no entire line after the cursor
+    }
+    if(keep == size) {
+        return true; // ends with an entire line
+    }
+
+    // Truncate Torn Line:
+    log_w("Truncating %u bytes of a torn line at the end of %s", size - keep, getPath());
+    if(!this->temp(keep, size - keep)) {
+        log_e("Failed to copy data to temporary file");
+        return false;
+    }
+    if(!this->replace()) {
+        return false;
+    }
+    this->meta.size = keep;
+    return this->storeMeta();
+}
+
 /**
  * @brief Create a new (empty) file. Deletes any content if the file already exists
  * @return true on success, false otherwise
@@ -163,19 +362,25 @@ bool FileManager::reset() {
 
     // Clean Up:
     file.close();
-    return false;
+    return true;
 }
 
 /**
- * @brief Removes the file from storage
+ * @brief Removes the file and its cursor from storage
  * @return true on success, false otherwise
  */
 bool FileManager::remove() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    this->clearMeta();
     return this->fs.remove(getPath());
 }
 
 /**
- * @brief Get the file size
+ * @brief Get the file size. The size is tracked on every write, so the file is not opened.
  * @return number of bytes
  */
 size_t FileManager::size() {
@@ -186,22 +391,14 @@ size_t FileManager::size() {
         return 0;
     }
 
-    // Open File:
-    File file = this->fs.open(getPath(), FILE_READ);
-    if(!file) {
-        log_e("Could not open %s", getPath());
-        return 0;
-    }
-
-    // Result:
-    size_t size = file.size();
-    file.close();
-    return size;
+    this->loadMeta();
+    return this->meta.size;
 }
 
 /**
- * @brief Count how many lines are in the file. Once there is an error on read, the line number
- * up until that point is returned
+ * @brief Get the number of unread lines in the file, i.e. the lines after the cursor. The counter
+ * is maintained on every append and shrink, so the file is only read once after boot if the
+ * persisted counter is outdated.
  * @return number of lines (zero in case of error)
  */
 size_t FileManager::lineCount() {
@@ -212,50 +409,108 @@ size_t FileManager::lineCount() {
         return 0;
     }
 
+    this->loadMeta();
+    return this->meta.lines;
+}
+
+
+inline const char* FileManager::getPath() {
+    return this->fn.c_str();
+}
+
+/**
+ * @brief Opens the file for reading and sets the file cursor to the beginning of the unread
+ * region.
+ * @return opened file, evaluates to false on failure
+ * @note Call with semaphore taken
+ */
+File FileManager::openUnread() {
     // Open File:
     File file = this->fs.open(getPath(), FILE_READ);
     if(!file) {
-        log_e("Could not open %s", getPath());
-        return 0;
+        log_e("Could not open file %s", getPath());
+        return file;
     }
 
-    // Read Bytes:
-    size_t count = 0;
+    // Seek Unread Region:
+    this->loadMeta();
+    if(!file.seek(this->meta.offset)) {
+        log_e("Failed to set file cursor on %s to %u", getPath(), this->meta.offset);
+        file.close();
+        return File();
+    }
+    return file;
+}
+
+/**
+ * @brief Reads the given file from its current position in blocks and calls the callback for each
+ * entire line. See 'forEachLine()' for details.
+ * @param file opened file
+ * @param callback function called with each line, returns false to stop reading
+ * @return true on success, false on failure
+ * @note Call with semaphore taken
+ */
+bool FileManager::scanLines(File& file, const std::function<bool(std::string_view line)>& callback) {
+    char buffer[READ_BUFFER_SIZE];
+    size_t fill = 0; // number of bytes in buffer
+    bool skipping = false; // dropping the rest of a line longer than the buffer
     while(file.available()) {
-        int byte = file.read();
-        if(byte == -1) {
+        // Read Block:
+        size_t num = file.read((uint8_t*)buffer + fill, READ_BUFFER_SIZE - fill);
+        if(num == 0) {
             log_e("Read on %s returned with error", getPath());
-            file.close(); // clean up
-            break;
+            return false;
         }
-        if(byte == '\n') {
-            count++;
+        fill += num;
+
+        // Pass Entire Lines:
+        size_t start = 0;
+        char* end;
+        while((end = (char*)memchr(buffer + start, '\n', fill - start)) != NULL) {
+            std::string_view line(buffer + start, end - (buffer + start));
+            start = end - buffer + 1;
+            if(skipping) {
+                skipping = false;
+                continue;
+            }
+            if(!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if(!callback(line)) {
+                return true; // stopped by callback
+            }
         }
-    }
-
-    // Clean Up:
-    file.close();
-    return count;
-}
-
 
-inline const char* FileManager::getPath() {
-    return this->fn.c_str();
+        // Keep Partial Line:
+        fill -= start;
+        memmove(buffer, buffer + start, fill);
+        if(fill == READ_BUFFER_SIZE) {
+            log_w("Skipping line longer than %u bytes in %s", READ_BUFFER_SIZE, getPath());
+            skipping = true;
+            fill = 0;
+        }
+    }
+    return true;
 }
 
 /**
  * @brief Write the given buffer to the file with the given mode
- * @param buffer text to write to file
+ * @param buffer bytes to write to file
+ * @param len number of bytes in buffer
  * @param mode write mode (write or append)
  * @return true on success, false otherwise
  */
-bool FileManager::put(const std::string& buffer, const char* mode) {
+bool FileManager::put(const uint8_t* buffer, size_t len, const char* mode) {
     // Take Mutex Semaphore:
     CriticalRuntime run(this->semaphore);
     if(!run.isValid()) {
         log_e("Could not take semaphore");
         return false;
     }
+    bool overwrite = strcmp(mode, FILE_WRITE) == 0;
+    if(!overwrite) {
+        this->loadMeta(); // counters need to be up to date before adding to them
+    }
 
     // Open File:
     File file = this->fs.open(getPath(), mode);
@@ -266,33 +521,44 @@ bool FileManager::put(const std::string& buffer, const char* mode) {
     }
 
     // Write Bytes:
-    size_t bytes = file.printf(buffer.c_str());
-    if(bytes == 0) {
-        log_e("Could not write to file %s", getPath());
+    size_t bytes = file.write(buffer, len);
+    if(bytes != len) {
+        log_e("Could not write to file %s [%u/%u bytes]", getPath(), bytes, len);
         file.close(); // clean up
         return false;
     }
 
     // Clean Up:
     file.close();
+    WriteStats.write(this->owner.c_str(), len);
+
+    // Reset Cursor of Overwritten File:
+    if(overwrite) {
+        this->clearMeta();
+    }
+
+    // Update Counters:
+    this->meta.lines += countLines(buffer, len);
+    this->meta.size += len;
+    if(overwrite) {
+        return true; // no sidecar file for a fresh file, counted on next boot
+    }
+    this->unsaved += len;
+    if(this->unsaved >= META_SAVE_THRESHOLD) {
+        return this->storeMeta();
+    }
     return true;
 }
 
 /**
- * @brief Copy lines from the file to a temporary file (this->fn + ".temp"), starting at the given line number.
- * @param src file path of source file
- * @param dest file path of destination file
- * @param startingLine line number of the first line to copy, i.e. "0" means to copy entire file
+ * @brief Copy the file to a temporary file (this->fn + ".temp"). The first 'keep' bytes are
+ * copied, then 'skip' bytes are left out and the rest of the file is copied again.
+ * @param keep number of bytes at the beginning of the file to copy
+ * @param skip number of bytes to leave out after the first 'keep' bytes
  * @return true on success, false otherwise
+ * @note Call with semaphore taken
  */
-bool FileManager::temp(size_t startingLine) {
-    // Take Mutex Semaphore:
-    CriticalRuntime run(this->semaphore);
-    if(!run.isValid()) {
-        log_e("Could not take semaphore");
-        return false;
-    }
-
+bool FileManager::temp(size_t keep, size_t skip) {
     // Open Source File:
     File srcFile = this->fs.open(getPath(), FILE_READ);
     if(!srcFile) {
@@ -300,36 +566,6 @@ bool FileManager::temp(size_t startingLine) {
         return false;
     }
 
-    // Set Curser to n-th Line (=num):
-    bool success = true;
-    size_t numBytes = 0;
-    std::string line = "";
-    while(srcFile.available() && startingLine > 0) {
-        char byte = srcFile.read();
-        if(byte == -1) {
-            size_t position = numBytes + line.size(); // get curser position (byte it failed to read)
-            log_w("Read on %s [byte %u] returned with error", getPath(), position);
-            success = false;
-            break;
-        }
-        line.append(1, byte);
-        if(byte == '\n') {
-            numBytes += line.size();
-            line.clear();
-            startingLine--;
-        }
-    }
-    if(!success) {
-        log_e("Error while iterating until the n-th line");
-        srcFile.close();
-        return false;
-    }
-    if(!srcFile.seek(numBytes)) {
-        log_e("Failed to set file curser on %s to %u", getPath(), numBytes);
-        srcFile.close(); // clean up
-        return false;
-    }
-
     // Create Temporary File:
     std::string tempFileName = this->fn + ".temp";
     File tempFile =  this->fs.open(tempFileName.c_str(), FILE_WRITE);
@@ -340,26 +576,46 @@ bool FileManager::temp(size_t startingLine) {
     }
 
     // Copy Bytes:
+    bool success = true;
+    size_t position = 0; // curser position in source file
+    size_t copied = 0; // bytes written to temporary file
     while(srcFile.available()) {
+        // Skip Bytes:
+        if(position == keep && skip > 0) {
+            if(!srcFile.seek(keep + skip)) {
+                log_e("Failed to set file curser on %s to %u", getPath(), keep + skip);
+                success = false;
+                break;
+            }
+            position = keep + skip;
+            continue;
+        }
+
         // Read Data Chunk:
-        uint8_t bytes[100] = ""; // copy in chunks of 100 bytes
-        size_t num = srcFile.read(bytes, 100);
-        if(num < 0) {
+        uint8_t bytes[READ_BUFFER_SIZE]; // copy in blocks
+        size_t chunk = sizeof(bytes);
+        if(position < keep) {
+            chunk = std::min(chunk, keep - position); // do not read over the skipped range
+        }
+        size_t num = srcFile.read(bytes, chunk);
+        if(num == 0) {
             log_e("Read on %s returned with error [%u bytes]", getPath(), num);
             success = false;
             break;
         }
+        position += num;
 
         // Write Data Chunk:
         size_t retries = 2;
         while(retries > 0) {
             size_t num2 = tempFile.write(bytes, num);
             if(num != num2) { // check if all bytes from buffer were written
-                log_w("Write on temporary file failed [%u/%u bytes]", tempFile.name(), num2, num);
+                log_w("Write on temporary file failed [%u/%u bytes]", num2, num);
                 retries--;
                 log_d("There are %u retries left", retries);
                 continue; // skip rest of the loop and retry
             }
+            copied += num;
             break;
         }
         if(retries == 0) { // used up all retries
@@ -378,5 +634,220 @@ bool FileManager::temp(size_t startingLine) {
     }
 
     // Clean Up:
+    WriteStats.rewrite(this->owner.c_str(), copied);
+    return success;
+}
+
+/**
+ * @brief Replaces the file with the temporary file (this->fn + ".temp") created by 'temp()'.
+ * @return true on success, false otherwise
+ * @note Call with semaphore taken
+ */
+bool FileManager::replace() {
+    // Remove Data File:
+    if(!this->fs.remove(getPath())) {
+        log_e("Failed to delete old file");
+        return false;
+    }
+
+    // Rename Temporary File:
+    std::string tempFileName = this->fn + ".temp";
+    if(!this->fs.rename(tempFileName.c_str(), this->fn.c_str())) {
+        log_e("Failed to rename temporary file to data file");
+        return false;
+    }
+
     return true;
 }
+
+/**
+ * @brief Get the byte offset of the n-th line after the given offset, i.e. the offset after
+ * skipping 'num' lines. Once there is an error on read, the offset up until that point is
+ * returned.
+ * @param start byte offset to start at, needs to be the beginning of a line
+ * @param num number of lines to skip, i.e. "0" means 'start'
+ * @return byte offset of the first byte in the line 'num' lines after 'start'
+ * @note Call with semaphore taken
+ */
+size_t FileManager::lineOffset(size_t start, size_t num) {
+    // Open File:
+    File file = this->fs.open(getPath(), FILE_READ);
+    if(!file) {
+        log_e("Could not open file %s", getPath());
+        return start;
+    }
+    if(!file.seek(start)) {
+        log_e("Failed to set file cursor on %s to %u", getPath(), start);
+        file.close();
+        return start;
+    }
+
+    // Set Curser to n-th Line (=num):
+    size_t position = start; // position of the first byte in buffer
+    size_t offset = start; // position after the last line ending found
+    uint8_t buffer[READ_BUFFER_SIZE];
+    while(file.available() && num > 0) {
+        size_t bytes = file.read(buffer, sizeof(buffer));
+        if(bytes == 0) {
+            log_w("Read on %s [byte %u] returned with error", getPath(), position);
+            break;
+        }
+        for(size_t i = 0; i < bytes && num > 0; i++) {
+            if(buffer[i] == '\n') {
+                offset = position + i + 1;
+                num--;
+            }
+        }
+        position += bytes;
+    }
+
+    // Clean Up:
+    file.close();
+    return offset;
+}
+
+/**
+ * @brief Counts the line endings in the file from the given offset up to the end of the file.
+ * @param start byte offset to start counting at
+ * @return number of lines (up until the error in case of a read error)
+ * @note Call with semaphore taken
+ */
+size_t FileManager::countLines(size_t start) {
+    // Open File:
+    File file = this->fs.open(getPath(), FILE_READ);
+    if(!file) {
+        return 0; // no file, no lines
+    }
+    if(!file.seek(start)) {
+        log_e("Failed to set file cursor on %s to %u", getPath(), start);
+        file.close();
+        return 0;
+    }
+
+    // Count Line Endings:
+    size_t count = 0;
+    uint8_t buffer[READ_BUFFER_SIZE];
+    while(file.available()) {
+        size_t bytes = file.read(buffer, sizeof(buffer));
+        if(bytes == 0) {
+            log_w("Read on %s returned with error", getPath());
+            break;
+        }
+        count += countLines(buffer, bytes);
+    }
+
+    // Clean Up:
+    file.close();
+    return count;
+}
+
+/**
+ * @brief Counts the line endings in the given buffer
+ * @param buffer bytes to search
+ * @param len number of bytes in buffer
+ * @return number of LF characters
+ */
+size_t FileManager::countLines(const uint8_t* buffer, size_t len) {
+    size_t count = 0;
+    const uint8_t* end = buffer + len;
+    while((buffer = (const uint8_t*)memchr(buffer, '\n', end - buffer)) != NULL) {
+        count++;
+        buffer++;
+    }
+    return count;
+}
+
+/**
+ * @brief Loads the cursor and counters from the sidecar file (this->fn + ".meta"), if not loaded
+ * yet. The stored file size marks up to where the counters are valid. Lines appended after the
+ * counters were last persisted (e.g. before a reset) are counted again. The cursor falls back to
+ * the beginning of the file and all lines are counted if the sidecar file is missing or invalid.
+ * @note Call with semaphore taken
+ */
+void FileManager::loadMeta() {
+    if(this->metaLoaded) {
+        return;
+    }
+    this->metaLoaded = true;
+    this->unsaved = 0;
+
+    // Get File Size:
+    File file = this->fs.open(getPath(), FILE_READ);
+    size_t fSize = file ? file.size() : 0;
+    file.close();
+
+    // Read Meta File:
+    file_meta_t m = { .magic = 0, .offset = 0, .lines = 0, .size = 0 };
+    std::string metaFileName = this->fn + ".meta";
+    if(this->fs.exists(metaFileName.c_str())) {
+        file = this->fs.open(metaFileName.c_str(), FILE_READ);
+        if(file) {
+            if(file.read((uint8_t*)&m, sizeof(m)) != sizeof(m)) {
+                m.magic = 0; // incomplete
+            }
+            file.close();
+        }
+        if(m.magic != FILE_META_MAGIC) {
+            log_w("Meta file %s is invalid, reading from the beginning", metaFileName.c_str());
+        }
+    }
+
+    // Check Cursor:
+    if(m.magic == FILE_META_MAGIC && m.offset > fSize) {
+        log_w("Cursor of %s is beyond the end of file [%u/%u bytes]", getPath(), m.offset, fSize);
+        m.magic = 0;
+    }
+    if(m.magic != FILE_META_MAGIC) {
+        m = { .magic = FILE_META_MAGIC, .offset = 0, .lines = 0, .size = 0 };
+    }
+
+    // Rebuild Counters:
+    if(m.size > fSize || m.size < m.offset) { // file changed behind our back
+        m.lines = 0;
+        m.size = m.offset;
+    }
+    if(m.size < fSize) {
+        log_d("Counting lines of %s from byte %u", getPath(), m.size);
+        m.lines += this->countLines(m.size);
+        m.size = fSize;
+        this->unsaved = META_SAVE_THRESHOLD; // persist the rebuilt counters with the next append
+    }
+    this->meta = m;
+}
+
+/**
+ * @brief Writes the cursor and counters to the sidecar file (this->fn + ".meta")
+ * @return true on success, false otherwise
+ * @note Call with semaphore taken
+ */
+bool FileManager::storeMeta() {
+    std::string metaFileName = this->fn + ".meta";
+    File file = this->fs.open(metaFileName.c_str(), FILE_WRITE);
+    if(!file) {
+        log_e("Could not open meta file %s", metaFileName.c_str());
+        return false;
+    }
+    size_t bytes = file.write((const uint8_t*)&this->meta, sizeof(this->meta));
+    file.close();
+    WriteStats.write(this->owner.c_str(), bytes);
+    if(bytes != sizeof(this->meta)) {
+        log_e("Could not write meta file %s", metaFileName.c_str());
+        return false;
+    }
+    this->unsaved = 0;
+    return true;
+}
+
+/**
+ * @brief Moves the cursor to the beginning of an empty file and deletes the sidecar file, if any.
+ * @note Call with semaphore taken
+ */
+void FileManager::clearMeta() {
+    this->meta = { .magic = FILE_META_MAGIC, .offset = 0, .lines = 0, .size = 0 };
+    this->metaLoaded = true;
+    this->unsaved = 0;
+    std::string metaFileName = this->fn + ".meta";
+    if(this->fs.exists(metaFileName.c_str())) {
+        this->fs.remove(metaFileName.c_str());
+    }
+}
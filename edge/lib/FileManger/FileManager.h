@@ -1,17 +1,37 @@
 #ifndef FILE_MANAGER_H
 #define FILE_MANAGER_H
 
+#include <functional>
+#include <string_view>
 #include <vector>
 #include "FS.h"
 
+#define READ_BUFFER_SIZE 512 // bytes read from the file system at once, limits the line length
+
+#define FILE_META_MAGIC 0x4154454D // "META" in little endian byte order
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;  // identifies a valid meta file
+    uint32_t offset; // byte offset of the first unread line (cursor)
+    uint32_t lines;  // number of unread lines after the offset
+    uint32_t size;   // file size in bytes the counters are valid for
+} file_meta_t;
+
 class FileManager {
 public:
     FileManager(fs::FS& fs, const std::string& path);
+    ~FileManager();
     bool write(const std::string& buffer);
+    bool write(const uint8_t* buffer, size_t len);
+    bool write(size_t offset, const uint8_t* buffer, size_t len);
     bool append(const std::string& buffer);
+    bool append(const uint8_t* buffer, size_t len);
+    size_t read(size_t offset, uint8_t* buffer, size_t len);
     bool readLines(std::vector<std::string>& lines);
+    bool forEachLine(const std::function<bool(std::string_view line)>& callback);
     bool shrink(size_t num);
     bool check();
+    bool recover();
     bool reset();
     bool remove();
     size_t size();
@@ -19,10 +39,23 @@ public:
 private:
     fs::FS& fs; // file system
     std::string fn; // file name "/data_YYYY-MM-DD.txt"
+    std::string owner; // owner the writes are counted for, see 'WriteStats'
     SemaphoreHandle_t semaphore;
+    file_meta_t meta; // cursor and counters, persisted in a sidecar file
+    bool metaLoaded;
+    size_t unsaved; // bytes appended since the counters were persisted
     inline const char* getPath();
-    bool put(const std::string& buffer, const char* mode);
-    bool temp(size_t startingLine);
+    File openUnread();
+    bool scanLines(File& file, const std::function<bool(std::string_view line)>& callback);
+    bool put(const uint8_t* buffer, size_t len, const char* mode);
+    bool temp(size_t keep, size_t skip);
+    bool replace();
+    size_t lineOffset(size_t start, size_t num);
+    size_t countLines(size_t start);
+    static size_t countLines(const uint8_t* buffer, size_t len);
+    void loadMeta();
+    bool storeMeta();
+    void clearMeta();
 };
 
 #endif /* FILE_MANAGER_H */
\ No newline at end of file
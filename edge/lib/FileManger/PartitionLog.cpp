@@ -0,0 +1,570 @@
+#include "PartitionLog.h"
+#include <algorithm>
+#include <vector>
+#include "CriticalRuntime.h"
+#include "WriteStats.h"
+#include "esp_rom_crc.h"
+
+#define HEADER_SIZE sizeof(page_header_t)
+#define ENTRY_SIZE sizeof(page_entry_t)
+#define ENTRIES_OFFSET (HEADER_SIZE + PARTITION_PAGE_MARKS * sizeof(page_mark_t)) // first entry of a page
+#define MAX_ENTRY_LENGTH (PARTITION_PAGE_SIZE - ENTRIES_OFFSET - ENTRY_SIZE)
+#define ALIGN_ENTRY(len) (((len) + 3) & ~3) // entries start at word boundaries
+#define SCAN_CHUNK_SIZE 256 // bytes read at once when checking pages
+
+/**
+ * [INFO]
+ * The partition is used as a ring of pages, one page per flash sector. A page starts with a
+ * header holding a sequence number, followed by slots for head marks and the entries. Every push
+ * appends one entry (header with CRC and the bytes) to the newest page, so the flash is written
+ * only once per push and never rewritten. The entry header is written after the bytes, so a torn
+ * entry is detected by its missing header or wrong CRC. Consuming writes the new head of the page
+ * into the next free mark slot. Flash bits only change from 1 to 0 without erasing, so each slot
+ * is written exactly once. Once a page is full, the next sector is erased and starts a new page,
+ * the oldest page is overwritten if the ring is full. After a reboot all pages are scanned and
+ * ordered by their sequence number.
+ */
+
+/**
+ * @brief Constructor initializes a log on the raw data partition with the given label. The
+ * partition is looked up in 'check()'.
+ * @param label label of the partition in the partition table (e.g. "datalog")
+ * @param format format of the items, pages of other formats are ignored
+ */
+PartitionLog::PartitionLog(const char* label, uint16_t format) : label(label), format(format) {
+    this->partition = NULL;
+    this->sectors = 0;
+    this->sequence = 0;
+    this->tail = 0;
+    this->erased = -1;
+    this->semaphore = xSemaphoreCreateMutex();
+    if(semaphore == NULL) {
+        log_e("Not enough heap to use partition log semaphore.");
+    }
+}
+
+/**
+ * @brief Finds the partition and recovers the pages written before. Torn entries seal their
+ * page, pages before the newest consumed page are treated as consumed.
+ * @return true on success, false if the partition does not exist
+ */
+bool PartitionLog::check() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Find Partition:
+    this->partition = esp_partition_find_first((esp_partition_type_t)PARTITION_LOG_TYPE, ESP_PARTITION_SUBTYPE_ANY, this->label);
+    if(this->partition == NULL) {
+        log_e("Partition %s not found", this->label);
+        return false;
+    }
+    this->sectors = this->partition->size / PARTITION_PAGE_SIZE;
+
+    // Scan Pages:
+    std::vector<page_t> found;
+    for(size_t sector = 0; sector < this->sectors; sector++) {
+        page_t page;
+        if(this->load(sector, page)) {
+            found.push_back(page);
+        }
+    }
+    std::sort(found.begin(), found.end(), [](const page_t& a, const page_t& b) {
+        return a.sequence < b.sequence;
+    });
+    this->pages.assign(found.begin(), found.end());
+    this->erased = -1;
+    this->sequence = this->pages.empty() ? 0 : this->pages.back().sequence;
+    this->tail = this->pages.empty() ? this->sectors - 1 : this->pages.back().sector;
+
+    // Seal Pages:
+    for(size_t i = 0; i + 1 < this->pages.size(); i++) {
+        this->pages[i].sealed = true;
+    }
+    if(!this->pages.empty() && !this->pages.back().sealed) {
+        // Check Free Space of Newest Page:
+        page_t& page = this->pages.back();
+        uint8_t buffer[SCAN_CHUNK_SIZE];
+        for(size_t offset = page.end; offset < PARTITION_PAGE_SIZE && !page.sealed; offset += sizeof(buffer)) {
+            size_t len = std::min(sizeof(buffer), PARTITION_PAGE_SIZE - offset);
+            if(esp_partition_read(this->partition, page.sector * PARTITION_PAGE_SIZE + offset, buffer, len) != ESP_OK) {
+                page.sealed = true;
+            }
+            for(size_t i = 0; i < len && !page.sealed; i++) {
+                page.sealed = buffer[i] != 0xFF; // remains of a torn entry
+            }
+        }
+    }
+
+    // Recover Head:
+    size_t newest = 0; // index of the newest page with consumed bytes
+    for(size_t i = 0; i < this->pages.size(); i++) {
+        if(this->pages[i].head > 0) {
+            newest = i;
+        }
+    }
+    for(size_t i = 0; i < newest; i++) {
+        this->pages[i].head = this->pages[i].used; // consumed in order, mark may be missing
+        this->pages[i].consumed = this->pages[i].count;
+    }
+    while(!this->pages.empty() && this->pages.front().sealed && this->pages.front().head == this->pages.front().used) {
+        this->pages.pop_front();
+    }
+
+    log_d("Recovered %u pages of partition %s (%u items)", this->pages.size(), this->label, this->unconsumed());
+    return true;
+}
+
+/**
+ * @brief Consumes all items. Pages are not erased before they are reused, so this writes a mark
+ * per page only.
+ * @return true on success, false otherwise
+ */
+bool PartitionLog::reset() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    if(this->partition == NULL) {
+        return false;
+    }
+
+    for(page_t& page : this->pages) {
+        page.sealed = true; // start a new page with the next push
+        if(page.head == page.used) {
+            continue;
+        }
+        page.head = page.used;
+        page.consumed = page.count;
+        if(!this->mark(page)) {
+            return false;
+        }
+    }
+    this->pages.clear();
+    return true;
+}
+
+/**
+ * @brief Appends the given bytes as a single entry to the newest page. A new page is started if
+ * the entry does not fit, overwriting the oldest page if the ring is full.
+ * @param buffer bytes to append
+ * @param len number of bytes in buffer, at most one page minus headers
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool PartitionLog::push(const uint8_t* buffer, size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    if(this->partition == NULL) {
+        return false;
+    }
+    if(len == 0 || len > MAX_ENTRY_LENGTH || items > UINT16_MAX) {
+        log_e("Cannot append %u bytes (%u items) to a single page", len, items);
+        return false;
+    }
+
+    // Start New Page:
+    bool full = !this->pages.empty() && (this->pages.back().end + ENTRY_SIZE + len > PARTITION_PAGE_SIZE || this->pages.back().count + items > UINT16_MAX);
+    if(this->pages.empty() || this->pages.back().sealed || full) {
+        if(!this->pages.empty()) {
+            this->pages.back().sealed = true;
+        }
+        if(!this->start()) {
+            return false;
+        }
+    }
+
+    // Build Entry Header:
+    page_t& page = this->pages.back();
+    page_entry_t entry = {
+        .length = (uint16_t)len,
+        .items = (uint16_t)items,
+        .crc = 0
+    };
+    entry.crc = esp_rom_crc32_le(0, (const uint8_t*)&entry, offsetof(page_entry_t, crc));
+    entry.crc = esp_rom_crc32_le(entry.crc, buffer, len);
+
+    // Write Bytes, Then Header:
+    size_t offset = page.sector * PARTITION_PAGE_SIZE + page.end;
+    if(esp_partition_write(this->partition, offset + ENTRY_SIZE, buffer, len) != ESP_OK ||
+       esp_partition_write(this->partition, offset, &entry, ENTRY_SIZE) != ESP_OK) {
+        log_e("Failed to write entry to sector %u", page.sector);
+        page.sealed = true; // rest of the page is not erased anymore
+        return false;
+    }
+    WriteStats.write(this->label, ENTRY_SIZE + len);
+    page.end += ALIGN_ENTRY(ENTRY_SIZE + len);
+    page.used += len;
+    page.count += items;
+    return true;
+}
+
+/**
+ * @brief Reads bytes without consuming them, starting 'offset' bytes after the oldest
+ * unconsumed byte. Reading continues with the next entry and page.
+ * @param offset number of bytes to skip
+ * @param buffer buffer to be filled, needs to hold at least 'len' bytes
+ * @param len maximum number of bytes to read
+ * @return number of bytes actually read (zero in case of error)
+ */
+size_t PartitionLog::peek(size_t offset, uint8_t* buffer, size_t len) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+
+    size_t bytes = 0;
+    for(const page_t& page : this->pages) {
+        // Skip Page:
+        size_t remaining = page.used - page.head;
+        if(offset >= remaining) {
+            offset -= remaining;
+            continue;
+        }
+
+        // Read Entries:
+        size_t base = page.sector * PARTITION_PAGE_SIZE;
+        size_t position = page.head + offset; // position within the bytes of this page
+        size_t start = 0; // position of the current entry
+        for(size_t physical = ENTRIES_OFFSET; physical < page.end && bytes < len;) {
+            page_entry_t entry;
+            if(esp_partition_read(this->partition, base + physical, &entry, ENTRY_SIZE) != ESP_OK) {
+                return bytes;
+            }
+            if(position < start + entry.length) {
+                size_t skip = position - start;
+                size_t chunk = std::min(len - bytes, entry.length - skip);
+                if(esp_partition_read(this->partition, base + physical + ENTRY_SIZE + skip, buffer + bytes, chunk) != ESP_OK) {
+                    log_e("Failed to read sector %u", page.sector);
+                    return bytes;
+                }
+                bytes += chunk;
+                position += chunk;
+            }
+            start += entry.length;
+            physical += ALIGN_ENTRY(ENTRY_SIZE + entry.length);
+        }
+        offset = 0;
+        if(bytes == len) {
+            break;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * @brief Consumes bytes from the oldest pages. The new head of every touched page is written
+ * into its next mark slot. Pages consumed entirely are reused later.
+ * @param len number of bytes to consume
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool PartitionLog::pop(size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    for(size_t i = 0; len > 0 && i < this->pages.size(); i++) {
+        page_t& page = this->pages[i];
+        size_t remainingBytes = page.used - page.head;
+        size_t remainingItems = page.count - page.consumed;
+        if(remainingBytes == 0) {
+            continue;
+        }
+
+        // Advance Head of Page:
+        size_t bytes = std::min(len, remainingBytes);
+        size_t num = bytes == remainingBytes ? remainingItems : std::min(items, remainingItems);
+        page.head += bytes;
+        page.consumed += num;
+        if(!this->mark(page)) {
+            return false;
+        }
+        len -= bytes;
+        items -= std::min(items, num);
+    }
+
+    // Release Consumed Pages:
+    while(!this->pages.empty() && this->pages.front().sealed && this->pages.front().head == this->pages.front().used) {
+        this->pages.pop_front();
+    }
+
+    if(len > 0) {
+        log_e("Consumed %u bytes more than stored in partition", len);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the number of unconsumed bytes in all pages
+ * @return number of bytes
+ */
+size_t PartitionLog::size() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    size_t bytes = 0;
+    for(const page_t& page : this->pages) {
+        bytes += page.used - page.head;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Get the number of unconsumed items in all pages
+ * @return number of items
+ */
+size_t PartitionLog::count() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return this->unconsumed();
+}
+
+/**
+ * @brief Get the number of bytes that can still be pushed before the oldest page is overwritten
+ * @return number of bytes (approximately, entry headers are not included)
+ */
+size_t PartitionLog::available() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    size_t bytes = (this->sectors - std::min(this->sectors, this->pages.size())) * (PARTITION_PAGE_SIZE - ENTRIES_OFFSET);
+    if(!this->pages.empty() && !this->pages.back().sealed) {
+        bytes += PARTITION_PAGE_SIZE - this->pages.back().end;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Get the number of unconsumed items in all pages. Call with semaphore taken.
+ * @return number of items
+ */
+size_t PartitionLog::unconsumed() {
+    size_t items = 0;
+    for(const page_t& page : this->pages) {
+        items += page.count - page.consumed;
+    }
+    return items;
+}
+
+/**
+ * @brief Erases the sector of the next page ahead of time, so starting the next page does not
+ * wait for the erase
+ * @return true on success, false otherwise
+ */
+bool PartitionLog::maintain() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    if(this->partition == NULL) {
+        return false;
+    }
+
+    uint16_t sector = this->next();
+    if(this->erased == sector || (!this->pages.empty() && this->pages.front().sector == sector)) {
+        return true; // erased already or still holding the oldest page
+    }
+    return this->erase(sector);
+}
+
+/**
+ * @brief Reads and checks the page in the given sector. The entries are scanned up to the first
+ * erased or broken entry header. Call with semaphore taken.
+ * @param sector index of the sector
+ * @param page page to be filled
+ * @return true on success, false if the sector does not hold a page of this log
+ */
+bool PartitionLog::load(uint16_t sector, page_t& page) {
+    // Read Header:
+    size_t base = sector * PARTITION_PAGE_SIZE;
+    page_header_t h;
+    if(esp_partition_read(this->partition, base, &h, HEADER_SIZE) != ESP_OK) {
+        return false;
+    }
+    if(h.magic != PARTITION_LOG_MAGIC || h.format != this->format || h.crc != esp_rom_crc32_le(0, (const uint8_t*)&h, offsetof(page_header_t, crc))) {
+        return false; // erased, unknown or torn
+    }
+    page = {
+        .sector = sector,
+        .sequence = h.sequence,
+        .end = ENTRIES_OFFSET,
+        .used = 0,
+        .head = 0,
+        .count = 0,
+        .consumed = 0,
+        .marks = 0,
+        .sealed = false
+    };
+
+    // Scan Entries:
+    uint8_t buffer[SCAN_CHUNK_SIZE];
+    while(page.end + ENTRY_SIZE <= PARTITION_PAGE_SIZE) {
+        page_entry_t entry;
+        if(esp_partition_read(this->partition, base + page.end, &entry, ENTRY_SIZE) != ESP_OK) {
+            page.sealed = true;
+            break;
+        }
+        if(entry.length == 0xFFFF && entry.items == 0xFFFF && entry.crc == 0xFFFFFFFF) {
+            break; // erased, end of entries
+        }
+        uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&entry, offsetof(page_entry_t, crc));
+        for(size_t offset = 0; offset < entry.length && page.end + ENTRY_SIZE + entry.length <= PARTITION_PAGE_SIZE; offset += sizeof(buffer)) {
+            size_t len = std::min(sizeof(buffer), (size_t)(entry.length - offset));
+            if(esp_partition_read(this->partition, base + page.end + ENTRY_SIZE + offset, buffer, len) != ESP_OK) {
+                break;
+            }
+            crc = esp_rom_crc32_le(crc, buffer, len);
+        }
+        if(entry.length == 0 || page.end + ENTRY_SIZE + entry.length > PARTITION_PAGE_SIZE || crc != entry.crc) {
+            log_w("Torn entry in sector %u at offset %u, sealing page", sector, page.end);
+            page.sealed = true;
+            break;
+        }
+        page.end += ALIGN_ENTRY(ENTRY_SIZE + entry.length);
+        page.used += entry.length;
+        page.count += entry.items;
+    }
+
+    // Read Head Marks:
+    page_mark_t marks[PARTITION_PAGE_MARKS];
+    if(esp_partition_read(this->partition, base + HEADER_SIZE, marks, sizeof(marks)) != ESP_OK) {
+        return true; // nothing consumed
+    }
+    for(size_t i = 0; i < PARTITION_PAGE_MARKS; i++) {
+        const page_mark_t& mark = marks[i];
+        if(mark.head == 0xFFFF && mark.consumed == 0xFFFF) {
+            break; // erased, no more marks
+        }
+        page.marks = i + 1;
+        if(mark.head >= page.head && mark.head <= page.used && mark.consumed >= page.consumed && mark.consumed <= page.count) {
+            page.head = mark.head; // skip torn marks
+            page.consumed = mark.consumed;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Starts a new page in the next sector. If the ring is full the oldest page is dropped,
+ * even if it was not consumed yet. Call with semaphore taken.
+ * @return true on success, false otherwise
+ */
+bool PartitionLog::start() {
+    uint16_t sector = this->next();
+
+    // Drop Oldest Page:
+    if(!this->pages.empty() && this->pages.front().sector == sector) {
+        const page_t& oldest = this->pages.front();
+        size_t unconsumed = oldest.count - oldest.consumed;
+        if(unconsumed > 0) {
+            log_w("Overwriting sector %u with %u unconsumed items", sector, unconsumed);
+        }
+        this->pages.pop_front();
+    }
+
+    // Erase Sector:
+    if(this->erased != sector && !this->erase(sector)) {
+        return false;
+    }
+    this->erased = -1;
+
+    // Write Header:
+    page_header_t h = {
+        .magic = PARTITION_LOG_MAGIC,
+        .sequence = this->sequence + 1,
+        .format = this->format,
+        .reserved = 0xFFFF,
+        .crc = 0
+    };
+    h.crc = esp_rom_crc32_le(0, (const uint8_t*)&h, offsetof(page_header_t, crc));
+    if(esp_partition_write(this->partition, sector * PARTITION_PAGE_SIZE, &h, HEADER_SIZE) != ESP_OK) {
+        log_e("Failed to write header of sector %u", sector);
+        return false;
+    }
+    WriteStats.write(this->label, HEADER_SIZE);
+
+    page_t page = {
+        .sector = sector,
+        .sequence = h.sequence,
+        .end = ENTRIES_OFFSET,
+        .used = 0,
+        .head = 0,
+        .count = 0,
+        .consumed = 0,
+        .marks = 0,
+        .sealed = false
+    };
+    this->pages.push_back(page);
+    this->sequence = h.sequence;
+    this->tail = sector;
+    return true;
+}
+
+/**
+ * @brief Erases the given sector. Call with semaphore taken.
+ * @param sector index of the sector
+ * @return true on success, false otherwise
+ */
+bool PartitionLog::erase(uint16_t sector) {
+    if(esp_partition_erase_range(this->partition, sector * PARTITION_PAGE_SIZE, PARTITION_PAGE_SIZE) != ESP_OK) {
+        log_e("Failed to erase sector %u", sector);
+        return false;
+    }
+    WriteStats.erase(this->label);
+    this->erased = sector;
+    return true;
+}
+
+/**
+ * @brief Writes the head of the given page into its next free mark slot. The last slot is kept
+ * for marking a sealed page as consumed entirely. Without a free slot the head is only kept in
+ * RAM, so the items are consumed again after a reboot. Call with semaphore taken.
+ * @param page page to write the head of
+ * @return true on success, false otherwise
+ */
+bool PartitionLog::mark(page_t& page) {
+    bool final = page.sealed && page.head == page.used;
+    if(page.marks >= PARTITION_PAGE_MARKS || (page.marks == PARTITION_PAGE_MARKS - 1 && !final)) {
+        log_d("No mark left in sector %u, head is kept in RAM only", page.sector);
+        return true;
+    }
+    page_mark_t mark = {
+        .head = page.head,
+        .consumed = page.consumed
+    };
+    size_t offset = page.sector * PARTITION_PAGE_SIZE + HEADER_SIZE + page.marks * sizeof(page_mark_t);
+    if(esp_partition_write(this->partition, offset, &mark, sizeof(mark)) != ESP_OK) {
+        log_e("Failed to write mark of sector %u", page.sector);
+        return false;
+    }
+    WriteStats.write(this->label, sizeof(mark));
+    page.marks++;
+    return true;
+}
+
+/**
+ * @brief Get the sector of the next page. Call with semaphore taken.
+ * @return index of the sector
+ */
+uint16_t PartitionLog::next() {
+    return (this->tail + 1) % this->sectors;
+}
@@ -0,0 +1,75 @@
+#ifndef PARTITION_LOG_H
+#define PARTITION_LOG_H
+
+#include <deque>
+#include "Arduino.h"
+#include "esp_partition.h"
+#include "RecordStore.h"
+
+#define PARTITION_LOG_MAGIC 0x474F4C50 // "PLOG" in little endian byte order
+#define PARTITION_LOG_TYPE 0x40 // custom partition type, see "partitions_datalog.csv"
+#define PARTITION_PAGE_SIZE 4096 // one flash sector, the unit of erasing
+#define PARTITION_PAGE_MARKS 31 // number of head marks per page, the last one is kept to mark the page consumed
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;     // identifies a written page
+    uint32_t sequence;  // increases with every page started, finds the order after reboot
+    uint16_t format;    // format of the items, defined by the owner of the log
+    uint16_t reserved;
+    uint32_t crc;       // CRC32 of the fields above
+} page_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t head;      // number of bytes consumed, written once per slot (erased = 0xFFFF)
+    uint16_t consumed;  // number of items consumed
+} page_mark_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t length;    // number of bytes following this header (erased = 0xFFFF)
+    uint16_t items;     // number of items the bytes represent
+    uint32_t crc;       // CRC32 of length, items and bytes
+} page_entry_t;
+
+typedef struct {
+    uint16_t sector;    // index of the sector within the partition
+    uint32_t sequence;
+    uint16_t end;       // offset of the next entry within the sector
+    uint16_t used;      // number of bytes appended
+    uint16_t head;      // number of bytes consumed
+    uint16_t count;     // number of items appended
+    uint16_t consumed;  // number of items consumed
+    uint8_t marks;      // number of head marks written
+    bool sealed;        // no more entries are appended
+} page_t;
+
+class PartitionLog : public RecordStore {
+public:
+    PartitionLog(const char* label, uint16_t format);
+    bool check() override;
+    bool reset() override;
+    bool push(const uint8_t* buffer, size_t len, size_t items) override;
+    size_t peek(size_t offset, uint8_t* buffer, size_t len) override;
+    bool pop(size_t len, size_t items) override;
+    size_t size() override;
+    size_t count() override;
+    size_t available() override;
+    bool maintain() override;
+private:
+    const char* label; // label of the data partition
+    uint16_t format;
+    const esp_partition_t* partition;
+    size_t sectors; // number of sectors in the partition
+    std::deque<page_t> pages; // oldest page first
+    uint32_t sequence; // sequence number of the newest page
+    uint16_t tail; // sector of the newest page
+    int32_t erased; // sector erased ahead of time, -1 if none
+    SemaphoreHandle_t semaphore;
+    bool load(uint16_t sector, page_t& page);
+    bool start();
+    bool erase(uint16_t sector);
+    bool mark(page_t& page);
+    uint16_t next();
+    size_t unconsumed();
+};
+
+#endif /* PARTITION_LOG_H */
@@ -0,0 +1,543 @@
+#ifndef RECORD_LOG_H
+#define RECORD_LOG_H
+
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "Arduino.h"
+#include "FileManager.h"
+#include "RecordStore.h"
+
+#define RECORD_LOG_DROP_BATCH 16 // number of the oldest records dropped at once if the store is full
+
+/**
+ * [INFO]
+ * A record log keeps typed records of type T in a record store, encoded by the codec. It holds the
+ * logic shared by all files of records: appending, exporting the oldest records in batches and
+ * stripping them once they were synced, scanning, recovering from corrupted bytes and migrating
+ * the text files of previous firmware versions. Staging records in RAM is left to the store (see
+ * 'AppendBuffer'). The codec is a template parameter, so its functions are called directly and
+ * only the functions a file actually uses are compiled. It needs to provide:
+ *
+ *  static constexpr size_t CHUNK_SIZE;  bytes read from the store at once, holds an entire unit
+ *  static constexpr size_t UNIT_LENGTH; maximum number of records per unit (frame or record)
+ *  static bool encode(const T* records, size_t num, std::vector<uint8_t>& buffer);
+ *  static size_t decode(const uint8_t* buffer, size_t len, size_t max, const std::function<bool(const T& record)>& callback, bool& corrupt);
+ *  static size_t resync(const uint8_t* buffer, size_t len, size_t& items);
+ *  static bool parse(std::string_view line, T& record); (only if 'migrate()' is used)
+ *
+ * Encoded records are grouped in units, which are only decoded entirely. 'decode()' decodes the
+ * units at the beginning of the buffer as long as they fit into 'max' records and returns their
+ * number of bytes. It sets 'corrupt' if it stops at a corrupted unit, 'resync()' then returns the
+ * number of bytes to skip and the number of records they held, as far as known. Records are
+ * exported in entire units, so at least UNIT_LENGTH records are exported at once.
+ *
+ * A record log is not synchronized, its owner serializes the access.
+ */
+
+template<typename T, typename Codec>
+class RecordLog {
+public:
+    typedef std::function<bool(const T& record)> visitor_t;
+    RecordLog(RecordStore& store, const char* name, bool evict = false);
+    bool begin();
+    bool append(const T* records, size_t num);
+    bool push(const std::vector<uint8_t>& buffer, size_t num);
+    size_t exportRecords(size_t max, const visitor_t& callback);
+    bool shrink(size_t num, bool partial);
+    bool scan(size_t offset, const visitor_t& callback);
+    bool scan(size_t& offset, size_t& visited, const visitor_t& callback);
+    bool recover();
+    bool clear();
+    bool migrate(fs::FS& fs, const char* legacyPath, size_t batch, size_t start, const std::function<bool(const std::vector<T>& records)>& append, const std::function<void(size_t lines)>& progress);
+    size_t count();
+    size_t size();
+    uint32_t front();
+    RecordStore& store();
+private:
+    RecordStore& file;
+    const char* name; // name used in log messages, e.g. "data file"
+    bool evict; // drop the oldest records if the store is full
+    std::vector<uint8_t> encoded; // bytes of the records appended last, kept to reuse the memory
+    size_t exportedItems; // number of records of the last export, zero if stopped by the callback
+    size_t exportedBytes; // number of bytes these records take in the store
+    uint32_t appended; // number of bytes ever pushed since boot (wraps around), see 'front()'
+    size_t read(size_t max, const visitor_t& callback, size_t& items);
+    bool makeRoom(size_t len);
+};
+
+/**
+ * Constructor initializes a record log on top of the given store
+ * @param store store holding the encoded records
+ * @param name name of the file used in log messages (e.g. "log file")
+ * @param evict drop the oldest records if the store is full, instead of failing to append
+ */
+template<typename T, typename Codec>
+RecordLog<T, Codec>::RecordLog(RecordStore& store, const char* name, bool evict) : file(store), name(name), evict(evict) {
+    this->exportedItems = 0;
+    this->exportedBytes = 0;
+    this->appended = 0;
+}
+
+/**
+ * @brief Checks the store and resets it if it is broken or not found
+ * @return true on success, false otherwise
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::begin() {
+    if(this->file.check()) {
+        log_d("Reusing existing %s (file passed check)", this->name);
+        return true;
+    }
+    log_w("The %s is broken or not found, resetting it", this->name);
+    if(!this->file.reset()) {
+        log_e("Could not reset %s", this->name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Encodes the given records and appends them to the store in a single push
+ * @param records records to append, oldest first
+ * @param num number of records
+ * @return true on success, false otherwise
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::append(const T* records, size_t num) {
+    this->encoded.clear();
+    if(!Codec::encode(records, num, this->encoded)) {
+        log_e("Failed to encode %u records of %s", num, this->name);
+        return false;
+    }
+    return this->push(this->encoded, num);
+}
+
+/**
+ * @brief Appends records encoded by the codec to the store in a single push. If the log evicts,
+ * the oldest records are dropped first to make room.
+ * @param buffer encoded records
+ * @param num number of records in buffer
+ * @return true on success, false otherwise
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::push(const std::vector<uint8_t>& buffer, size_t num) {
+    if(this->evict && !this->makeRoom(buffer.size())) {
+        return false;
+    }
+    if(!this->file.push(buffer.data(), buffer.size(), num)) {
+        return false;
+    }
+    this->appended += buffer.size();
+    return true;
+}
+
+/**
+ * @brief Calls the given callback for the oldest records, one at a time, without consuming them.
+ * Strip the records with 'shrink()' once they were processed.
+ * @param max maximum number of records to visit, at least Codec::UNIT_LENGTH
+ * @param callback function called with each record, returns false to stop
+ * @return number of records passed to the callback (zero if none or in case of error)
+ */
+template<typename T, typename Codec>
+size_t RecordLog<T, Codec>::exportRecords(size_t max, const visitor_t& callback) {
+    if(max < Codec::UNIT_LENGTH) {
+        log_e("Cannot export %u records of %s, records are exported in units of %u", max, this->name, Codec::UNIT_LENGTH);
+        return 0;
+    }
+    size_t visited = 0;
+    bool stopped = false;
+    auto visitor = [&visited, &stopped, &callback](const T& record) {
+        visited++;
+        stopped = !callback(record);
+        return !stopped;
+    };
+    size_t items;
+    size_t bytes = this->read(max, visitor, items);
+    this->exportedItems = stopped ? 0 : items; // bytes do not cover the unit the callback stopped in
+    this->exportedBytes = stopped ? 0 : bytes;
+    return visited;
+}
+
+/**
+ * @brief Strips the oldest 'num' records. If 'num' is the number of records of the last export,
+ * the bytes found by it are stripped right away, otherwise the records are read again.
+ * @param num number of records to strip
+ * @param partial strip only the entire units within the first 'num' records, the remaining
+ * records are exported again. Otherwise fail if 'num' ends within a unit.
+ * @return true on success, false otherwise
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::shrink(size_t num, bool partial) {
+    log_d("shrink %s by %u records", this->name, num);
+    size_t bytes = this->exportedBytes;
+    size_t items = num;
+    if(num != this->exportedItems) { // find the end of the records again
+        bytes = this->read(num, [](const T& record) { return true; }, items);
+        if(items != num && !partial) {
+            log_e("Cannot shrink %s by %u records, records are stored in units of %u", this->name, num, Codec::UNIT_LENGTH);
+            return false;
+        }
+        if(items != num) {
+            log_d("Keeping %u records of a partially exported unit", num - items);
+        }
+    }
+    this->exportedItems = 0;
+    this->exportedBytes = 0;
+    if(items > 0 && !this->file.pop(bytes, items)) {
+        log_e("Failed to shrink %s", this->name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads and decodes records from the given offset on and calls the callback for each of
+ * them, without consuming anything. Corrupted units are skipped.
+ * @param offset offset within the store to start reading at, needs not be the start of a unit
+ * @param callback function called with each record, returns false to stop reading
+ * @return true if the end of the store was reached, false if stopped by the callback
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::scan(size_t offset, const visitor_t& callback) {
+    size_t visited = 0;
+    return this->scan(offset, visited, callback);
+}
+
+/**
+ * @brief Like 'scan()', but resumable: reading stops where the callback stopped and continues
+ * there with the next call
+ * @param offset offset within the store to start reading at, advanced to the beginning of the
+ * chunk the callback stopped in (or to the end of the records)
+ * @param visited number of records after 'offset' visited already, these are skipped. Updated
+ * accordingly, the record the callback returns false for does not count as visited.
+ * @param callback function called with each record, returns false to stop reading
+ * @return true if the end of the store was reached, false if stopped by the callback
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::scan(size_t& offset, size_t& visited, const visitor_t& callback) {
+    uint8_t buffer[Codec::CHUNK_SIZE];
+    bool stopped = false;
+    size_t index = 0; // records decoded after 'offset'
+    auto visitor = [&stopped, &callback, &index, &visited](const T& record) {
+        if(index < visited) {
+            index++;
+            return true; // visited by a previous call
+        }
+        stopped = !callback(record);
+        index += stopped ? 0 : 1;
+        return !stopped;
+    };
+    while(!stopped) {
+        // Read Chunk:
+        size_t len = this->file.peek(offset, buffer, sizeof(buffer));
+        if(len == 0) {
+            break; // no more records
+        }
+
+        // Decode Records:
+        bool corrupt;
+        index = 0;
+        size_t bytes = Codec::decode(buffer, len, SIZE_MAX, visitor, corrupt);
+        if(stopped) {
+            visited = index; // units are decoded entirely, continue at this chunk
+            break;
+        }
+        visited -= std::min(visited, index);
+        if(bytes > 0) {
+            offset += bytes;
+            continue;
+        }
+        if(!corrupt) {
+            break; // incomplete unit at the end
+        }
+
+        // Skip Corrupted Bytes:
+        size_t lost;
+        offset += Codec::resync(buffer, len, lost);
+    }
+    return !stopped;
+}
+
+/**
+ * @brief Checks every record and drops only what cannot be decoded, instead of clearing the whole
+ * store. Corrupted units at the beginning are dropped right away. Corrupted units further back are
+ * skipped with the next unit that is intact, once they reach the beginning (see 'read()'). Torn
+ * writes are not expected, because the stores only count entirely written pushes, but an
+ * incomplete unit at the end is reported as well.
+ * @return true if the store holds no corrupted records (anymore), false otherwise
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::recover() {
+    uint8_t buffer[Codec::CHUNK_SIZE];
+    size_t offset = 0; // bytes checked so far
+    size_t items = 0; // intact records
+    size_t corrupted = 0; // bytes of corrupted units further back
+    auto counter = [&items](const T& record) {
+        items++;
+        return true;
+    };
+    this->exportedItems = 0;
+    this->exportedBytes = 0;
+    while(true) {
+        // Read Chunk:
+        size_t len = this->file.peek(offset, buffer, sizeof(buffer));
+        if(len == 0) {
+            break; // checked all records
+        }
+
+        // Check Records:
+        bool corrupt;
+        size_t bytes = Codec::decode(buffer, len, SIZE_MAX, counter, corrupt);
+        if(bytes > 0) {
+            offset += bytes;
+            continue;
+        }
+        if(!corrupt) {
+            log_w("The %s ends with an incomplete unit [%u bytes]", this->name, len);
+            corrupted += len;
+            break;
+        }
+
+        // Skip Corrupted Bytes:
+        size_t lost;
+        size_t skip = Codec::resync(buffer, len, lost);
+        if(offset > 0) {
+            corrupted += skip;
+            offset += skip;
+            continue;
+        }
+        lost = std::min(lost, this->file.count()); // records counted by the store
+        log_w("Dropping %u corrupted bytes [%u records] at the beginning of the %s", skip, lost, this->name);
+        if(!this->file.pop(skip, lost)) {
+            log_e("Failed to drop corrupted bytes");
+            return false;
+        }
+    }
+
+    // Report Result:
+    size_t count = this->file.count();
+    if(items != count) {
+        log_w("The %s counts %u records, but holds %u intact records", this->name, count, items);
+    }
+    if(corrupted > 0) {
+        log_w("Skipping %u corrupted bytes once they reach the beginning of the %s", corrupted, this->name);
+        return false;
+    }
+    log_i("The %s holds %u intact records", this->name, items);
+    return true;
+}
+
+/**
+ * @brief Drops all records
+ * @return true on success, false otherwise
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::clear() {
+    this->exportedItems = 0;
+    this->exportedBytes = 0;
+    if(!this->file.reset()) {
+        log_e("Could not reset %s", this->name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Converts the text lines of the given legacy file into records (see 'Codec::parse()'),
+ * appends them in batches and deletes the legacy file afterwards. Lines failing to parse are
+ * skipped and counted. Once a batch is appended and flushed, the number of lines read so far is
+ * reported, so a migration interrupted by an error or a reboot resumes after the last batch
+ * instead of appending its records again.
+ * @param fs file system holding the legacy file
+ * @param legacyPath path of the legacy file (e.g. "/data.txt")
+ * @param batch number of lines converted at once
+ * @param start number of lines converted by an interrupted migration, these are skipped
+ * @param append function appending a batch of records (e.g. also updating an index)
+ * @param progress function persisting the number of lines converted, called with 0 once the
+ * legacy file is deleted
+ * @return true on success, false otherwise
+ * @note This is intended to run only once after updating from a firmware storing text lines
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::migrate(fs::FS& fs, const char* legacyPath, size_t batch, size_t start, const std::function<bool(const std::vector<T>& records)>& append, const std::function<void(size_t lines)>& progress) {
+    FileManager legacyFile(fs, legacyPath);
+    if(start > 0) {
+        log_i("Resuming migration of %s after line %u", legacyPath, start);
+    }
+
+    // Convert Lines in Batches:
+    std::vector<T> records;
+    records.reserve(batch);
+    size_t lines = 0; // lines read so far, including the ones converted before
+    size_t converted = 0;
+    size_t skipped = 0;
+    bool success = true;
+    auto commit = [this, &records, &lines, &converted, &append, &progress]() {
+        if(!append(records) || !this->file.flush()) {
+            return false;
+        }
+        progress(lines); // records are stored, never append them again
+        converted += records.size();
+        records.clear();
+        return true;
+    };
+    bool read = legacyFile.forEachLine([&records, &lines, &skipped, &success, &commit, start, batch](std::string_view line) {
+        if(++lines <= start) {
+            return true; // converted by an interrupted migration
+        }
+
+        // Parse Line:
+        T record;
+        if(Codec::parse(line, record)) {
+            records.push_back(record);
+        } else if(!line.empty()) {
+            log_w("Skipping malformed line %u of legacy file: %.*s", lines, (int)line.size(), line.data());
+            skipped++;
+        }
+
+        // Append Batch:
+        if(records.size() >= batch) {
+            success = commit();
+        }
+        return success;
+    });
+    if(read && success && records.size() > 0) { // append last batch
+        success = commit();
+    }
+    if(!read || !success) {
+        log_e("Failed to convert legacy file %s", legacyPath);
+        return false;
+    }
+
+    // Delete Legacy File:
+    if(!legacyFile.remove()) {
+        log_e("Failed to delete legacy file %s", legacyPath);
+        return false;
+    }
+    progress(0);
+
+    log_i("Migrated %u records from %s (%u malformed lines skipped)", converted, legacyPath, skipped);
+    return true;
+}
+
+/**
+ * @brief Get the number of records
+ * @return number of records, kept as counter by the store
+ */
+template<typename T, typename Codec>
+size_t RecordLog<T, Codec>::count() {
+    return this->file.count();
+}
+
+/**
+ * @brief Get the number of bytes the records take in the store
+ * @return number of bytes
+ */
+template<typename T, typename Codec>
+size_t RecordLog<T, Codec>::size() {
+    return this->file.size();
+}
+
+/**
+ * @brief Get the position of the oldest byte, counted in bytes ever pushed since boot. Positions
+ * stay valid while the front is consumed: the offset of a position within the store is the
+ * position minus the front. Consumed positions give negative offsets.
+ * @return position of the oldest byte (wraps around)
+ */
+template<typename T, typename Codec>
+uint32_t RecordLog<T, Codec>::front() {
+    return this->appended - (uint32_t)this->file.size();
+}
+
+/**
+ * @brief Get the underlying store, e.g. to maintain or flush it
+ * @return record store
+ */
+template<typename T, typename Codec>
+RecordStore& RecordLog<T, Codec>::store() {
+    return this->file;
+}
+
+/**
+ * @brief Reads and decodes records from the beginning of the store chunk by chunk and calls the
+ * callback for each of them. Corrupted units at the beginning are dropped. If nothing can be read
+ * from the non-empty store at all, it is reset.
+ * @param max maximum number of records to read
+ * @param callback function called with each record, returns false to stop reading
+ * @param items number of records read, only those of entirely decoded units unless stopped by
+ * the callback
+ * @return number of bytes the entirely decoded units take in the store
+ */
+template<typename T, typename Codec>
+size_t RecordLog<T, Codec>::read(size_t max, const visitor_t& callback, size_t& items) {
+    uint8_t buffer[Codec::CHUNK_SIZE];
+    size_t offset = 0; // bytes decoded so far
+    size_t decoded = 0; // records passed to the callback by the current chunk
+    bool stopped = false;
+    items = 0;
+    auto counter = [&decoded, &stopped, &callback](const T& record) {
+        decoded++;
+        stopped = !callback(record);
+        return !stopped;
+    };
+    while(items < max && !stopped) {
+        // Read Chunk:
+        size_t len = this->file.peek(offset, buffer, sizeof(buffer));
+        if(len == 0) {
+            break; // no more records
+        }
+
+        // Decode Records:
+        bool corrupt;
+        decoded = 0;
+        size_t bytes = Codec::decode(buffer, len, max - items, counter, corrupt);
+        items += decoded;
+        if(bytes > 0) {
+            offset += bytes;
+            continue;
+        }
+        if(!corrupt || offset > 0) {
+            break; // unit does not fit, stopped by callback or corrupted unit dropped by next read
+        }
+
+        // Skip Corrupted Bytes:
+        size_t lost;
+        size_t skip = Codec::resync(buffer, len, lost);
+        lost = std::min(lost, this->file.count()); // records counted by the store
+        log_w("Dropping %u corrupted bytes [%u records] at the beginning of the %s", skip, lost, this->name);
+        if(!this->file.pop(skip, lost)) {
+            break;
+        }
+    }
+
+    // Sanity Check:
+    if(offset == 0 && this->file.size() == 0 && this->file.count() > 0) {
+        log_i("Resetting corrupted %s", this->name);
+        this->file.reset();
+    }
+    return offset;
+}
+
+/**
+ * @brief Drops the oldest records until 'len' bytes can be appended
+ * @param len number of bytes to append
+ * @return true on success, false otherwise
+ */
+template<typename T, typename Codec>
+bool RecordLog<T, Codec>::makeRoom(size_t len) {
+    while(this->file.available() < len && this->file.size() > 0) {
+        size_t dropped;
+        size_t bytes = this->read(std::max((size_t)RECORD_LOG_DROP_BATCH, (size_t)Codec::UNIT_LENGTH), [](const T& record) { return true; }, dropped);
+        log_d("The %s is full, dropping %u oldest records", this->name, dropped);
+        if(bytes == 0 || !this->file.pop(bytes, dropped)) {
+            log_e("Failed to drop oldest records of %s", this->name);
+            return false;
+        }
+        this->exportedItems = 0; // last export is out of date
+        this->exportedBytes = 0;
+    }
+    return true;
+}
+
+#endif /* RECORD_LOG_H */
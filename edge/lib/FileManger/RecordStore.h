@@ -0,0 +1,28 @@
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Interface of a persistent first-in-first-out queue of encoded items. Items are pushed as
+ * bytes at the tail and consumed from the head once they were processed. An item never spans two
+ * calls of 'push()', so the store may split the bytes of different pushes across files.
+ */
+class RecordStore {
+public:
+    virtual ~RecordStore() {}
+    virtual bool check() = 0;
+    virtual bool reset() = 0;
+    virtual bool push(const uint8_t* buffer, size_t len, size_t items) = 0;
+    virtual size_t peek(size_t offset, uint8_t* buffer, size_t len) = 0;
+    virtual bool pop(size_t len, size_t items) = 0;
+    virtual size_t size() = 0;
+    virtual size_t count() = 0;
+    virtual size_t available() = 0;
+    virtual bool maintain() { return true; } // background work of the store, called after pushing
+    virtual bool flush() { return true; } // commits bytes the store holds back in RAM, e.g. before a reboot
+    virtual size_t tail() { return 0; } // file offset the next push is written at, 0 if unknown
+};
+
+#endif /* RECORD_STORE_H */
@@ -0,0 +1,254 @@
+#include "RingFile.h"
+#include "CriticalRuntime.h"
+
+#define HEADER_SIZE sizeof(ring_file_header_t)
+
+/**
+ * @brief Constructor initializes a ring file with a data region of fixed size. Items are
+ * appended at the tail and consumed from the head, so consuming items only updates the header
+ * instead of copying the remaining data.
+ * @param fs file system holding the file
+ * @param path file name of the ring file (e.g. "/data.bin")
+ * @param capacity size of the data region in bytes
+ * @param format format of the items, checked when reusing an existing file
+ */
+RingFile::RingFile(fs::FS& fs, const std::string& path, size_t capacity, uint16_t format) : file(fs, path) {
+    this->header = {
+        .magic = RING_FILE_MAGIC,
+        .version = RING_FILE_VERSION,
+        .format = format,
+        .capacity = (uint32_t)capacity,
+        .head = 0,
+        .used = 0,
+        .count = 0
+    };
+    this->semaphore = xSemaphoreCreateMutex();
+    if(semaphore == NULL) {
+        log_e("Not enough heap to use ring file semaphore.");
+    }
+}
+
+/**
+ * @brief Reads the header of the existing file and checks if it matches the layout, capacity and
+ * item format of this ring file. On success the header is used from now on.
+ * @return true on success, false otherwise
+ */
+bool RingFile::check() {
+    if(!this->file.check()) {
+        return false; // file does not exist
+    }
+
+    // Read Header:
+    ring_file_header_t h;
+    if(this->file.read(0, (uint8_t*)&h, HEADER_SIZE) != HEADER_SIZE) {
+        log_w("Ring file too short to hold a header");
+        return false;
+    }
+
+    // Check Header:
+    if(h.magic != RING_FILE_MAGIC || h.version != RING_FILE_VERSION) {
+        log_w("Ring file has unknown layout (magic = 0x%08X, version = %u)", h.magic, h.version);
+        return false;
+    }
+    if(h.format != this->header.format || h.capacity != this->header.capacity) {
+        log_w("Ring file has unexpected format %u (capacity = %u bytes)", h.format, h.capacity);
+        return false;
+    }
+    if(h.head >= h.capacity || h.used > h.capacity) {
+        log_w("Ring file has invalid offsets (head = %u, used = %u)", h.head, h.used);
+        return false;
+    }
+
+    // Use Header:
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    this->header = h;
+    return true;
+}
+
+/**
+ * @brief Creates a new (empty) ring file. Deletes any content if the file already exists
+ * @return true on success, false otherwise
+ */
+bool RingFile::reset() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Write Empty File:
+    ring_file_header_t h = this->header;
+    h.head = 0;
+    h.used = 0;
+    h.count = 0;
+    if(!this->file.write((const uint8_t*)&h, HEADER_SIZE)) {
+        log_e("Could not write header of ring file");
+        return false;
+    }
+
+    this->header = h;
+    return true;
+}
+
+/**
+ * @brief Appends the given bytes at the tail of the ring. The bytes are wrapped around to the
+ * beginning of the data region if necessary. Nothing is written if the bytes do not fit.
+ * @param buffer bytes to append
+ * @param len number of bytes in buffer
+ * @param items number of items the bytes represent
+ * @return true on success, false if the ring is full or on failure
+ */
+bool RingFile::push(const uint8_t* buffer, size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Check Free Space:
+    ring_file_header_t h = this->header;
+    if(h.capacity - h.used < len) {
+        log_w("Ring file is full [%u/%u bytes used]", h.used, h.capacity);
+        return false;
+    }
+
+    // Write Bytes Up To End of Data Region:
+    size_t tail = (h.head + h.used) % h.capacity;
+    size_t first = std::min(len, (size_t)h.capacity - tail);
+    if(!this->file.write(HEADER_SIZE + tail, buffer, first)) {
+        log_e("Failed to write to ring file");
+        return false;
+    }
+
+    // Write Wrapped Bytes to Beginning of Data Region:
+    if(first < len) {
+        if(!this->file.write(HEADER_SIZE, buffer + first, len - first)) {
+            log_e("Failed to write wrapped bytes to ring file");
+            return false;
+        }
+    }
+
+    // Commit Bytes:
+    h.used += len;
+    h.count += items;
+    return this->writeHeader(h);
+}
+
+/**
+ * @brief Reads bytes from the ring without consuming them, starting 'offset' bytes after the
+ * head. Reading stops at the tail of the ring.
+ * @param offset number of bytes to skip after the head
+ * @param buffer buffer to be filled, needs to hold at least 'len' bytes
+ * @param len maximum number of bytes to read
+ * @return number of bytes actually read (zero in case of error)
+ */
+size_t RingFile::peek(size_t offset, uint8_t* buffer, size_t len) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+
+    // Limit to Stored Bytes:
+    const ring_file_header_t& h = this->header;
+    if(offset >= h.used) {
+        return 0;
+    }
+    len = std::min(len, (size_t)h.used - offset);
+
+    // Read Bytes Up To End of Data Region:
+    size_t start = (h.head + offset) % h.capacity;
+    size_t first = std::min(len, (size_t)h.capacity - start);
+    size_t bytes = this->file.read(HEADER_SIZE + start, buffer, first);
+    if(bytes < first) {
+        return bytes;
+    }
+
+    // Read Wrapped Bytes From Beginning of Data Region:
+    if(first < len) {
+        bytes += this->file.read(HEADER_SIZE, buffer + first, len - first);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Consumes bytes at the head of the ring. Only the header is written, the data itself is
+ * left in place and overwritten by later pushes.
+ * @param len number of bytes to consume
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool RingFile::pop(size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Check Stored Bytes:
+    ring_file_header_t h = this->header;
+    if(len > h.used || items > h.count) {
+        log_e("Cannot consume %u bytes (%u items) from ring holding %u bytes (%u items)", len, items, h.used, h.count);
+        return false;
+    }
+
+    // Advance Head:
+    h.head = (h.head + len) % h.capacity;
+    h.used -= len;
+    h.count -= items;
+    if(h.used == 0) {
+        h.head = 0; // start over at the beginning of the data region
+        h.count = 0; // items of dropped corrupted bytes are unknown
+    }
+    return this->writeHeader(h);
+}
+
+/**
+ * @brief Get the number of bytes stored in the ring
+ * @return number of bytes
+ */
+size_t RingFile::size() {
+    return this->header.used;
+}
+
+/**
+ * @brief Get the number of items stored in the ring
+ * @return number of items
+ */
+size_t RingFile::count() {
+    return this->header.count;
+}
+
+/**
+ * @brief Get the number of bytes that can still be pushed to the ring
+ * @return number of bytes
+ */
+size_t RingFile::available() {
+    return this->header.capacity - this->header.used;
+}
+
+/**
+ * @brief Get the file offset the next pushed byte is written at
+ * @return byte offset in the file
+ */
+size_t RingFile::tail() {
+    return HEADER_SIZE + (this->header.head + this->header.used) % this->header.capacity;
+}
+
+/**
+ * @brief Writes the given header to disk and uses it on success. Call with semaphore taken.
+ * @param h header to write
+ * @return true on success, false otherwise
+ */
+bool RingFile::writeHeader(const ring_file_header_t& h) {
+    if(!this->file.write(0, (const uint8_t*)&h, HEADER_SIZE)) {
+        log_e("Failed to write header of ring file");
+        return false;
+    }
+    this->header = h;
+    return true;
+}
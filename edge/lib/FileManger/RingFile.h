@@ -0,0 +1,39 @@
+#ifndef RING_FILE_H
+#define RING_FILE_H
+
+#include "FileManager.h"
+#include "RecordStore.h"
+
+#define RING_FILE_MAGIC 0x474E4952 // "RING" in little endian byte order
+#define RING_FILE_VERSION 1
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;     // identifies a ring file
+    uint16_t version;   // layout version of the ring file
+    uint16_t format;    // format of the items, defined by the owner of the file
+    uint32_t capacity;  // size of the data region in bytes
+    uint32_t head;      // offset of the oldest byte in the data region
+    uint32_t used;      // number of bytes stored in the data region
+    uint32_t count;     // number of items stored in the data region
+} ring_file_header_t;
+
+class RingFile : public RecordStore {
+public:
+    RingFile(fs::FS& fs, const std::string& path, size_t capacity, uint16_t format);
+    bool check() override;
+    bool reset() override;
+    bool push(const uint8_t* buffer, size_t len, size_t items) override;
+    size_t peek(size_t offset, uint8_t* buffer, size_t len) override;
+    bool pop(size_t len, size_t items) override;
+    size_t size() override;
+    size_t count() override;
+    size_t available() override;
+    size_t tail() override;
+private:
+    FileManager file;
+    ring_file_header_t header; // copy of the header on disk
+    SemaphoreHandle_t semaphore;
+    bool writeHeader(const ring_file_header_t& header);
+};
+
+#endif /* RING_FILE_H */
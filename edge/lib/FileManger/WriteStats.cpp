@@ -0,0 +1,146 @@
+#include "WriteStats.h"
+#include "CriticalRuntime.h"
+
+/**
+ * [INFO]
+ * Counts the writes to flash by owner since boot, so write amplification can be measured and the
+ * flash lifetime projected from the real workload. The counters are only kept in RAM, persisting
+ * them would wear the flash they measure. Divide by 'uptime()' to get rates.
+ */
+
+/**
+ * @brief Constructor initializes empty counters and creates a semaphore to be ready for multi
+ * process usage.
+ */
+WriteStatsClass::WriteStatsClass() {
+    memset(this->owners, 0, sizeof(this->owners));
+    this->used = 0;
+    this->semaphore = xSemaphoreCreateMutex();
+    if(semaphore == NULL) {
+        log_e("Not enough heap to use write stats semaphore.");
+    }
+}
+
+/**
+ * @brief Counts bytes appended to or overwritten in a file or partition
+ * @param owner name of the owner, see 'ownerOf()'
+ * @param bytes number of bytes written
+ */
+void WriteStatsClass::write(const char* owner, size_t bytes) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        return; // statistics only, never block the writer
+    }
+    write_stats_t* stats = this->find(owner);
+    stats->bytes += bytes;
+    stats->writes++;
+}
+
+/**
+ * @brief Counts a file rewritten entirely by copying its bytes into a new file
+ * @param owner name of the owner, see 'ownerOf()'
+ * @param bytes number of bytes copied
+ */
+void WriteStatsClass::rewrite(const char* owner, size_t bytes) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        return;
+    }
+    write_stats_t* stats = this->find(owner);
+    stats->rewrites++;
+    stats->rewritten += bytes;
+}
+
+/**
+ * @brief Counts flash sectors erased
+ * @param owner name of the owner, see 'ownerOf()'
+ * @param sectors number of sectors erased
+ */
+void WriteStatsClass::erase(const char* owner, size_t sectors) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        return;
+    }
+    this->find(owner)->erases += sectors;
+}
+
+/**
+ * @brief Counts commits of values to the NVS (preferences)
+ * @param owner name of the owner (e.g. "nvs:job")
+ * @param bytes number of bytes of the values
+ * @param commits number of values committed, each one is committed on its own
+ */
+void WriteStatsClass::commit(const char* owner, size_t bytes, size_t commits) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        return;
+    }
+    write_stats_t* stats = this->find(owner);
+    stats->bytes += bytes;
+    stats->commits += commits;
+}
+
+/**
+ * @brief Copies the counters of all owners into the given vector
+ * @param stats vector to be filled, cleared first
+ * @return true on success, false otherwise
+ */
+bool WriteStatsClass::snapshot(std::vector<write_stats_t>& stats) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    stats.assign(this->owners, this->owners + this->used);
+    return true;
+}
+
+/**
+ * @brief Get the time the counters cover
+ * @return seconds since boot
+ */
+uint32_t WriteStatsClass::uptime() {
+    return millis() / 1000;
+}
+
+/**
+ * @brief Derives the owner of a file from its path: the first path component up to the first '.'
+ * or '_', so segments, sidecar and temporary files count for the file they belong to (e.g.
+ * "/data_2025-04-16_00.bin" and "/data.idx" for "data", "/log.bin.meta" for "log").
+ * @param path absolute path of the file
+ * @return owner name, truncated to WRITE_STATS_OWNER_LENGTH - 1 characters
+ */
+std::string WriteStatsClass::ownerOf(const std::string& path) {
+    size_t start = path.find_first_not_of('/');
+    if(start == std::string::npos) {
+        return WRITE_STATS_OTHER;
+    }
+    size_t end = path.find_first_of("/._", start);
+    std::string owner = path.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    return owner.substr(0, WRITE_STATS_OWNER_LENGTH - 1);
+}
+
+/**
+ * @brief Finds the counters of the given owner. Unknown owners get the next free slot, the last
+ * slot is shared by all owners beyond WRITE_STATS_OWNERS.
+ * @param owner name of the owner
+ * @return counters of the owner
+ * @note Call with semaphore taken
+ */
+write_stats_t* WriteStatsClass::find(const char* owner) {
+    for(size_t i = 0; i < this->used; i++) {
+        if(strncmp(this->owners[i].owner, owner, WRITE_STATS_OWNER_LENGTH - 1) == 0) {
+            return &this->owners[i];
+        }
+    }
+    if(this->used == WRITE_STATS_OWNERS) {
+        write_stats_t* other = &this->owners[WRITE_STATS_OWNERS - 1];
+        strncpy(other->owner, WRITE_STATS_OTHER, WRITE_STATS_OWNER_LENGTH - 1);
+        return other;
+    }
+    write_stats_t* stats = &this->owners[this->used++];
+    strncpy(stats->owner, owner, WRITE_STATS_OWNER_LENGTH - 1);
+    return stats;
+}
+
+WriteStatsClass WriteStats = WriteStatsClass();
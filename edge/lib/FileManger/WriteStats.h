@@ -0,0 +1,41 @@
+#ifndef WRITE_STATS_H
+#define WRITE_STATS_H
+
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+#define WRITE_STATS_OWNERS 16 // distinct owners counted, further owners share the last slot
+#define WRITE_STATS_OWNER_LENGTH 16 // maximum length of an owner name including terminator
+#define WRITE_STATS_OTHER "other" // owner of the writes beyond WRITE_STATS_OWNERS owners
+
+typedef struct {
+    char owner[WRITE_STATS_OWNER_LENGTH]; // e.g. "data", "log", "nvs:job"
+    uint32_t bytes;     // bytes written by appends and overwrites
+    uint32_t writes;    // number of appends and overwrites
+    uint32_t rewrites;  // files rewritten entirely (compaction, truncation of torn lines)
+    uint32_t rewritten; // bytes copied by these rewrites
+    uint32_t erases;    // flash sectors erased
+    uint32_t commits;   // NVS commits
+} write_stats_t;
+
+class WriteStatsClass {
+public:
+    WriteStatsClass();
+    void write(const char* owner, size_t bytes);
+    void rewrite(const char* owner, size_t bytes);
+    void erase(const char* owner, size_t sectors = 1);
+    void commit(const char* owner, size_t bytes, size_t commits = 1);
+    bool snapshot(std::vector<write_stats_t>& stats);
+    uint32_t uptime();
+    static std::string ownerOf(const std::string& path);
+private:
+    write_stats_t owners[WRITE_STATS_OWNERS];
+    size_t used; // number of owners counted
+    SemaphoreHandle_t semaphore;
+    write_stats_t* find(const char* owner);
+};
+
+extern WriteStatsClass WriteStats;
+
+#endif /* WRITE_STATS_H */
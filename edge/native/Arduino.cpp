@@ -0,0 +1,168 @@
+#include "Arduino.h"
+#include <chrono>
+#include <cstdarg>
+#include <thread>
+
+#define NATIVE_PIN_COUNT 40 // GPIOs of the ESP32
+#define NATIVE_HEAP_SIZE (320 * 1024) // heap reported to the firmware, about the free heap of the device after boot
+
+HardwareSerial Serial = HardwareSerial();
+EspClass ESP = EspClass();
+
+static uint8_t levels[NATIVE_PIN_COUNT]; // level of every pin, written by 'digitalWrite()'
+
+static std::chrono::steady_clock::time_point boot() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+// GPIO:
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if(pin < NATIVE_PIN_COUNT) {
+        levels[pin] = val ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < NATIVE_PIN_COUNT ? levels[pin] : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    return 0;
+}
+
+void analogWrite(uint8_t pin, int value) {}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {}
+
+void detachInterrupt(uint8_t pin) {}
+
+// Timing:
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - boot()).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot()).count();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+// Time:
+
+/**
+ * @brief Gets the local time of the host, which is synchronized already
+ * @param info time to be filled
+ * @param ms ignored, the host clock does not need to be waited for
+ * @return true on success, false otherwise
+ */
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    time_t now = time(NULL);
+    return localtime_r(&now, info) != NULL;
+}
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1, const char* server2, const char* server3) {}
+
+// Logging:
+
+void nativeLogPrint(char level, const char* file, int line, const char* function, const char* format, ...) {
+    const char* name = strrchr(file, '/');
+    fprintf(stderr, "[%6lu][%c][%s:%d] %s(): ", millis(), level, name ? name + 1 : file, line, function);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// Serial Port:
+
+HardwareSerial::HardwareSerial() {
+    this->started = false;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    this->started = true;
+}
+
+void HardwareSerial::end() {
+    this->started = false;
+}
+
+bool HardwareSerial::setTxBufferSize(size_t size) {
+    return true;
+}
+
+int HardwareSerial::availableForWrite() {
+    return 4096; // stdout does not block
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return this->write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if(!this->started) {
+        return size;
+    }
+    return fwrite(buffer, 1, size, stdout);
+}
+
+size_t HardwareSerial::print(const char* str) {
+    return this->write((const uint8_t*)str, strlen(str));
+}
+
+size_t HardwareSerial::println(const char* str) {
+    return this->print(str) + this->print("\r\n");
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if(len < 0) {
+        return 0;
+    }
+    return this->write((const uint8_t*)buffer, std::min((size_t)len, sizeof(buffer) - 1));
+}
+
+void HardwareSerial::flush() {
+    if(this->started) {
+        fflush(stdout);
+    }
+}
+
+// Chip:
+
+void EspClass::restart() {
+    fflush(NULL);
+    exit(0);
+}
+
+uint32_t EspClass::getHeapSize() {
+    return NATIVE_HEAP_SIZE;
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return NATIVE_HEAP_SIZE;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return NATIVE_HEAP_SIZE;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+    return NATIVE_HEAP_SIZE / 2; // largest block, the heap of the device is fragmented
+}
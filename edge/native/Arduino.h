@@ -0,0 +1,146 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/**
+ * [INFO]
+ * Host shim of the parts of the Arduino core for the ESP32 used by the firmware, see the "native"
+ * environment in "platformio.ini". Timing uses the host clock, GPIOs only remember their level
+ * and the log macros print to stderr like the core does to the serial port.
+ */
+
+// Memory Attributes:
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+// GPIO:
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define ONLOW 0x04
+#define ONHIGH 0x05
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// Timing:
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+// Time:
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
+void configTime(long gmtOffset_sec, int daylightOffset_sec, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr);
+
+// Logging:
+#define ARDUHAL_LOG_LEVEL_NONE 0
+#define ARDUHAL_LOG_LEVEL_ERROR 1
+#define ARDUHAL_LOG_LEVEL_WARN 2
+#define ARDUHAL_LOG_LEVEL_INFO 3
+#define ARDUHAL_LOG_LEVEL_DEBUG 4
+#define ARDUHAL_LOG_LEVEL_VERBOSE 5
+#ifndef CORE_DEBUG_LEVEL
+#define CORE_DEBUG_LEVEL ARDUHAL_LOG_LEVEL_ERROR
+#endif
+
+void nativeLogPrint(char level, const char* file, int line, const char* function, const char* format, ...) __attribute__((format(printf, 5, 6)));
+
+template<typename T>
+inline T nativeLogArg(T value) {
+    return value;
+}
+
+inline const char* nativeLogArg(const String& value) {
+    return value.c_str(); // passed by the firmware like on the device, where the core converts it
+}
+
+template<typename... Args>
+inline void nativeLog(char level, const char* file, int line, const char* function, const char* format, Args... args) {
+    nativeLogPrint(level, file, line, function, format, nativeLogArg(args)...);
+}
+
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_ERROR
+#define log_e(format, ...) nativeLog('E', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_e(format, ...) do {} while(0)
+#endif
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_WARN
+#define log_w(format, ...) nativeLog('W', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_w(format, ...) do {} while(0)
+#endif
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+#define log_i(format, ...) nativeLog('I', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_i(format, ...) do {} while(0)
+#endif
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_DEBUG
+#define log_d(format, ...) nativeLog('D', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_d(format, ...) do {} while(0)
+#endif
+#if CORE_DEBUG_LEVEL >= ARDUHAL_LOG_LEVEL_VERBOSE
+#define log_v(format, ...) nativeLog('V', __FILE__, __LINE__, __FUNCTION__, format, ##__VA_ARGS__)
+#else
+#define log_v(format, ...) do {} while(0)
+#endif
+
+// Serial Port:
+class HardwareSerial {
+public:
+    HardwareSerial();
+    void begin(unsigned long baud);
+    void end();
+    bool setTxBufferSize(size_t size);
+    int availableForWrite();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+    size_t print(const char* str);
+    size_t println(const char* str = "");
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flush();
+private:
+    bool started; // output is dropped until 'begin()', like nothing is seen of an unopened port
+};
+
+extern HardwareSerial Serial;
+
+// Chip:
+class EspClass {
+public:
+    void restart();
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+};
+
+extern EspClass ESP;
+
+#endif /* NATIVE_ARDUINO_H */
@@ -0,0 +1,6 @@
+#ifndef NATIVE_ESP_MAIL_CLIENT_H
+#define NATIVE_ESP_MAIL_CLIENT_H
+
+// Host shim of the mail client library, the modules built for the host do not send mails.
+
+#endif /* NATIVE_ESP_MAIL_CLIENT_H */
@@ -0,0 +1,360 @@
+#include "FS.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NATIVE_FS_DEFAULT_ROOT "edge-native" // directory in the temporary directory of the host
+
+namespace fs {
+
+class FileImpl {
+public:
+    FILE* stream;                       // NULL for directories
+    std::string path;                   // path on the file system, e.g. "/data.bin"
+    std::string host;                   // path on the host
+    std::vector<std::string> entries;   // names of the directory entries, listed on open
+    size_t next;                        // index of the next directory entry
+    FS* fs;                             // file system of directory entries
+
+    ~FileImpl() {
+        if(this->stream != NULL) {
+            fclose(this->stream);
+        }
+    }
+};
+
+/**
+ * @brief Get the host directory holding the file systems
+ * @return path of the directory
+ */
+std::string nativeRoot() {
+    const char* root = getenv("NATIVE_FS_ROOT");
+    if(root != NULL && root[0] != '\0') {
+        return root;
+    }
+    std::error_code error;
+    std::filesystem::path temp = std::filesystem::temp_directory_path(error);
+    return (error ? std::filesystem::path("/tmp") : temp) / NATIVE_FS_DEFAULT_ROOT;
+}
+
+// File:
+
+File::File(FileImplPtr p) : p(p) {}
+
+size_t File::write(uint8_t c) {
+    return this->write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if(!this->p || this->p->stream == NULL) {
+        return 0;
+    }
+    return fwrite(buf, 1, size, this->p->stream);
+}
+
+size_t File::print(const char* str) {
+    return this->write((const uint8_t*)str, strlen(str));
+}
+
+size_t File::println(const char* str) {
+    return this->print(str) + this->print("\r\n");
+}
+
+size_t File::printf(const char* format, ...) {
+    if(!this->p || this->p->stream == NULL) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    int len = vfprintf(this->p->stream, format, args);
+    va_end(args);
+    return len < 0 ? 0 : (size_t)len;
+}
+
+int File::available() {
+    if(!this->p || this->p->stream == NULL) {
+        return 0;
+    }
+    return (int)(this->size() - this->position());
+}
+
+int File::read() {
+    uint8_t c;
+    return this->read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+    if(!this->p || this->p->stream == NULL) {
+        return -1;
+    }
+    int c = fgetc(this->p->stream);
+    if(c != EOF) {
+        ungetc(c, this->p->stream);
+    }
+    return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+    if(this->p && this->p->stream != NULL) {
+        fflush(this->p->stream);
+    }
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if(!this->p || this->p->stream == NULL) {
+        return 0;
+    }
+    size_t len = fread(buf, 1, size, this->p->stream);
+    clearerr(this->p->stream); // reading a write-only stream or at the end is not sticky on the device
+    return len;
+}
+
+size_t File::readBytes(char* buffer, size_t length) {
+    return this->read((uint8_t*)buffer, length);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if(!this->p || this->p->stream == NULL) {
+        return false;
+    }
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(this->p->stream, (long)pos, whence) == 0;
+}
+
+bool File::seek(uint32_t pos) {
+    return this->seek(pos, SeekSet);
+}
+
+size_t File::position() const {
+    if(!this->p || this->p->stream == NULL) {
+        return 0;
+    }
+    long pos = ftell(this->p->stream);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if(!this->p || this->p->stream == NULL) {
+        return 0;
+    }
+    fflush(this->p->stream); // include buffered writes
+    struct stat info;
+    return fstat(fileno(this->p->stream), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+void File::close() {
+    this->p.reset();
+}
+
+File::operator bool() const {
+    return (bool)this->p;
+}
+
+time_t File::getLastWrite() {
+    struct stat info;
+    return this->p && stat(this->p->host.c_str(), &info) == 0 ? info.st_mtime : 0;
+}
+
+const char* File::path() const {
+    return this->p ? this->p->path.c_str() : NULL;
+}
+
+const char* File::name() const {
+    if(!this->p) {
+        return NULL;
+    }
+    size_t slash = this->p->path.rfind('/');
+    return this->p->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool File::isDirectory() {
+    return this->p && this->p->stream == NULL;
+}
+
+File File::openNextFile(const char* mode) {
+    if(!this->isDirectory() || this->p->next >= this->p->entries.size()) {
+        return File();
+    }
+    std::string base = this->p->path == "/" ? "" : this->p->path;
+    return this->p->fs->open((base + "/" + this->p->entries[this->p->next++]).c_str(), mode);
+}
+
+void File::rewindDirectory() {
+    if(this->isDirectory()) {
+        this->p->next = 0;
+    }
+}
+
+// File System:
+
+/**
+ * @brief Constructor initializes the file system, nothing is mounted before 'mount()'
+ * @param name name of the directory of the file system below 'nativeRoot()'
+ * @param capacity number of bytes reported as total
+ * @param flat true if the file system has no directories (SPIFFS), false otherwise
+ */
+FS::FS(const char* name, uint64_t capacity, bool flat) : label(name), bytes(capacity), flat(flat), mounted(false) {}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    std::string host = this->resolve(path);
+    if(host.empty()) {
+        return File();
+    }
+    std::error_code error;
+
+    // Open Directory:
+    if(std::filesystem::is_directory(host, error)) {
+        if(strcmp(mode, FILE_READ) != 0) {
+            return File();
+        }
+        FileImplPtr p = std::make_shared<FileImpl>();
+        p->stream = NULL;
+        p->path = path;
+        p->host = host;
+        p->next = 0;
+        p->fs = this;
+        for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(host, error)) {
+            p->entries.push_back(entry.path().filename().string());
+        }
+        return File(p);
+    }
+
+    // Open File:
+    bool writing = mode[0] == 'w' || mode[0] == 'a';
+    if(writing && (create || this->flat)) {
+        std::filesystem::create_directories(std::filesystem::path(host).parent_path(), error);
+    }
+    std::string hostMode = std::string(mode) + "b";
+    FILE* stream = fopen(host.c_str(), hostMode.c_str());
+    if(stream == NULL) {
+        return File();
+    }
+    FileImplPtr p = std::make_shared<FileImpl>();
+    p->stream = stream;
+    p->path = path;
+    p->host = host;
+    p->next = 0;
+    p->fs = this;
+    return File(p);
+}
+
+File FS::open(const String& path, const char* mode, const bool create) {
+    return this->open(path.c_str(), mode, create);
+}
+
+bool FS::exists(const char* path) {
+    std::string host = this->resolve(path);
+    std::error_code error;
+    return !host.empty() && std::filesystem::exists(host, error);
+}
+
+bool FS::exists(const String& path) {
+    return this->exists(path.c_str());
+}
+
+bool FS::remove(const char* path) {
+    std::string host = this->resolve(path);
+    return !host.empty() && unlink(host.c_str()) == 0;
+}
+
+bool FS::remove(const String& path) {
+    return this->remove(path.c_str());
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+    std::string from = this->resolve(pathFrom);
+    std::string to = this->resolve(pathTo);
+    return !from.empty() && !to.empty() && ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool FS::rename(const String& pathFrom, const String& pathTo) {
+    return this->rename(pathFrom.c_str(), pathTo.c_str());
+}
+
+bool FS::mkdir(const char* path) {
+    std::string host = this->resolve(path);
+    return !host.empty() && ::mkdir(host.c_str(), 0755) == 0;
+}
+
+bool FS::mkdir(const String& path) {
+    return this->mkdir(path.c_str());
+}
+
+bool FS::rmdir(const char* path) {
+    std::string host = this->resolve(path);
+    return !host.empty() && ::rmdir(host.c_str()) == 0;
+}
+
+bool FS::rmdir(const String& path) {
+    return this->rmdir(path.c_str());
+}
+
+/**
+ * @brief Creates the directory of the file system if needed and mounts it
+ * @return true on success, false otherwise
+ */
+bool FS::mount() {
+    std::error_code error;
+    this->directory = (std::filesystem::path(nativeRoot()) / this->label).string();
+    std::filesystem::create_directories(this->directory, error);
+    this->mounted = std::filesystem::is_directory(this->directory, error);
+    return this->mounted;
+}
+
+void FS::unmount() {
+    this->mounted = false;
+}
+
+/**
+ * @brief Deletes all files of the file system
+ * @return true on success, false otherwise
+ */
+bool FS::erase() {
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::path(nativeRoot()) / this->label;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+    return !error;
+}
+
+uint64_t FS::capacity() {
+    return this->mounted ? this->bytes : 0;
+}
+
+/**
+ * @brief Get the number of bytes of all files of the file system
+ * @return number of bytes
+ */
+uint64_t FS::used() {
+    if(!this->mounted) {
+        return 0;
+    }
+    uint64_t sum = 0;
+    std::error_code error;
+    for(const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(this->directory, error)) {
+        if(entry.is_regular_file(error)) {
+            sum += entry.file_size(error);
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Get the host path of the given path, empty if not mounted or invalid
+ * @param path absolute path on the file system, e.g. "/data.bin"
+ * @return host path
+ */
+std::string FS::resolve(const char* path) {
+    if(!this->mounted || path == NULL || path[0] != '/' || strstr(path, "..") != NULL) {
+        return "";
+    }
+    return this->directory + path;
+}
+
+}
@@ -0,0 +1,107 @@
+#ifndef NATIVE_FS_H
+#define NATIVE_FS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include "Arduino.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+/**
+ * [INFO]
+ * Host shim of the Arduino file system API. Every file system is a directory of the host below
+ * 'nativeRoot()' (environment variable NATIVE_FS_ROOT, a temporary directory otherwise), created
+ * once it is mounted. Files are stdio streams, so reads and writes are buffered by the host like
+ * by the VFS of the device. The capacity is only reported, writes are not limited by it. Flat
+ * file systems (SPIFFS) create the parent directories of the files written, like they accept
+ * any path on the device.
+ */
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl; // see "FS.cpp"
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File {
+public:
+    File(FileImplPtr p = FileImplPtr());
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t size);
+    size_t print(const char* str);
+    size_t println(const char* str = "");
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    int available();
+    int read();
+    int peek();
+    void flush();
+    size_t read(uint8_t* buf, size_t size);
+    size_t readBytes(char* buffer, size_t length);
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos);
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char* path() const;
+    const char* name() const;
+    bool isDirectory();
+    File openNextFile(const char* mode = FILE_READ);
+    void rewindDirectory();
+private:
+    FileImplPtr p;
+};
+
+class FS {
+public:
+    FS(const char* name, uint64_t capacity, bool flat);
+    File open(const char* path, const char* mode = FILE_READ, const bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, const bool create = false);
+    bool exists(const char* path);
+    bool exists(const String& path);
+    bool remove(const char* path);
+    bool remove(const String& path);
+    bool rename(const char* pathFrom, const char* pathTo);
+    bool rename(const String& pathFrom, const String& pathTo);
+    bool mkdir(const char* path);
+    bool mkdir(const String& path);
+    bool rmdir(const char* path);
+    bool rmdir(const String& path);
+protected:
+    bool mount();
+    void unmount();
+    bool erase();
+    uint64_t capacity();
+    uint64_t used();
+private:
+    const char* label; // name of the host directory
+    uint64_t bytes; // capacity reported
+    bool flat; // no directories, any path can be written
+    bool mounted;
+    std::string directory; // host directory, set by 'mount()'
+    std::string resolve(const char* path);
+};
+
+std::string nativeRoot();
+
+}
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif /* NATIVE_FS_H */
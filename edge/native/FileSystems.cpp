@@ -0,0 +1,89 @@
+#include <cstdlib>
+#include "LittleFS.h"
+#include "SD.h"
+#include "SPIFFS.h"
+
+SPIClass SPI = SPIClass();
+fs::SPIFFSFS SPIFFS = fs::SPIFFSFS();
+fs::LittleFSFS LittleFS = fs::LittleFSFS();
+fs::SDFS SD = fs::SDFS();
+
+namespace fs {
+
+// SPIFFS:
+
+SPIFFSFS::SPIFFSFS() : FS("spiffs", SPIFFS_CAPACITY, true) {}
+
+bool SPIFFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    return this->mount();
+}
+
+bool SPIFFSFS::format() {
+    return this->erase();
+}
+
+size_t SPIFFSFS::totalBytes() {
+    return this->capacity();
+}
+
+size_t SPIFFSFS::usedBytes() {
+    return this->used();
+}
+
+void SPIFFSFS::end() {
+    this->unmount();
+}
+
+// LittleFS:
+
+LittleFSFS::LittleFSFS() : FS("littlefs", LITTLEFS_CAPACITY, false) {}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    return this->mount();
+}
+
+bool LittleFSFS::format() {
+    return this->erase();
+}
+
+size_t LittleFSFS::totalBytes() {
+    return this->capacity();
+}
+
+size_t LittleFSFS::usedBytes() {
+    return this->used();
+}
+
+void LittleFSFS::end() {
+    this->unmount();
+}
+
+// SD Card:
+
+SDFS::SDFS() : FS("sd", SD_CAPACITY, false) {}
+
+bool SDFS::begin(uint8_t ssPin, SPIClass& spi, uint32_t frequency, const char* mountpoint, uint8_t maxFiles, bool formatIfMountFailed) {
+    return getenv("NATIVE_NO_SD") == NULL && this->mount(); // set NATIVE_NO_SD to run without card
+}
+
+void SDFS::end() {
+    this->unmount();
+}
+
+sdcard_type_t SDFS::cardType() {
+    return this->capacity() > 0 ? CARD_SDHC : CARD_NONE;
+}
+
+uint64_t SDFS::cardSize() {
+    return this->capacity();
+}
+
+uint64_t SDFS::totalBytes() {
+    return this->capacity();
+}
+
+uint64_t SDFS::usedBytes() {
+    return this->used();
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef NATIVE_HTTP_CLIENT_H
+#define NATIVE_HTTP_CLIENT_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "WString.h"
+#include "WiFiClient.h"
+
+/**
+ * [INFO]
+ * Host shim of the HTTP client of the core, speaking HTTP/1.1 over a socket of the host, e.g. to
+ * a stand-in of the server on the loopback interface. Every request uses its own connection
+ * ("Connection: close"). The response headers are read by 'GET()' and 'POST()', the body is
+ * left on the stream for 'getString()' or 'getStream()'.
+ */
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTPC_DEFAULT_TCP_TIMEOUT 5000
+
+typedef enum {
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_UNAUTHORIZED = 401,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500
+} t_http_codes;
+
+class HTTPClient {
+public:
+    HTTPClient();
+    bool begin(const String& host, uint16_t port, const String& uri = "/");
+    void end();
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void setAuthorization(const char* user, const char* password);
+    void setUserAgent(const String& userAgent);
+    void setTimeout(uint16_t timeout);
+    void setConnectTimeout(int32_t timeout);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    int GET();
+    int POST(uint8_t* payload, size_t size);
+    int POST(const String& payload);
+    int sendRequest(const char* type, uint8_t* payload = NULL, size_t size = 0);
+    int getSize();
+    String getString();
+    WiFiClient& getStream();
+    bool hasHeader(const char* name);
+    String header(const char* name);
+    static String errorToString(int error);
+private:
+    WiFiClient client;
+    std::string host;
+    uint16_t port;
+    std::string uri;
+    std::vector<std::pair<std::string, std::string>> headers; // request headers
+    std::vector<std::pair<std::string, std::string>> collected; // response headers to keep, values empty until received
+    std::string authorization; // "Basic ..." or empty
+    std::string userAgent;
+    uint16_t timeout; // ms
+    int32_t connectTimeout; // ms
+    int size; // content length of the response, -1 if unknown
+    bool readLine(std::string& line);
+};
+
+#endif /* NATIVE_HTTP_CLIENT_H */
@@ -0,0 +1,24 @@
+#ifndef NATIVE_LITTLEFS_H
+#define NATIVE_LITTLEFS_H
+
+#include "FS.h"
+
+#define LITTLEFS_CAPACITY 0x160000 // shares the "spiffs" partition of "default.csv"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+    LittleFSFS();
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+    void end();
+};
+
+}
+
+extern fs::LittleFSFS LittleFS;
+
+#endif /* NATIVE_LITTLEFS_H */
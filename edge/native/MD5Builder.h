@@ -0,0 +1,27 @@
+#ifndef NATIVE_MD5_BUILDER_H
+#define NATIVE_MD5_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "WString.h"
+
+/**
+ * @brief Host shim of the MD5 builder of the core (RFC 1321)
+ */
+class MD5Builder {
+public:
+    void begin();
+    void add(const uint8_t* data, size_t len);
+    void add(const String& str);
+    void calculate();
+    void getBytes(uint8_t* output);
+    String toString();
+private:
+    uint32_t state[4];
+    uint64_t length; // bytes added
+    uint8_t block[64]; // bytes of the incomplete block
+    uint8_t digest[16];
+    void transform(const uint8_t* data);
+};
+
+#endif /* NATIVE_MD5_BUILDER_H */
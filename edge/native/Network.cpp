@@ -0,0 +1,449 @@
+#include "HTTPClient.h"
+#include "WiFi.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <netdb.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define RECEIVE_CHUNK_SIZE 1024 // bytes received from the socket at once
+
+WiFiClass WiFi = WiFiClass();
+
+static std::string base64(const std::string& input) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string output;
+    size_t i = 0;
+    for(; i + 2 < input.size(); i += 3) {
+        uint32_t n = ((uint8_t)input[i] << 16) | ((uint8_t)input[i+1] << 8) | (uint8_t)input[i+2];
+        output += alphabet[(n >> 18) & 63];
+        output += alphabet[(n >> 12) & 63];
+        output += alphabet[(n >> 6) & 63];
+        output += alphabet[n & 63];
+    }
+    if(i < input.size()) {
+        uint32_t n = (uint8_t)input[i] << 16;
+        if(i + 1 < input.size()) {
+            n |= (uint8_t)input[i+1] << 8;
+        }
+        output += alphabet[(n >> 18) & 63];
+        output += alphabet[(n >> 12) & 63];
+        output += i + 1 < input.size() ? alphabet[(n >> 6) & 63] : '=';
+        output += '=';
+    }
+    return output;
+}
+
+// WiFi:
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) {
+    this->octets[0] = first;
+    this->octets[1] = second;
+    this->octets[2] = third;
+    this->octets[3] = fourth;
+}
+
+String IPAddress::toString() const {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", this->octets[0], this->octets[1], this->octets[2], this->octets[3]);
+    return buffer;
+}
+
+WiFiClass::WiFiClass() {
+    this->state = WL_DISCONNECTED;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase) {
+    this->state = ssid != NULL && ssid[0] != '\0' ? WL_CONNECTED : WL_NO_SSID_AVAIL;
+    return this->state;
+}
+
+bool WiFiClass::disconnect(bool wifioff) {
+    this->state = WL_DISCONNECTED;
+    return true;
+}
+
+bool WiFiClass::isConnected() {
+    return this->state == WL_CONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+    return this->state;
+}
+
+IPAddress WiFiClass::localIP() {
+    return this->state == WL_CONNECTED ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+// TCP Client:
+
+WiFiClient::WiFiClient() {
+    this->fd = -1;
+    this->timeout = WIFI_CLIENT_DEF_CONN_TIMEOUT_MS;
+    this->head = 0;
+    this->closed = false;
+}
+
+WiFiClient::~WiFiClient() {
+    this->stop();
+}
+
+/**
+ * @brief Connects to the given host
+ * @param host name or address of the host
+ * @param port TCP port
+ * @param timeout ignored, the host resolves and connects right away
+ * @return 1 on success, 0 otherwise
+ */
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeout) {
+    this->stop();
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = NULL;
+    std::string service = std::to_string(port);
+    if(getaddrinfo(host, service.c_str(), &hints, &result) != 0) {
+        return 0;
+    }
+    for(addrinfo* address = result; address != NULL && this->fd < 0; address = address->ai_next) {
+        this->fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if(this->fd >= 0 && ::connect(this->fd, address->ai_addr, address->ai_addrlen) != 0) {
+            close(this->fd);
+            this->fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    return this->fd >= 0 ? 1 : 0;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    size_t sent = 0;
+    while(this->fd >= 0 && sent < size) {
+        ssize_t len = send(this->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if(len <= 0) {
+            break;
+        }
+        sent += len;
+    }
+    return sent;
+}
+
+int WiFiClient::available() {
+    if(this->head == this->buffer.size()) {
+        this->receive(false);
+    }
+    return (int)(this->buffer.size() - this->head);
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return this->readBytes(&c, 1) == 1 ? c : -1;
+}
+
+/**
+ * @brief Reads the given number of bytes, waits up to the timeout for each chunk
+ * @param buffer buffer to be filled
+ * @param length number of bytes to read
+ * @return number of bytes read, less if the connection was closed or timed out
+ */
+size_t WiFiClient::readBytes(uint8_t* buffer, size_t length) {
+    size_t len = 0;
+    while(len < length) {
+        if(this->head == this->buffer.size() && !this->receive(true)) {
+            break;
+        }
+        size_t chunk = std::min(length - len, this->buffer.size() - this->head);
+        memcpy(buffer + len, this->buffer.data() + this->head, chunk);
+        this->head += chunk;
+        len += chunk;
+    }
+    return len;
+}
+
+uint8_t WiFiClient::connected() {
+    return this->fd >= 0 && (!this->closed || this->head < this->buffer.size());
+}
+
+void WiFiClient::setTimeout(uint32_t ms) {
+    this->timeout = ms;
+}
+
+void WiFiClient::stop() {
+    if(this->fd >= 0) {
+        close(this->fd);
+    }
+    this->fd = -1;
+    this->buffer.clear();
+    this->head = 0;
+    this->closed = false;
+}
+
+/**
+ * @brief Replaces the consumed receive buffer by the bytes received next
+ * @param wait true to wait up to the timeout for bytes, false to take only those received already
+ * @return true if bytes were received, false otherwise
+ */
+bool WiFiClient::receive(bool wait) {
+    if(this->fd < 0 || this->closed) {
+        return false;
+    }
+    pollfd descriptor = {this->fd, POLLIN, 0};
+    if(poll(&descriptor, 1, wait ? (int)this->timeout : 0) <= 0) {
+        return false;
+    }
+    this->buffer.resize(RECEIVE_CHUNK_SIZE);
+    ssize_t len = recv(this->fd, this->buffer.data(), this->buffer.size(), 0);
+    this->buffer.resize(len > 0 ? len : 0);
+    this->head = 0;
+    this->closed = len <= 0;
+    return len > 0;
+}
+
+// HTTP Client:
+
+HTTPClient::HTTPClient() {
+    this->port = 80;
+    this->timeout = HTTPC_DEFAULT_TCP_TIMEOUT;
+    this->connectTimeout = HTTPC_DEFAULT_TCP_TIMEOUT;
+    this->size = -1;
+}
+
+bool HTTPClient::begin(const String& host, uint16_t port, const String& uri) {
+    this->end();
+    this->host = host;
+    this->port = port;
+    this->uri = uri.empty() ? "/" : uri;
+    this->headers.clear();
+    return !this->host.empty();
+}
+
+void HTTPClient::end() {
+    this->client.stop();
+    this->size = -1;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool replace) {
+    for(std::pair<std::string, std::string>& header : this->headers) {
+        if(replace && strcasecmp(header.first.c_str(), name.c_str()) == 0) {
+            header.second = value;
+            return;
+        }
+    }
+    if(first) {
+        this->headers.insert(this->headers.begin(), {name, value});
+    } else {
+        this->headers.push_back({name, value});
+    }
+}
+
+void HTTPClient::setAuthorization(const char* user, const char* password) {
+    if(user == NULL || password == NULL || (user[0] == '\0' && password[0] == '\0')) {
+        this->authorization.clear();
+        return;
+    }
+    this->authorization = "Basic " + base64(std::string(user) + ":" + password);
+}
+
+void HTTPClient::setUserAgent(const String& userAgent) {
+    this->userAgent = userAgent;
+}
+
+void HTTPClient::setTimeout(uint16_t timeout) {
+    this->timeout = timeout;
+    this->client.setTimeout(timeout);
+}
+
+void HTTPClient::setConnectTimeout(int32_t timeout) {
+    this->connectTimeout = timeout;
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    this->collected.clear();
+    for(size_t i = 0; i < headerKeysCount; i++) {
+        this->collected.push_back({headerKeys[i], ""});
+    }
+}
+
+int HTTPClient::GET() {
+    return this->sendRequest("GET");
+}
+
+int HTTPClient::POST(uint8_t* payload, size_t size) {
+    return this->sendRequest("POST", payload, size);
+}
+
+int HTTPClient::POST(const String& payload) {
+    return this->sendRequest("POST", (uint8_t*)payload.data(), payload.size());
+}
+
+/**
+ * @brief Sends the request and reads the status line and headers of the response
+ * @param type method, e.g. "GET"
+ * @param payload body of the request, NULL if none
+ * @param size number of bytes of the body
+ * @return HTTP status code, negative on error (HTTPC_ERROR_*)
+ */
+int HTTPClient::sendRequest(const char* type, uint8_t* payload, size_t size) {
+    // Connect:
+    this->client.stop();
+    this->client.setTimeout(this->timeout);
+    this->size = -1;
+    for(std::pair<std::string, std::string>& header : this->collected) {
+        header.second.clear();
+    }
+    if(!this->client.connect(this->host.c_str(), this->port, this->connectTimeout)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    // Send Header and Payload:
+    std::string request = std::string(type) + " " + this->uri + " HTTP/1.1\r\n";
+    request += "Host: " + this->host + ":" + std::to_string(this->port) + "\r\n";
+    request += "Connection: close\r\n";
+    if(!this->userAgent.empty()) {
+        request += "User-Agent: " + this->userAgent + "\r\n";
+    }
+    if(!this->authorization.empty()) {
+        request += "Authorization: " + this->authorization + "\r\n";
+    }
+    for(const std::pair<std::string, std::string>& header : this->headers) {
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    if(payload != NULL || strcmp(type, "POST") == 0) {
+        request += "Content-Length: " + std::to_string(size) + "\r\n";
+    }
+    request += "\r\n";
+    if(this->client.write((const uint8_t*)request.data(), request.size()) != request.size()) {
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    }
+    if(payload != NULL && size > 0 && this->client.write(payload, size) != size) {
+        return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+
+    // Read Status Line:
+    std::string line;
+    if(!this->readLine(line)) {
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    int code = 0;
+    if(sscanf(line.c_str(), "HTTP/%*d.%*d %d", &code) != 1) {
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+    }
+
+    // Read Headers:
+    while(this->readLine(line) && !line.empty()) {
+        size_t colon = line.find(':');
+        if(colon == std::string::npos) {
+            continue;
+        }
+        std::string name = line.substr(0, colon);
+        size_t start = line.find_first_not_of(' ', colon + 1);
+        std::string value = start == std::string::npos ? "" : line.substr(start);
+        if(strcasecmp(name.c_str(), "Content-Length") == 0) {
+            this->size = atoi(value.c_str());
+        }
+        for(std::pair<std::string, std::string>& header : this->collected) {
+            if(strcasecmp(header.first.c_str(), name.c_str()) == 0) {
+                header.second = value;
+            }
+        }
+    }
+    return code;
+}
+
+int HTTPClient::getSize() {
+    return this->size;
+}
+
+/**
+ * @brief Reads the body of the response
+ * @return body, up to the content length or until the server closed the connection
+ */
+String HTTPClient::getString() {
+    std::string body;
+    uint8_t buffer[RECEIVE_CHUNK_SIZE];
+    while(this->size < 0 || body.size() < (size_t)this->size) {
+        size_t len = sizeof(buffer);
+        if(this->size >= 0) {
+            len = std::min(len, (size_t)this->size - body.size());
+        }
+        len = this->client.readBytes(buffer, len);
+        if(len == 0) {
+            break;
+        }
+        body.append((const char*)buffer, len);
+    }
+    return body;
+}
+
+WiFiClient& HTTPClient::getStream() {
+    return this->client;
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+    for(const std::pair<std::string, std::string>& header : this->collected) {
+        if(strcasecmp(header.first.c_str(), name) == 0 && !header.second.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+String HTTPClient::header(const char* name) {
+    for(const std::pair<std::string, std::string>& header : this->collected) {
+        if(strcasecmp(header.first.c_str(), name) == 0) {
+            return header.second;
+        }
+    }
+    return String();
+}
+
+String HTTPClient::errorToString(int error) {
+    switch(error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+        return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+        return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+        return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED:
+        return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST:
+        return "connection lost";
+    case HTTPC_ERROR_NO_HTTP_SERVER:
+        return "no HTTP server";
+    case HTTPC_ERROR_READ_TIMEOUT:
+        return "read Timeout";
+    default:
+        return String();
+    }
+}
+
+/**
+ * @brief Reads a line of the response header
+ * @param line line to be filled, without line break
+ * @return true on success, false if the connection was closed or timed out
+ */
+bool HTTPClient::readLine(std::string& line) {
+    line.clear();
+    while(true) {
+        int c = this->client.read();
+        if(c < 0) {
+            return false;
+        }
+        if(c == '\n') {
+            if(!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            return true;
+        }
+        line += (char)c;
+    }
+}
@@ -0,0 +1,206 @@
+#include "Preferences.h"
+#include <cstring>
+#include <map>
+#include <mutex>
+
+typedef std::map<std::string, std::string> nvs_namespace_t; // values by key
+
+static std::mutex& lock() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::map<std::string, nvs_namespace_t>& partition() {
+    static std::map<std::string, nvs_namespace_t> namespaces;
+    return namespaces;
+}
+
+Preferences::Preferences() {
+    this->readOnly = false;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+    if(!this->name.empty() || name == NULL || name[0] == '\0') {
+        return false;
+    }
+    this->name = name;
+    this->readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end() {
+    this->name.clear();
+}
+
+bool Preferences::clear() {
+    if(this->name.empty() || this->readOnly) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    partition()[this->name].clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if(this->name.empty() || this->readOnly || key == NULL) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    return partition()[this->name].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    if(this->name.empty() || key == NULL) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    return partition()[this->name].count(key) > 0;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value) {
+    return this->put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUShort(const char* key, uint16_t value) {
+    return this->put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putInt(const char* key, int32_t value) {
+    return this->put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+    return this->put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putBool(const char* key, bool value) {
+    return this->putUChar(key, value ? 1 : 0);
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    return value == NULL ? 0 : this->put(key, value, strlen(value) + 1);
+}
+
+size_t Preferences::putString(const char* key, const String& value) {
+    return this->putString(key, value.c_str());
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    return value == NULL || len == 0 ? 0 : this->put(key, value, len);
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue) {
+    uint8_t value = defaultValue;
+    this->get(key, &value, sizeof(value));
+    return value;
+}
+
+uint16_t Preferences::getUShort(const char* key, uint16_t defaultValue) {
+    uint16_t value = defaultValue;
+    this->get(key, &value, sizeof(value));
+    return value;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue) {
+    int32_t value = defaultValue;
+    this->get(key, &value, sizeof(value));
+    return value;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+    uint32_t value = defaultValue;
+    this->get(key, &value, sizeof(value));
+    return value;
+}
+
+bool Preferences::getBool(const char* key, bool defaultValue) {
+    return this->getUChar(key, defaultValue ? 1 : 0) == 1;
+}
+
+/**
+ * @brief Copies the string of the key into the buffer, the buffer is left untouched if the key is
+ * missing or the string does not fit, like on the device
+ * @param key key of the string
+ * @param value buffer to be filled
+ * @param maxLen size of the buffer
+ * @return length of the string including the terminator, 0 on failure
+ */
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+    if(this->name.empty() || key == NULL || value == NULL || maxLen == 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    nvs_namespace_t& space = partition()[this->name];
+    nvs_namespace_t::iterator it = space.find(key);
+    if(it == space.end() || it->second.size() > maxLen) {
+        return 0;
+    }
+    memcpy(value, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    size_t len = this->getBytesLength(key);
+    if(len == 0) {
+        return defaultValue;
+    }
+    std::string value(len, '\0');
+    this->getString(key, &value[0], len);
+    value.resize(len - 1); // without terminator
+    return value;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if(this->name.empty() || key == NULL) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    nvs_namespace_t& space = partition()[this->name];
+    nvs_namespace_t::iterator it = space.find(key);
+    return it == space.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    size_t len = this->getBytesLength(key);
+    if(len == 0 || buf == NULL || len > maxLen || !this->get(key, buf, len)) {
+        return 0;
+    }
+    return len;
+}
+
+/**
+ * @brief Stores the bytes of the value under the key
+ * @param key key of the value
+ * @param value bytes to store
+ * @param len number of bytes
+ * @return number of bytes stored, 0 on failure
+ */
+size_t Preferences::put(const char* key, const void* value, size_t len) {
+    if(this->name.empty() || this->readOnly || key == NULL) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    partition()[this->name][key].assign((const char*)value, len);
+    return len;
+}
+
+/**
+ * @brief Copies the bytes stored under the key, if they have the given length
+ * @param key key of the value
+ * @param value buffer to be filled
+ * @param len number of bytes expected
+ * @return true on success, false if missing or of another length
+ */
+bool Preferences::get(const char* key, void* value, size_t len) {
+    if(this->name.empty() || key == NULL) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    nvs_namespace_t& space = partition()[this->name];
+    nvs_namespace_t::iterator it = space.find(key);
+    if(it == space.end() || it->second.size() != len) {
+        return false;
+    }
+    memcpy(value, it->second.data(), len);
+    return true;
+}
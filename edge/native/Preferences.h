@@ -0,0 +1,45 @@
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "WString.h"
+
+/**
+ * @brief Host shim of the NVS preferences. The namespaces are kept in RAM of the process and
+ * shared by all instances, like they are shared on the device, but lost on exit.
+ */
+class Preferences {
+public:
+    Preferences();
+    bool begin(const char* name, bool readOnly = false, const char* partitionLabel = NULL);
+    void end();
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+    size_t putUChar(const char* key, uint8_t value);
+    size_t putUShort(const char* key, uint16_t value);
+    size_t putInt(const char* key, int32_t value);
+    size_t putUInt(const char* key, uint32_t value);
+    size_t putBool(const char* key, bool value);
+    size_t putString(const char* key, const char* value);
+    size_t putString(const char* key, const String& value);
+    size_t putBytes(const char* key, const void* value, size_t len);
+    uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+    uint16_t getUShort(const char* key, uint16_t defaultValue = 0);
+    int32_t getInt(const char* key, int32_t defaultValue = 0);
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+    bool getBool(const char* key, bool defaultValue = false);
+    size_t getString(const char* key, char* value, size_t maxLen);
+    String getString(const char* key, const String& defaultValue = String());
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+private:
+    std::string name; // namespace, empty if not started
+    bool readOnly;
+    size_t put(const char* key, const void* value, size_t len);
+    bool get(const char* key, void* value, size_t len);
+};
+
+#endif /* NATIVE_PREFERENCES_H */
@@ -0,0 +1,34 @@
+#ifndef NATIVE_SD_H
+#define NATIVE_SD_H
+
+#include "FS.h"
+#include "SPI.h"
+
+#define SD_CAPACITY (8ULL * 1024 * 1024 * 1024) // card of 8 GB
+
+typedef enum {
+    CARD_NONE,
+    CARD_MMC,
+    CARD_SD,
+    CARD_SDHC,
+    CARD_UNKNOWN
+} sdcard_type_t;
+
+namespace fs {
+
+class SDFS : public FS {
+public:
+    SDFS();
+    bool begin(uint8_t ssPin = SS, SPIClass& spi = SPI, uint32_t frequency = 4000000, const char* mountpoint = "/sd", uint8_t maxFiles = 5, bool formatIfMountFailed = false);
+    void end();
+    sdcard_type_t cardType();
+    uint64_t cardSize();
+    uint64_t totalBytes();
+    uint64_t usedBytes();
+};
+
+}
+
+extern fs::SDFS SD;
+
+#endif /* NATIVE_SD_H */
@@ -0,0 +1,16 @@
+#ifndef NATIVE_SPI_H
+#define NATIVE_SPI_H
+
+#include <cstdint>
+
+#define SS 5 // default chip select of VSPI
+
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+    void end() {}
+};
+
+extern SPIClass SPI;
+
+#endif /* NATIVE_SPI_H */
@@ -0,0 +1,24 @@
+#ifndef NATIVE_SPIFFS_H
+#define NATIVE_SPIFFS_H
+
+#include "FS.h"
+
+#define SPIFFS_CAPACITY 0x160000 // size of the "spiffs" partition of "default.csv"
+
+namespace fs {
+
+class SPIFFSFS : public FS {
+public:
+    SPIFFSFS();
+    bool begin(bool formatOnFail = false, const char* basePath = "/spiffs", uint8_t maxOpenFiles = 10, const char* partitionLabel = NULL);
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+    void end();
+};
+
+}
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif /* NATIVE_SPIFFS_H */
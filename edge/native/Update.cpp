@@ -0,0 +1,181 @@
+#include "MD5Builder.h"
+#include "Update.h"
+#include <cstdio>
+#include <cstring>
+
+UpdateClass Update = UpdateClass();
+
+// Updater:
+
+UpdateClass::UpdateClass() {
+    this->size = 0;
+    this->written = 0;
+    this->running = false;
+    this->error = NULL;
+}
+
+bool UpdateClass::begin(size_t size, int command) {
+    if(this->running) {
+        this->error = "Already Running";
+        return false;
+    }
+    if(size == 0) {
+        this->error = "Bad Size Given";
+        return false;
+    }
+    this->size = size;
+    this->written = 0;
+    this->running = true;
+    this->error = NULL;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+    if(!this->running || this->error != NULL) {
+        return 0;
+    }
+    if(this->size != UPDATE_SIZE_UNKNOWN && this->written + len > this->size) {
+        this->error = "Flash Write Failed";
+        return 0;
+    }
+    this->written += len;
+    return len;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+    if(!this->running) {
+        return false;
+    }
+    this->running = false;
+    if(this->error != NULL) {
+        return false;
+    }
+    if(!evenIfRemaining && this->written != this->size) {
+        this->error = "Aborted";
+        return false;
+    }
+    return true;
+}
+
+bool UpdateClass::hasError() {
+    return this->error != NULL;
+}
+
+bool UpdateClass::isFinished() {
+    return !this->running && this->error == NULL && this->written > 0;
+}
+
+size_t UpdateClass::progress() {
+    return this->written;
+}
+
+const char* UpdateClass::errorString() {
+    return this->error != NULL ? this->error : "No Error";
+}
+
+// MD5:
+
+static const uint32_t constants[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint8_t shifts[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+void MD5Builder::begin() {
+    this->state[0] = 0x67452301;
+    this->state[1] = 0xefcdab89;
+    this->state[2] = 0x98badcfe;
+    this->state[3] = 0x10325476;
+    this->length = 0;
+    memset(this->digest, 0, sizeof(this->digest));
+}
+
+void MD5Builder::add(const uint8_t* data, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+        this->block[this->length % 64] = data[i];
+        this->length++;
+        if(this->length % 64 == 0) {
+            this->transform(this->block);
+        }
+    }
+}
+
+void MD5Builder::add(const String& str) {
+    this->add((const uint8_t*)str.data(), str.size());
+}
+
+void MD5Builder::calculate() {
+    uint64_t bits = this->length * 8;
+    uint8_t padding = 0x80;
+    this->add(&padding, 1);
+    padding = 0;
+    while(this->length % 64 != 56) {
+        this->add(&padding, 1);
+    }
+    uint8_t size[8];
+    for(int i = 0; i < 8; i++) {
+        size[i] = (uint8_t)(bits >> (8 * i));
+    }
+    this->add(size, sizeof(size));
+    for(int i = 0; i < 16; i++) {
+        this->digest[i] = (uint8_t)(this->state[i / 4] >> (8 * (i % 4)));
+    }
+}
+
+void MD5Builder::getBytes(uint8_t* output) {
+    memcpy(output, this->digest, sizeof(this->digest));
+}
+
+String MD5Builder::toString() {
+    char hex[33];
+    for(int i = 0; i < 16; i++) {
+        snprintf(hex + 2 * i, 3, "%02x", this->digest[i]);
+    }
+    return hex;
+}
+
+void MD5Builder::transform(const uint8_t* data) {
+    uint32_t words[16];
+    for(int i = 0; i < 16; i++) {
+        words[i] = (uint32_t)data[4*i] | ((uint32_t)data[4*i+1] << 8) | ((uint32_t)data[4*i+2] << 16) | ((uint32_t)data[4*i+3] << 24);
+    }
+    uint32_t a = this->state[0], b = this->state[1], c = this->state[2], d = this->state[3];
+    for(int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if(i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if(i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if(i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        f += a + constants[i] + words[g];
+        a = d;
+        d = c;
+        c = b;
+        b += (f << shifts[i]) | (f >> (32 - shifts[i]));
+    }
+    this->state[0] += a;
+    this->state[1] += b;
+    this->state[2] += c;
+    this->state[3] += d;
+}
@@ -0,0 +1,34 @@
+#ifndef NATIVE_UPDATE_H
+#define NATIVE_UPDATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+/**
+ * @brief Host shim of the firmware updater, counts the bytes written and discards them
+ */
+class UpdateClass {
+public:
+    UpdateClass();
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH);
+    size_t write(uint8_t* data, size_t len);
+    bool end(bool evenIfRemaining = false);
+    bool hasError();
+    bool isFinished();
+    size_t progress();
+    const char* errorString();
+private:
+    size_t size; // bytes announced by 'begin()'
+    size_t written;
+    bool running;
+    const char* error; // NULL if none
+};
+
+extern UpdateClass Update;
+
+#endif /* NATIVE_UPDATE_H */
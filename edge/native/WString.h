@@ -0,0 +1,50 @@
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <cstdlib>
+#include <string>
+#include <strings.h>
+
+/**
+ * @brief Host shim of the Arduino 'String', a 'std::string' with the Arduino methods used by the
+ * firmware. Unlike on the device, allocation failures throw instead of leaving the string invalid.
+ */
+class String : public std::string {
+public:
+    String() {}
+    String(const char* str) : std::string(str ? str : "") {}
+    String(const std::string& str) : std::string(str) {}
+    String(std::string&& str) : std::string(std::move(str)) {}
+    explicit String(char c) : std::string(1, c) {}
+    explicit String(int value) : std::string(std::to_string(value)) {}
+    explicit String(unsigned int value) : std::string(std::to_string(value)) {}
+    explicit String(long value) : std::string(std::to_string(value)) {}
+    explicit String(unsigned long value) : std::string(std::to_string(value)) {}
+    explicit String(double value, unsigned int decimals = 2) : std::string(format(value, decimals)) {}
+
+    unsigned int length() const { return (unsigned int)this->size(); }
+    char charAt(unsigned int index) const { return index < this->size() ? (*this)[index] : '\0'; }
+    bool equals(const String& other) const { return *this == other; }
+    bool equalsIgnoreCase(const String& other) const { return this->size() == other.size() && strcasecmp(this->c_str(), other.c_str()) == 0; }
+    bool startsWith(const String& prefix) const { return this->compare(0, prefix.size(), prefix) == 0; }
+    bool endsWith(const String& suffix) const { return this->size() >= suffix.size() && this->compare(this->size() - suffix.size(), suffix.size(), suffix) == 0; }
+    int indexOf(char c, unsigned int from = 0) const { size_t i = this->find(c, from); return i == npos ? -1 : (int)i; }
+    int indexOf(const String& str, unsigned int from = 0) const { size_t i = this->find(str, from); return i == npos ? -1 : (int)i; }
+    String substring(unsigned int from) const { return from < this->size() ? String(this->substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < to && from < this->size() ? String(this->substr(from, to - from)) : String(); }
+    bool concat(const String& str) { this->append(str); return true; }
+    void toLowerCase() { for(char& c : *this) { c = (char)tolower((unsigned char)c); } }
+    void toUpperCase() { for(char& c : *this) { c = (char)toupper((unsigned char)c); } }
+    void trim() { this->erase(0, this->find_first_not_of(" \t\r\n")); this->erase(this->find_last_not_of(" \t\r\n") + 1); }
+    long toInt() const { return strtol(this->c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(this->c_str(), nullptr); }
+
+private:
+    static std::string format(double value, unsigned int decimals) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+        return buffer;
+    }
+};
+
+#endif /* NATIVE_WSTRING_H */
@@ -0,0 +1,52 @@
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include <cstdint>
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+/**
+ * [INFO]
+ * Host shim of the WiFi station. The host network is always up, so joining any network succeeds
+ * right away and the station has the loopback address.
+ */
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress {
+public:
+    IPAddress(uint8_t first = 0, uint8_t second = 0, uint8_t third = 0, uint8_t fourth = 0);
+    String toString() const;
+private:
+    uint8_t octets[4];
+};
+
+class WiFiClass {
+public:
+    WiFiClass();
+    bool mode(wifi_mode_t mode);
+    wl_status_t begin(const char* ssid, const char* passphrase = NULL);
+    bool disconnect(bool wifioff = false);
+    bool isConnected();
+    wl_status_t status();
+    IPAddress localIP();
+private:
+    wl_status_t state;
+};
+
+extern WiFiClass WiFi;
+
+#endif /* NATIVE_WIFI_H */
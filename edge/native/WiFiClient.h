@@ -0,0 +1,36 @@
+#ifndef NATIVE_WIFI_CLIENT_H
+#define NATIVE_WIFI_CLIENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define WIFI_CLIENT_DEF_CONN_TIMEOUT_MS 3000
+
+/**
+ * @brief Host shim of the TCP client, a blocking socket with a receive buffer
+ */
+class WiFiClient {
+public:
+    WiFiClient();
+    ~WiFiClient();
+    WiFiClient(const WiFiClient&) = delete;
+    WiFiClient& operator=(const WiFiClient&) = delete;
+    int connect(const char* host, uint16_t port, int32_t timeout = WIFI_CLIENT_DEF_CONN_TIMEOUT_MS);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    size_t readBytes(uint8_t* buffer, size_t length);
+    uint8_t connected();
+    void setTimeout(uint32_t ms);
+    void stop();
+private:
+    int fd; // socket, negative if not connected
+    uint32_t timeout; // maximum time in ms to wait for data
+    std::vector<uint8_t> buffer; // received bytes not read yet
+    size_t head; // index of the next byte in the buffer
+    bool closed; // peer closed the connection
+    bool receive(bool wait);
+};
+
+#endif /* NATIVE_WIFI_CLIENT_H */
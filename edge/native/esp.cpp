@@ -0,0 +1,162 @@
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "Arduino.h"
+#include "FS.h"
+#include <array>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+typedef struct {
+    esp_partition_t partition;
+    int fd; // file holding the content
+} native_partition_t;
+
+// CRC:
+
+template<typename T>
+static constexpr std::array<T, 256> crcTable(T polynomial) {
+    std::array<T, 256> table = {};
+    for(uint32_t i = 0; i < 256; i++) {
+        T crc = (T)i;
+        for(int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (T)((crc >> 1) ^ polynomial) : (T)(crc >> 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+static constexpr std::array<uint16_t, 256> crc16Table = crcTable<uint16_t>(0x8408); // CRC-16/CCITT, reflected
+static constexpr std::array<uint32_t, 256> crc32Table = crcTable<uint32_t>(0xEDB88320); // CRC-32 of IEEE 802.3, reflected
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    for(uint32_t i = 0; i < len; i++) {
+        crc = (uint16_t)((crc >> 8) ^ crc16Table[(crc ^ buf[i]) & 0xFF]);
+    }
+    return ~crc;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    for(uint32_t i = 0; i < len; i++) {
+        crc = (crc >> 8) ^ crc32Table[(crc ^ buf[i]) & 0xFF];
+    }
+    return ~crc;
+}
+
+// System:
+
+esp_reset_reason_t esp_reset_reason() {
+    return ESP_RST_POWERON;
+}
+
+void esp_restart() {
+    ESP.restart();
+}
+
+uint32_t esp_get_free_heap_size() {
+    return ESP.getFreeHeap();
+}
+
+// Partitions:
+
+static std::mutex& lock() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static bool inside(const esp_partition_t* partition, size_t offset, size_t size) {
+    return partition != NULL && offset <= partition->size && size <= partition->size - offset;
+}
+
+static int descriptor(const esp_partition_t* partition) {
+    return ((const native_partition_t*)partition)->fd;
+}
+
+/**
+ * @brief Finds the partition of the given label, its file is created erased if missing
+ * @param type ignored, every label is a partition
+ * @param subtype ignored
+ * @param label label of the partition
+ * @return partition, NULL if the label is missing or the file cannot be opened
+ */
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    if(label == NULL) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> guard(lock());
+    static std::map<std::string, native_partition_t> partitions;
+    std::map<std::string, native_partition_t>::iterator it = partitions.find(label);
+    if(it != partitions.end()) {
+        return &it->second.partition;
+    }
+
+    // Open Partition File:
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::path(fs::nativeRoot()) / "partitions";
+    std::filesystem::create_directories(directory, error);
+    std::string path = (directory / (std::string(label) + ".bin")).string();
+    bool created = !std::filesystem::exists(path, error);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0) {
+        return NULL;
+    }
+    if(created || lseek(fd, 0, SEEK_END) != NATIVE_PARTITION_SIZE) {
+        std::vector<uint8_t> erased(NATIVE_PARTITION_SIZE, 0xFF);
+        if(ftruncate(fd, 0) != 0 || pwrite(fd, erased.data(), erased.size(), 0) != (ssize_t)erased.size()) {
+            close(fd);
+            return NULL;
+        }
+    }
+
+    // Register Partition:
+    native_partition_t& native = partitions[label];
+    native.fd = fd;
+    native.partition.type = type;
+    native.partition.subtype = subtype;
+    native.partition.address = 0;
+    native.partition.size = NATIVE_PARTITION_SIZE;
+    native.partition.erase_size = SPI_FLASH_SEC_SIZE;
+    snprintf(native.partition.label, sizeof(native.partition.label), "%s", label);
+    native.partition.encrypted = false;
+    return &native.partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+    if(!inside(partition, src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return pread(descriptor(partition), dst, size, src_offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    if(!inside(partition, dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    std::vector<uint8_t> bytes(size);
+    if(pread(descriptor(partition), bytes.data(), size, dst_offset) != (ssize_t)size) {
+        return ESP_FAIL;
+    }
+    for(size_t i = 0; i < size; i++) {
+        bytes[i] &= ((const uint8_t*)src)[i]; // programming clears bits only
+    }
+    return pwrite(descriptor(partition), bytes.data(), size, dst_offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    if(!inside(partition, offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if(offset % SPI_FLASH_SEC_SIZE != 0 || size % SPI_FLASH_SEC_SIZE != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::vector<uint8_t> erased(size, 0xFF);
+    return pwrite(descriptor(partition), erased.data(), size, offset) == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,48 @@
+#ifndef NATIVE_ESP_PARTITION_H
+#define NATIVE_ESP_PARTITION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * [INFO]
+ * Host shim of the raw flash partitions. Every partition found is a file of NATIVE_PARTITION_SIZE
+ * bytes in the directory "partitions" below 'fs::nativeRoot()'. Like on NOR flash, writes can
+ * only clear bits and erasing sets whole sectors to 0xFF.
+ */
+
+#define NATIVE_PARTITION_SIZE 0x100000 // size of the "datalog" partition of "partitions_datalog.csv"
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+    ESP_PARTITION_TYPE_ANY = 0xff
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
+
+#endif /* NATIVE_ESP_PARTITION_H */
@@ -0,0 +1,10 @@
+#ifndef NATIVE_ESP_ROM_CRC_H
+#define NATIVE_ESP_ROM_CRC_H
+
+#include <cstdint>
+
+// Same results as the ROM functions of the device, so files are portable between both:
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t* buf, uint32_t len);
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
+
+#endif /* NATIVE_ESP_ROM_CRC_H */
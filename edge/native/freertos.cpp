@@ -0,0 +1,160 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct QueueDefinition {
+    std::mutex mutex;
+    std::condition_variable changed; // notified on every send and receive
+    size_t length;                   // maximum number of items
+    size_t itemSize;                 // bytes per item, 0 for semaphores
+    std::vector<uint8_t> items;      // ring of 'length' items
+    size_t head;                     // index of the oldest item
+    size_t count;                    // number of items waiting
+};
+
+/**
+ * @brief Waits on the queue until the predicate holds or the ticks passed
+ * @param queue queue with its mutex held by the lock
+ * @param lock lock of the queue mutex
+ * @param ticksToWait maximum number of ticks to wait, portMAX_DELAY to wait forever
+ * @param ready predicate to wait for
+ * @return true if the predicate holds, false on timeout
+ */
+template<typename Predicate>
+static bool wait(QueueHandle_t queue, std::unique_lock<std::mutex>& lock, TickType_t ticksToWait, Predicate ready) {
+    if(ticksToWait == portMAX_DELAY) {
+        queue->changed.wait(lock, ready);
+        return true;
+    }
+    return queue->changed.wait_for(lock, std::chrono::milliseconds(ticksToWait * portTICK_PERIOD_MS), ready);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if(length == 0) {
+        return NULL;
+    }
+    QueueHandle_t queue = new QueueDefinition();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->items.resize(length * itemSize);
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return xQueueSendToBack(queue, item, ticksToWait);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if(!wait(queue, lock, ticksToWait, [queue]() { return queue->count < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+    size_t index = (queue->head + queue->count) % queue->length;
+    if(queue->itemSize > 0) {
+        memcpy(queue->items.data() + index * queue->itemSize, item, queue->itemSize);
+    }
+    queue->count++;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if(!wait(queue, lock, ticksToWait, [queue]() { return queue->count > 0; })) {
+        return errQUEUE_EMPTY;
+    }
+    if(queue->itemSize > 0) {
+        memcpy(buffer, queue->items.data() + queue->head * queue->itemSize, queue->itemSize);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if(!wait(queue, lock, ticksToWait, [queue]() { return queue->count > 0; })) {
+        return errQUEUE_EMPTY;
+    }
+    if(queue->itemSize > 0) {
+        memcpy(buffer, queue->items.data() + queue->head * queue->itemSize, queue->itemSize);
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->head = 0;
+    queue->count = 0;
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->length - queue->count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    SemaphoreHandle_t semaphore = xQueueCreate(maxCount, 0);
+    if(semaphore != NULL) {
+        semaphore->count = initialCount;
+    }
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    return xQueueReceive(semaphore, NULL, ticksToWait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    return xQueueSendToBack(semaphore, NULL, 0);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    return uxQueueMessagesWaiting(semaphore);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    vQueueDelete(semaphore);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if(ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount() {
+    static const std::chrono::steady_clock::time_point boot = std::chrono::steady_clock::now();
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - boot).count() / portTICK_PERIOD_MS;
+}
@@ -0,0 +1,34 @@
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * [INFO]
+ * Host shim of the FreeRTOS API used by the firmware. Like in FreeRTOS, semaphores are queues
+ * of items without data: a mutex is a queue of length one holding one item, a binary semaphore is
+ * the same queue holding no item. Queues block on a condition variable, one tick is one
+ * millisecond. Mutexes do not inherit priorities and do not check their holder.
+ */
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL) // waits forever
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+#define configASSERT(x) do { if(!(x)) { abort(); } } while(0)
+
+#endif /* NATIVE_FREERTOS_H */
@@ -0,0 +1,12 @@
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+// Tasks are host threads started by the caller, only their timing functions are provided:
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+#define taskYIELD() vTaskDelay(0)
+
+#endif /* NATIVE_FREERTOS_TASK_H */
@@ -1,6 +1,8 @@
 #include "Config.h"
+#include "WriteStats.h"
 
 #define MUTEX_TIMEOUT (2*1000)/portTICK_PERIOD_MS // 2000 ms
+#define CONFIG_OWNER "nvs:" // prefix of the owners the NVS commits are counted for, see 'WriteStats'
 
 /**
  * Default constructor initalizes the preferences and mounts the flash memory
@@ -35,15 +37,17 @@ void ConfigClass::storePumpInterval(interval_t interval, size_t index) {
     sprintf(wdayString, "wday_%02d", index);
 
     // Write to Memory:
+    size_t bytes = 0; // bytes committed
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putUChar(startHrString, interval.start.tm_hour);
-    this->preferences.putUChar(startMinString, interval.start.tm_min);
-    this->preferences.putUChar(stopHrString, interval.stop.tm_hour);
-    this->preferences.putUChar(stopMinString, interval.stop.tm_min);
-    this->preferences.putUChar(wdayString, interval.wday);
+    bytes += this->preferences.putUChar(startHrString, interval.start.tm_hour);
+    bytes += this->preferences.putUChar(startMinString, interval.start.tm_min);
+    bytes += this->preferences.putUChar(stopHrString, interval.stop.tm_hour);
+    bytes += this->preferences.putUChar(stopMinString, interval.stop.tm_min);
+    bytes += this->preferences.putUChar(wdayString, interval.wday);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "interval", bytes, 5);
 }
 
 /**
@@ -143,60 +147,116 @@ void ConfigClass::deletePumpInterval(size_t index) {
     this->preferences.remove(wdayString);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "interval", 0, 5);
 }
 
 /**
  * Write the number of jobs into preferences
  * @param jobLength number to store
+ * @param list name of the job list (max. 9 characters)
  */
-void ConfigClass::storeJobLength(size_t jobLength) {
+void ConfigClass::storeJobLength(size_t jobLength, const char* list) {
+    // Build Length Key:
+    char lengthKey[16]; // format: LISTLength
+    snprintf(lengthKey, sizeof(lengthKey), "%sLength", list);
+
+    // Write To Memory:
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putUChar("jobLength", jobLength);
+    size_t bytes = this->preferences.putUChar(lengthKey, jobLength);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit((CONFIG_OWNER + std::string(list)).c_str(), bytes, 1);
 }
 
 /**
  * Read the number of jobs from preferences
+ * @param list name of the job list
  * @return number of jobs available
  */
-size_t ConfigClass::loadJobLength() {
+size_t ConfigClass::loadJobLength(const char* list) {
+    // Build Length Key:
+    char lengthKey[16]; // format: LISTLength
+    snprintf(lengthKey, sizeof(lengthKey), "%sLength", list);
+
+    // Read From Memory:
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, true);
-    size_t jl = (size_t)this->preferences.getUChar("jobLength", 0);
+    size_t jl = (size_t)this->preferences.getUChar(lengthKey, 0);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
     return jl;
 }
 
+/**
+ * Write the index of the first job into preferences, lists used as a ring start at other indices
+ * than zero
+ * @param jobStart index of the first job
+ * @param list name of the job list (max. 9 characters)
+ */
+void ConfigClass::storeJobStart(size_t jobStart, const char* list) {
+    // Build Start Key:
+    char startKey[16]; // format: LISTStart
+    snprintf(startKey, sizeof(startKey), "%sStart", list);
+
+    // Write To Memory:
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, false);
+    size_t bytes = this->preferences.putUChar(startKey, jobStart);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit((CONFIG_OWNER + std::string(list)).c_str(), bytes, 1);
+}
+
+/**
+ * Read the index of the first job from preferences
+ * @param list name of the job list
+ * @return index of the first job, zero if never stored
+ */
+size_t ConfigClass::loadJobStart(const char* list) {
+    // Build Start Key:
+    char startKey[16]; // format: LISTStart
+    snprintf(startKey, sizeof(startKey), "%sStart", list);
+
+    // Read From Memory:
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, true);
+    size_t js = (size_t)this->preferences.getUChar(startKey, 0);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    return js;
+}
+
 /**
  * Writes the given job (=filename) into preferences at the given index
  * @param fileName filename of the datafile to store
  * @param index index to write at preferences
+ * @param list name of the job list
  */
-void ConfigClass::storeJob(const char* fileName, size_t index) {
+void ConfigClass::storeJob(const char* fileName, size_t index, const char* list) {
     // Build Job Key:
-    char jobKey[7]; // format: job_XX
-    sprintf(jobKey, "job_%02d", index);
+    char jobKey[16]; // format: LIST_XX
+    snprintf(jobKey, sizeof(jobKey), "%s_%02d", list, index);
 
     // Write To Memory:
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString(jobKey, fileName);
+    size_t bytes = this->preferences.putString(jobKey, fileName);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit((CONFIG_OWNER + std::string(list)).c_str(), bytes, 1);
 }
 
 /**
  * Read the job (=filename) from preferences at the given index
  * @param index index to read from
+ * @param list name of the job list
  * @return filename of datafile
  */
-std::string ConfigClass::loadJob(size_t index) {
+std::string ConfigClass::loadJob(size_t index, const char* list) {
     // Build Job Key:
-    char jobKey[7]; // format: job_XX;
-    sprintf(jobKey,"job_%02d", index);
+    char jobKey[16]; // format: LIST_XX
+    snprintf(jobKey, sizeof(jobKey), "%s_%02d", list, index);
 
     // Read From Memory:
     char buffer[50]; // max. filename length
@@ -213,11 +273,12 @@ std::string ConfigClass::loadJob(size_t index) {
 /**
  * Remove the job(=filename) from the preferences at the given index
  * @param index index to delete from
+ * @param list name of the job list
  */
-void ConfigClass::deleteJob(size_t index) {
+void ConfigClass::deleteJob(size_t index, const char* list) {
     // Build Job Key:
-    char jobKey[7]; // format: job_XX
-    sprintf(jobKey, "job_%02d", index);
+    char jobKey[16]; // format: LIST_XX
+    snprintf(jobKey, sizeof(jobKey), "%s_%02d", list, index);
 
     // Delete From Memory:
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
@@ -225,6 +286,77 @@ void ConfigClass::deleteJob(size_t index) {
     this->preferences.remove(jobKey);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit((CONFIG_OWNER + std::string(list)).c_str(), 0, 1);
+}
+
+/**
+ * Write the storage backend used for data and log files into preferences
+ * @param backend backend to store (e.g. STORAGE_SPIFFS)
+ */
+void ConfigClass::storeStorageBackend(uint8_t backend) {
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, false);
+    size_t bytes = this->preferences.putUChar("storage", backend);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
+}
+
+/**
+ * Read the storage backend used for data and log files from preferences
+ * @return backend, SPIFFS (0) if none was stored by previous firmware versions
+ */
+uint8_t ConfigClass::loadStorageBackend() {
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, true);
+    uint8_t backend = this->preferences.getUChar("storage", 0);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    return backend;
+}
+
+/**
+ * Write the number of lines of a legacy file converted so far into preferences, so an interrupted
+ * migration resumes after them
+ * @param name name of the migration (max. 7 characters)
+ * @param lines number of lines converted, 0 to remove the key once the migration is done
+ */
+void ConfigClass::storeMigratedLines(const char* name, size_t lines) {
+    // Build Key:
+    char key[16]; // format: NAMEMigrated
+    snprintf(key, sizeof(key), "%sMigrated", name);
+
+    // Write To Memory:
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, false);
+    size_t bytes = 0;
+    if(lines > 0) {
+        bytes = this->preferences.putUInt(key, lines);
+    } else {
+        this->preferences.remove(key);
+    }
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "migration", bytes, 1);
+}
+
+/**
+ * Read the number of lines of a legacy file converted so far from preferences
+ * @param name name of the migration (max. 7 characters)
+ * @return number of lines converted, 0 if no migration was interrupted
+ */
+size_t ConfigClass::loadMigratedLines(const char* name) {
+    // Build Key:
+    char key[16]; // format: NAMEMigrated
+    snprintf(key, sizeof(key), "%sMigrated", name);
+
+    // Read From Memory:
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, true);
+    size_t lines = this->preferences.getUInt(key, 0);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    return lines;
 }
 
 /**
@@ -234,9 +366,10 @@ void ConfigClass::deleteJob(size_t index) {
 void ConfigClass::storeRainThresholdLevel(uint8_t level) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putUChar("threshold", level);
+    size_t bytes = this->preferences.putUChar("threshold", level);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 /**
@@ -252,6 +385,60 @@ uint8_t ConfigClass::loadRainThresholdLevel() {
     return threshold;
 }
 
+/**
+ * Writes the minimum mode of the lines appended to the log file into preferences
+ * @param level log mode (see 'log_mode_t')
+ */
+void ConfigClass::storeLogFileLevel(uint8_t level) {
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, false);
+    size_t bytes = this->preferences.putUChar("log_file", level);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
+}
+
+/**
+ * Read the minimum mode of the lines appended to the log file from preferences memory
+ * @param fallback log mode returned if none was stored yet
+ * @return log mode from memory
+ */
+uint8_t ConfigClass::loadLogFileLevel(uint8_t fallback) {
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, true);
+    uint8_t level = (uint8_t)this->preferences.getUChar("log_file", fallback);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    return level;
+}
+
+/**
+ * Writes the minimum mode of the lines printed to serial into preferences
+ * @param level log mode (see 'log_mode_t')
+ */
+void ConfigClass::storeLogSerialLevel(uint8_t level) {
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, false);
+    size_t bytes = this->preferences.putUChar("log_serial", level);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
+}
+
+/**
+ * Read the minimum mode of the lines printed to serial from preferences memory
+ * @param fallback log mode returned if none was stored yet
+ * @return log mode from memory
+ */
+uint8_t ConfigClass::loadLogSerialLevel(uint8_t fallback) {
+    xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
+    this->preferences.begin(CONFIG_NAME, true);
+    uint8_t level = (uint8_t)this->preferences.getUChar("log_serial", fallback);
+    this->preferences.end();
+    xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    return level;
+}
+
 /**
  * Takes a mail address and stores it into flash memory
  * @param addres address string
@@ -259,9 +446,10 @@ uint8_t ConfigClass::loadRainThresholdLevel() {
 void ConfigClass::storeMailAddress(const char* address) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString("mail_address", address);
+    size_t bytes = this->preferences.putString("mail_address", address);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 /**
@@ -288,9 +476,10 @@ std::string ConfigClass::loadMailAddress() {
 void ConfigClass::storeMailPassword(const char* pw) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString("password", pw);
+    size_t bytes = this->preferences.putString("password", pw);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 /**
@@ -313,9 +502,10 @@ std::string ConfigClass::loadMailPassword() {
 void ConfigClass::storeAPIHost(const char* host) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString("host", host);
+    size_t bytes = this->preferences.putString("host", host);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 std::string ConfigClass::loadAPIHost() {
@@ -334,9 +524,10 @@ std::string ConfigClass::loadAPIHost() {
 void ConfigClass::storeAPIPort(size_t port) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putUInt("port", port);
+    size_t bytes = this->preferences.putUInt("port", port);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 size_t ConfigClass::loadAPIPort() {
@@ -351,9 +542,10 @@ size_t ConfigClass::loadAPIPort() {
 void ConfigClass::storeAPIPath(const char* path) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString("path", path);
+    size_t bytes = this->preferences.putString("path", path);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 std::string ConfigClass::loadAPIPath() {
@@ -376,9 +568,10 @@ std::string ConfigClass::loadAPIPath() {
 void ConfigClass::storeAPIUsername(const char* username) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString("api_username", username);
+    size_t bytes = this->preferences.putString("api_username", username);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 /**
@@ -405,9 +598,10 @@ std::string ConfigClass::loadAPIUsername() {
 void ConfigClass::storeAPIPassword(const char* password) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString("api_password", password);
+    size_t bytes = this->preferences.putString("api_password", password);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 /**
@@ -434,9 +628,10 @@ std::string ConfigClass::loadAPIPassword() {
 void ConfigClass::storeFirmwareVersion(const char* version) {
     xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT); // blocking wait
     this->preferences.begin(CONFIG_NAME, false);
-    this->preferences.putString("fw_version", version);
+    size_t bytes = this->preferences.putString("fw_version", version);
     this->preferences.end();
     xSemaphoreGive(this->semaphore); // give back mutex semaphore
+    WriteStats.commit(CONFIG_OWNER "settings", bytes, 1);
 }
 
 /**
@@ -7,6 +7,7 @@
 #include <vector>
 
 #define CONFIG_NAME "brunnen"
+#define JOB_LIST "job" // default job list, keys are "job_XX" and "jobLength"
 
 class ConfigClass {
 public:
@@ -18,14 +19,27 @@ public:
     void loadPumpIntervals(std::vector<interval_t>& intervals);
     void deletePumpInterval(size_t index);
 
-    void storeJobLength(size_t jobLength);
-    size_t loadJobLength();
-    void storeJob(const char* fileName, size_t index);
-    std::string loadJob(size_t index);
-    void deleteJob(size_t index);
+    void storeJobLength(size_t jobLength, const char* list = JOB_LIST);
+    size_t loadJobLength(const char* list = JOB_LIST);
+    void storeJobStart(size_t jobStart, const char* list = JOB_LIST);
+    size_t loadJobStart(const char* list = JOB_LIST);
+    void storeJob(const char* fileName, size_t index, const char* list = JOB_LIST);
+    std::string loadJob(size_t index, const char* list = JOB_LIST);
+    void deleteJob(size_t index, const char* list = JOB_LIST);
     
+    void storeStorageBackend(uint8_t backend);
+    uint8_t loadStorageBackend();
+
+    void storeMigratedLines(const char* name, size_t lines);
+    size_t loadMigratedLines(const char* name);
+
     void storeRainThresholdLevel(uint8_t level);
     uint8_t loadRainThresholdLevel();
+
+    void storeLogFileLevel(uint8_t level);
+    uint8_t loadLogFileLevel(uint8_t fallback);
+    void storeLogSerialLevel(uint8_t level);
+    uint8_t loadLogSerialLevel(uint8_t fallback);
     
     void storeMailAddress(const char* address);
     std::string loadMailAddress();
@@ -0,0 +1,392 @@
+#include "DataCodec.h"
+#include "TimeManager.h"
+#include "esp_rom_crc.h"
+
+#define RECORD_SIZE sizeof(data_record_t)
+#define FRAME_HEADER_SIZE sizeof(data_frame_header_t)
+#define CHECKSUM_SIZE sizeof(data_checksum_t)
+#define MAX_DELTA_SIZE (1 + 5 + 3 * 3) // flags, timestamp varint and three value varints
+
+// Delta Flags:
+#define DELTA_TIMESTAMP 0x01 // interval between timestamps changed
+#define DELTA_FLOW 0x02
+#define DELTA_PRESSURE 0x04
+#define DELTA_LEVEL 0x08
+
+/**
+ * @brief Encodes the given records and appends the bytes to the buffer. With DATA_CODEC_DELTA
+ * the records are split into frames of at most DATA_FRAME_LENGTH records. A frame starts with a full
+ * record (keyframe). Every following record stores a flag byte and zigzag varints of the changed
+ * fields: the change of the interval between timestamps and the deltas of flow, pressure and
+ * level. A record of a steady measurement at a fixed period takes a single byte. Every frame ends
+ * with a checksum of its header and records. Without DATA_CODEC_DELTA every record is followed by
+ * a checksum instead.
+ * @param records packed records to encode, oldest first (see 'pack()')
+ * @param num number of records
+ * @param buffer buffer the encoded bytes are appended to
+ * @return true on success, false otherwise
+ */
+bool DataCodec::encode(const data_record_t* records, size_t num, std::vector<uint8_t>& buffer) {
+    buffer.reserve(buffer.size() + maxSize(num));
+#ifdef DATA_CODEC_DELTA
+    for(size_t i = 0; i < num; i += DATA_FRAME_LENGTH) {
+        size_t end = std::min(i + DATA_FRAME_LENGTH, num);
+        size_t start = buffer.size(); // position of the frame header
+        buffer.resize(start + FRAME_HEADER_SIZE);
+
+        // Write Keyframe:
+        data_record_t previous = records[i];
+        const uint8_t* bytes = (const uint8_t*)&previous;
+        buffer.insert(buffer.end(), bytes, bytes + RECORD_SIZE);
+
+        // Write Deltas:
+        int32_t interval = 0; // seconds between the last two records
+        for(size_t j = i + 1; j < end; j++) {
+            const data_record_t& record = records[j];
+            int32_t delta = (int32_t)(record.timestamp - previous.timestamp);
+            int32_t deltas[4] = {
+                delta - interval,
+                (int32_t)record.flow - previous.flow,
+                (int32_t)record.pressure - previous.pressure,
+                (int32_t)record.level - previous.level
+            };
+            uint8_t flags = 0;
+            for(size_t k = 0; k < 4; k++) {
+                if(deltas[k] != 0) {
+                    flags |= 1 << k;
+                }
+            }
+            buffer.push_back(flags);
+            for(size_t k = 0; k < 4; k++) {
+                if(deltas[k] != 0) {
+                    putVarint(buffer, deltas[k]);
+                }
+            }
+            interval = delta;
+            previous = record;
+        }
+
+        // Write Frame Header:
+        data_frame_header_t header = {
+            .sync = DATA_FRAME_SYNC,
+            .count = (uint8_t)(end - i),
+            .length = (uint16_t)(buffer.size() + CHECKSUM_SIZE - start - FRAME_HEADER_SIZE)
+        };
+        memcpy(buffer.data() + start, &header, FRAME_HEADER_SIZE);
+
+        // Write Checksum:
+        data_checksum_t crc = checksum(buffer.data() + start, buffer.size() - start);
+        const uint8_t* crcBytes = (const uint8_t*)&crc;
+        buffer.insert(buffer.end(), crcBytes, crcBytes + CHECKSUM_SIZE);
+    }
+#else
+    for(size_t i = 0; i < num; i++) {
+        const uint8_t* bytes = (const uint8_t*)&records[i];
+        data_checksum_t crc = checksum(bytes, RECORD_SIZE);
+        buffer.insert(buffer.end(), bytes, bytes + RECORD_SIZE);
+        buffer.insert(buffer.end(), (const uint8_t*)&crc, (const uint8_t*)&crc + CHECKSUM_SIZE);
+    }
+#endif
+    return true;
+}
+
+/**
+ * @brief Decodes records from the given bytes and calls the callback for each of them, one at a
+ * time. Only entire frames are decoded, and only as long as they fit into 'max' items. A frame is
+ * checked (structure and checksum) before its first item is passed. Decoding stops at the first
+ * frame that is incomplete, does not fit or is corrupted.
+ * @param buffer encoded bytes, starting at a frame
+ * @param len number of bytes in buffer
+ * @param max maximum number of items to decode
+ * @param callback function called with each item, returns false to stop decoding. A frame
+ * stopped this way does not count as decoded.
+ * @param corrupt set to true if decoding stopped at a corrupted frame, see 'resync()'
+ * @return number of bytes of the entirely decoded frames
+ */
+size_t DataCodec::decode(const uint8_t* buffer, size_t len, size_t max, const std::function<bool(const data_record_t& record)>& callback, bool& corrupt) {
+    corrupt = false;
+#ifdef DATA_CODEC_DELTA
+    size_t position = 0;
+    size_t decoded = 0;
+    while(position + FRAME_HEADER_SIZE <= len) {
+        // Check Frame Header:
+        data_frame_header_t header;
+        memcpy(&header, buffer + position, FRAME_HEADER_SIZE);
+        size_t crcSize = header.sync == DATA_FRAME_SYNC ? CHECKSUM_SIZE : 0; // legacy frames have no checksum
+        if(!plausible(header)) {
+            corrupt = true;
+            break;
+        }
+        if(position + FRAME_HEADER_SIZE + header.length > len || decoded + header.count > max) {
+            break; // frame incomplete or does not fit
+        }
+
+        // Check Frame:
+        const uint8_t* frame = buffer + position + FRAME_HEADER_SIZE;
+        size_t frameLength = header.length - crcSize;
+        if(crcSize > 0) {
+            data_checksum_t crc;
+            memcpy(&crc, frame + frameLength, CHECKSUM_SIZE);
+            if(crc != checksum(buffer + position, FRAME_HEADER_SIZE + frameLength)) {
+                corrupt = true;
+                break;
+            }
+        }
+        if(decodeFrame(frame, frameLength, NULL) != header.count) {
+            corrupt = true;
+            break;
+        }
+
+        // Decode Frame:
+        if(decodeFrame(frame, frameLength, &callback) != header.count) {
+            break; // stopped by callback
+        }
+        position += FRAME_HEADER_SIZE + header.length;
+        decoded += header.count;
+    }
+    return position;
+#else
+    const size_t size = RECORD_SIZE + CHECKSUM_SIZE;
+    size_t num = std::min(len / size, max);
+    for(size_t i = 0; i < num; i++) {
+        data_record_t record;
+        data_checksum_t crc;
+        memcpy(&record, buffer + i * size, RECORD_SIZE);
+        memcpy(&crc, buffer + i * size + RECORD_SIZE, CHECKSUM_SIZE);
+        if(crc != checksum((const uint8_t*)&record, RECORD_SIZE)) {
+            corrupt = true;
+            return i * size;
+        }
+        if(!callback(record)) {
+            return i * size; // stopped by callback
+        }
+    }
+    return num * size;
+#endif
+}
+
+/**
+ * @brief Searches the given bytes for the next plausible frame header after the first byte. Use
+ * this to skip a corrupted frame reported by 'decode()'. Without DATA_CODEC_DELTA the corrupted
+ * record is skipped.
+ * @param buffer encoded bytes, starting at the corrupted frame
+ * @param len number of bytes in buffer
+ * @param items set to the number of records of the corrupted frame if its header is intact (only
+ * the records are corrupted), 0 otherwise
+ * @return number of bytes to skip ('len' if there is no frame header in the buffer)
+ */
+size_t DataCodec::resync(const uint8_t* buffer, size_t len, size_t& items) {
+#ifdef DATA_CODEC_DELTA
+    data_frame_header_t header;
+    items = 0;
+    if(len >= FRAME_HEADER_SIZE) {
+        memcpy(&header, buffer, FRAME_HEADER_SIZE);
+        items = plausible(header) ? header.count : 0;
+    }
+    for(size_t i = 1; i + FRAME_HEADER_SIZE <= len; i++) {
+        memcpy(&header, buffer + i, FRAME_HEADER_SIZE);
+        if(plausible(header)) {
+            return i;
+        }
+    }
+    return len;
+#else
+    items = len >= RECORD_SIZE + CHECKSUM_SIZE ? 1 : 0;
+    return std::min(len, RECORD_SIZE + CHECKSUM_SIZE);
+#endif
+}
+
+/**
+ * @brief Checks if the given frame header is plausible, i.e. its fields are within their limits
+ * @param header frame header to check
+ * @return true if plausible, false otherwise
+ */
+bool DataCodec::plausible(const data_frame_header_t& header) {
+    size_t crcSize = header.sync == DATA_FRAME_SYNC ? CHECKSUM_SIZE : 0; // legacy frames have no checksum
+    return (header.sync == DATA_FRAME_SYNC || header.sync == DATA_FRAME_SYNC_LEGACY) && header.count > 0 && header.count <= DATA_FRAME_LENGTH &&
+           header.length >= RECORD_SIZE + crcSize && header.length <= RECORD_SIZE + (header.count - 1) * MAX_DELTA_SIZE + crcSize;
+}
+
+/**
+ * Tries to parse a record from the given line of a legacy data file (CSV format)
+ * @param line view of the CSV line in format TIME,FLOW,PRESSURE,LEVEL
+ * @param record record to be filled with parsed values
+ * @return true on success, false if one of values failed to parse
+ */
+bool DataCodec::parse(std::string_view line, data_record_t& record) {
+    // Copy Into Local String Buffer:
+    size_t len = line.size();
+    char buffer[len+1];
+    memcpy(buffer, line.data(), len);
+    buffer[len] = '\0';
+
+    // Parse Time String:
+    sensor_data_t data;
+    char* token = strtok(buffer,",");
+    if(token == NULL) {
+        return false;
+    }
+    if(!TimeManager::fromDateTimeString(token, data.timestamp)) {
+        return false;
+    }
+
+    // Parse Flow Value:
+    token = strtok(NULL, ",");
+    if(token == NULL) {
+        return false;
+    }
+    data.flow = atoi(token);
+
+    // Parse Pressure Value:
+    token = strtok(NULL, ",");
+    if(token == NULL) {
+        return false;
+    }
+    data.pressure = atoi(token);
+
+    // Parse Level Value:
+    token = strtok(NULL, ",");
+    if(token == NULL) {
+        return false;
+    }
+    data.level = atoi(token);
+
+    // Return Success:
+    record = pack(data);
+    return true;
+}
+
+/**
+ * @brief Get the maximum number of bytes 'num' items take when encoded
+ * @param num number of items
+ * @return number of bytes
+ */
+size_t DataCodec::maxSize(size_t num) {
+#ifdef DATA_CODEC_DELTA
+    size_t frames = (num + DATA_FRAME_LENGTH - 1) / DATA_FRAME_LENGTH;
+    return frames * (FRAME_HEADER_SIZE + RECORD_SIZE + CHECKSUM_SIZE) + num * MAX_DELTA_SIZE;
+#else
+    return num * (RECORD_SIZE + CHECKSUM_SIZE);
+#endif
+}
+
+/**
+ * @brief Packs the given sensor data into a fixed-size binary record. Sensor values are
+ * clamped to the range of the record fields.
+ * @param data sensor data to pack
+ * @return binary record
+ */
+data_record_t DataCodec::pack(const sensor_data_t& data) {
+    auto clamp = [](int value) { return (uint16_t)std::min(std::max(value, 0), (int)UINT16_MAX); };
+    data_record_t record = {
+        .timestamp = (uint32_t)TimeManager::toEpoch(data.timestamp),
+        .flow = clamp(data.flow),
+        .pressure = clamp(data.pressure),
+        .level = clamp(data.level)
+    };
+    return record;
+}
+
+/**
+ * @brief Unpacks the given binary record into sensor data
+ * @param record binary record to unpack
+ * @return sensor data
+ */
+sensor_data_t DataCodec::unpack(const data_record_t& record) {
+    sensor_data_t data;
+    data.timestamp = TimeManager::fromEpoch((time_t)record.timestamp);
+    data.flow = record.flow;
+    data.pressure = record.pressure;
+    data.level = record.level;
+    return data;
+}
+
+/**
+ * @brief Calculates the checksum of the given bytes
+ * @param buffer bytes to check
+ * @param len number of bytes in buffer
+ * @return CRC16 of the bytes
+ */
+data_checksum_t DataCodec::checksum(const uint8_t* buffer, size_t len) {
+    return esp_rom_crc16_le(0, buffer, len);
+}
+
+/**
+ * @brief Decodes the records of a single frame, i.e. the keyframe and the following deltas
+ * @param buffer bytes following the frame header
+ * @param len number of bytes in the frame (length field of the frame header without checksum)
+ * @param callback function called with each record, NULL to only count the records
+ * @return number of records decoded (zero in case of error, less if stopped by the callback)
+ */
+size_t DataCodec::decodeFrame(const uint8_t* buffer, size_t len, const std::function<bool(const data_record_t& record)>* callback) {
+    const uint8_t* end = buffer + len;
+
+    // Read Keyframe:
+    data_record_t record;
+    memcpy(&record, buffer, RECORD_SIZE);
+    buffer += RECORD_SIZE;
+    if(callback && !(*callback)(record)) {
+        return 0;
+    }
+    size_t count = 1;
+
+    // Read Deltas:
+    int32_t interval = 0; // seconds between the last two records
+    while(buffer < end) {
+        uint8_t flags = *buffer++;
+        if(flags & ~(DELTA_TIMESTAMP | DELTA_FLOW | DELTA_PRESSURE | DELTA_LEVEL)) {
+            return 0; // unknown flags
+        }
+        int32_t deltas[4] = {0, 0, 0, 0};
+        for(size_t k = 0; k < 4; k++) {
+            if((flags & (1 << k)) && !getVarint(buffer, end, deltas[k])) {
+                return 0; // truncated varint
+            }
+        }
+        interval += deltas[0];
+        record.timestamp += interval;
+        record.flow += deltas[1];
+        record.pressure += deltas[2];
+        record.level += deltas[3];
+        if(callback && !(*callback)(record)) {
+            return count;
+        }
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Appends the given value as zigzag varint, i.e. small positive and negative values take
+ * a single byte
+ * @param buffer buffer to append to
+ * @param value value to encode
+ */
+void DataCodec::putVarint(std::vector<uint8_t>& buffer, int32_t value) {
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    while(zigzag >= 0x80) {
+        buffer.push_back((uint8_t)(zigzag | 0x80));
+        zigzag >>= 7;
+    }
+    buffer.push_back((uint8_t)zigzag);
+}
+
+/**
+ * @brief Reads a zigzag varint and advances the buffer behind it
+ * @param buffer position to read from, advanced on success
+ * @param end end of the readable bytes
+ * @param value decoded value
+ * @return true on success, false if the varint is truncated or too long
+ */
+bool DataCodec::getVarint(const uint8_t*& buffer, const uint8_t* end, int32_t& value) {
+    uint32_t zigzag = 0;
+    for(size_t shift = 0; shift < 35 && buffer < end; shift += 7) {
+        uint8_t byte = *buffer++;
+        zigzag |= (uint32_t)(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0) {
+            value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,59 @@
+#ifndef DATA_CODEC_H
+#define DATA_CODEC_H
+
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "Sensors.h"
+
+// Encoding:
+#define DATA_CODEC_DELTA // delta encode records in frames (comment out to store fixed-size records)
+#define DATA_FRAME_LENGTH 30 // maximum number of records per frame, each frame starts with a keyframe
+#define DATA_FRAME_SYNC 0xA6 // first byte of every frame, used to find the next frame after corruption
+#define DATA_FRAME_SYNC_LEGACY 0xA5 // first byte of frames written by previous firmware versions (without checksum)
+
+#ifdef DATA_CODEC_DELTA
+#define DATA_CODEC_FORMAT 2 // frames of both sync bytes are decoded, so records of previous versions are kept
+#else
+#define DATA_CODEC_FORMAT 3 // fixed-size records followed by a checksum each
+#endif
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp; // seconds since epoch
+    uint16_t flow;
+    uint16_t pressure;
+    uint16_t level;
+} data_record_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t sync;    // DATA_FRAME_SYNC (or DATA_FRAME_SYNC_LEGACY)
+    uint8_t count;   // number of records in this frame, including the keyframe
+    uint16_t length; // number of bytes following this header, including the checksum
+} data_frame_header_t; // followed by the records and a CRC16 of header and records
+
+typedef uint16_t data_checksum_t;
+
+class DataCodec {
+public:
+    static constexpr size_t CHUNK_SIZE = 512; // bytes read from disk at once, needs to hold an entire frame (466 bytes)
+#ifdef DATA_CODEC_DELTA
+    static constexpr size_t UNIT_LENGTH = DATA_FRAME_LENGTH; // records are decoded in entire frames
+#else
+    static constexpr size_t UNIT_LENGTH = 1;
+#endif
+    static bool encode(const data_record_t* records, size_t num, std::vector<uint8_t>& buffer);
+    static size_t decode(const uint8_t* buffer, size_t len, size_t max, const std::function<bool(const data_record_t& record)>& callback, bool& corrupt);
+    static size_t resync(const uint8_t* buffer, size_t len, size_t& items);
+    static bool parse(std::string_view line, data_record_t& record);
+    static size_t maxSize(size_t num);
+    static data_record_t pack(const sensor_data_t& data);
+    static sensor_data_t unpack(const data_record_t& record);
+private:
+    static data_checksum_t checksum(const uint8_t* buffer, size_t len);
+    static bool plausible(const data_frame_header_t& header);
+    static size_t decodeFrame(const uint8_t* buffer, size_t len, const std::function<bool(const data_record_t& record)>* callback);
+    static void putVarint(std::vector<uint8_t>& buffer, int32_t value);
+    static bool getVarint(const uint8_t*& buffer, const uint8_t* end, int32_t& value);
+};
+
+#endif /* DATA_CODEC_H */
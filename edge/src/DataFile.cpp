@@ -1,205 +1,458 @@
 #include "DataFile.h"
+#include "Config.h"
+#include "CriticalRuntime.h"
+#include "SD.h"
+#include "esp_system.h"
 
-#define MUTEX_TIMEOUT (1*1000)/portTICK_PERIOD_MS // in milliseconds
-#define MAX_CACHE_SIZE 120
+#define MIGRATION_BATCH_SIZE 60 // number of legacy lines converted at once
+#define MIGRATION_NAME "data" // name of the migration progress in the config
 
 /**
- * Constructor initalizes the file system (external SD card)
+ * @brief Get the time after the newest record of the given file, windows merged into the file
+ * later start at or after it (e.g. after a reboot)
+ * @param file file holding merged records
+ * @return seconds since epoch, 0 if the file is empty
  */
-DataFileClass::DataFileClass(const std::string& filename) : file(SPIFFS, filename) {
+static uint32_t nextWindow(RecordLog<data_record_t, DataCodec>& file) {
+    uint32_t next = 0;
+    file.scan(0, [&next](const data_record_t& record) {
+        next = std::max(next, record.timestamp + 1);
+        return true;
+    });
+    return next;
+}
+
+/**
+ * @brief Writes the mean values of the records merged into the open window to the window and
+ * closes it
+ * @param state merge state holding the open window
+ * @param merged buffer the window is added to
+ */
+static void finishWindow(merge_state_t& state, std::vector<data_record_t>& merged) {
+    state.window.flow = state.sums[0] / state.num;
+    state.window.pressure = state.sums[1] / state.num;
+    state.window.level = state.sums[2] / state.num;
+    merged.push_back(state.window);
+    state.end = state.stop;
+    state.num = 0;
+}
+
+/**
+ * Constructor initalizes the data file on top of the given record stores
+ * @param store store holding the records on disk
+ * @param coarseStore store holding the records downsampled under storage pressure (see 'relieve()')
+ * @param archiveStore store holding the records of the coarse store merged again once it is full
+ * @param indexStore store holding the time index of the disk file (see 'query()')
+ * @param minuteRollups per-minute rollups of the samples
+ * @param hourRollups per-hour rollups of the samples
+ * @param cacheMemory memory holding the cached records, left untouched until 'begin()'
+ */
+DataFileClass::DataFileClass(RecordStore& store, RecordStore& coarseStore, RecordStore& archiveStore, RecordStore& indexStore, RollupSeries& minuteRollups, RollupSeries& hourRollups, sample_cache_memory_t& cacheMemory) : file(store, "data file"), coarse(coarseStore, "coarse file"), archive(archiveStore, "archive file", true), index(indexStore), cache(cacheMemory) {
+    this->rollupSeries[ROLLUP_MINUTE] = &minuteRollups;
+    this->rollupSeries[ROLLUP_HOUR] = &hourRollups;
+    this->pressure = 0;
+    this->coarseMerge = {};
+    this->archiveMerge = {};
+    this->exportedCache = false;
+    this->exportedFile = NULL;
+    this->exportedHead = 0;
+    this->queue = xQueueCreate(DATA_QUEUE_LENGTH, sizeof(data_record_t));
+    if(this->queue == NULL) {
+        log_e("Not enough heap to use data file queue");
+    }
     this->semaphore = xSemaphoreCreateMutex();
-    if(semaphore == NULL) {
+    if(this->semaphore == NULL) {
         log_e("Not enough heap to use data file semaphore");
     }
 }
 
 /**
- * @brief Mounts the extern file system (external SD card) and initializes the file on disk
+ * @brief Mounts the storage backend and the SD card (if present) and initializes the file on disk
  * @return true on success, false otherwise
  */
 bool DataFileClass::begin() {
-    if(!SPIFFS.begin(true)) {
-        log_e("Unable to mount SPIFFS");
+    // Adopt Cache of Previous Boot:
+    esp_reset_reason_t reason = esp_reset_reason();
+    if(reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT) {
+        this->cache.discard(); // memory content is random after power loss
+    }
+    size_t adopted = this->cache.adopt();
+    if(adopted > 0) {
+        log_i("Adopted %u cached records of previous boot", adopted);
+    }
+
+    // Mount File System:
+    if(!Storage.begin()) {
+        log_e("Unable to mount %s", Storage.name());
         return false;
     }
+    if(Storage.hasSD() && !SD.exists(DATA_HISTORY_DIR) && !SD.mkdir(DATA_HISTORY_DIR)) {
+        log_e("Could not create history directory %s on SD card", DATA_HISTORY_DIR);
+    }
 
     // Initialize File:
-    if(!this->file.check()) {
-        log_w("Data file broken or not found");
-        log_d("Resetting data file");
-        if(!file.reset()) {
-            log_e("Could not reset data file");
+    if(!this->file.begin() || !this->coarse.begin() || !this->archive.begin()) {
+        return false;
+    }
+    this->coarseMerge.end = nextWindow(this->coarse); // windows carried over are lost on reboot
+    this->archiveMerge.end = nextWindow(this->archive);
+    if(!this->index.begin(this->file.size())) {
+        return false;
+    }
+    for(RollupSeries* series : this->rollupSeries) {
+        if(!series->begin()) {
+            return false;
+        }
+    }
+
+    // Convert Data of Previous Firmware Versions:
+    if(Storage.fs().exists(LEGACY_DATA_FILE)) {
+        log_i("Found legacy data file %s, migrating to binary format", LEGACY_DATA_FILE);
+        bool migrated = this->file.migrate(Storage.fs(), LEGACY_DATA_FILE, MIGRATION_BATCH_SIZE, Config.loadMigratedLines(MIGRATION_NAME), [this](const std::vector<data_record_t>& records) {
+            return this->appendRecords(records);
+        }, [](size_t lines) {
+            Config.storeMigratedLines(MIGRATION_NAME, lines);
+        });
+        if(!migrated) {
+            log_e("Failed to migrate legacy data file");
             return false;
         }
     }
 
-    log_d("Reusing existing data file (data file passed check)");
     return true;
 }
 
 /**
- * Takes the given sensor data and writes it as a new item to this data file.
+ * Takes the given sensor data and queues it as a new item for this data file. This never blocks,
+ * the item is written by the storage task calling 'persist()'.
  * @param data sensor data to be stored to file
- * @return true on success, false otherwise
+ * @return true on success, false if the queue is full
  */
 bool DataFileClass::store(sensor_data_t data) {
-    // Store Sensor Data:
-    size_t cacheSize = this->cache.size();
-    if(cacheSize < MAX_CACHE_SIZE) { // check if cache is not full
-        if(!xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT)) { // blocking wait
-            log_e("Could not take semaphore");
-            return false;
+    data_record_t record = DataCodec::pack(data);
+    if(this->queue == NULL || xQueueSend(this->queue, &record, 0) != pdTRUE) {
+        log_e("Failed to store sensor data because queue is full");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Waits for the next queued item, adds it to the rollups and moves it into the cache. Once the
+ * cache is (nearly) full, the cached items are written to the disk file in one batch.
+ * @param timeout maximum number of ticks to wait for an item
+ * @return true if an item was stored, false on timeout or error
+ * @note Call from the storage task only, it is the single producer of the cache
+ */
+bool DataFileClass::persist(TickType_t timeout) {
+    data_record_t record;
+    if(this->queue == NULL || xQueueReceive(this->queue, &record, timeout) != pdTRUE) {
+        return false;
+    }
+    for(RollupSeries* series : this->rollupSeries) {
+        if(!series->add(record)) {
+            log_w("Failed to update rollups (%u s)", series->resolution());
         }
-        this->cache.push_back(data);
-        if(!xSemaphoreGive(this->semaphore)) { // give back mutex semaphore
-            log_d("Failed to give semaphore");
+    }
+    return this->cacheRecord(record);
+}
+
+/**
+ * Extracts sensor data from this file into the given buffer. Oldest data is exported first. At
+ * most 'data.capacity()' items are exported.
+ * @param data buffer to be filled. Needs to be allocated with reserve(), so 'data.capacity()'
+ * works
+ * @return true on success, false otherwise
+ */
+bool DataFileClass::exportData(std::vector<sensor_data_t>& data) {
+    bool success = this->forEach(data.capacity(), [&data](const sensor_data_t& element) {
+        data.push_back(element);
+        return true;
+    });
+    log_d("Exported %d/%d lines", data.size(), data.capacity());
+    return success;
+}
+
+/**
+ * Calls the given callback for the oldest items of this file, one at a time. Items are decoded
+ * from the disk file in chunks of DataCodec::CHUNK_SIZE bytes, so the memory used does not
+ * depend on 'maxItems'. Like 'exportData()' this visits either items of the archive file, of the
+ * coarse file, of the disk file or of the cache, oldest first.
+ * @param maxItems maximum number of items to visit
+ * @param callback function called with each item, returns false to stop. Count the visited items
+ * to shrink this file by that number afterwards. Do not access this file from within the callback.
+ * @return true on success, false otherwise
+ */
+bool DataFileClass::forEach(size_t maxItems, const std::function<bool(const sensor_data_t& data)>& callback) {
+    RecordLog<data_record_t, DataCodec>& file = this->oldest();
+    size_t fCount = file.count();
+    if(fCount) { // check if file holds any records
+        log_d("Export from %s file (file holds %u records)", &file == &this->file ? "disk" : "merged", fCount);
+
+        // Decode Records From File:
+        size_t items = file.exportRecords(maxItems, [&callback](const data_record_t& record) {
+            return callback(DataCodec::unpack(record));
+        });
+        if(items == 0) {
+            log_w("No records read from disk file, despite the file is not empty");
             return false;
         }
+        this->exportedCache = false;
+        this->exportedFile = &file;
+        log_d("Decoded %u records from disk", items);
     } else {
-        log_e("Failed to store sensor data because cache is full");
-    }
+        log_d("Export from cache (cache size = %u elements)",this->cache.size());
 
-    // Check Cache Size:
-    if(cacheSize < MAX_CACHE_SIZE - 2) {
-        return true; // cache is not full, no data reallocation needed   
+        // Visit Cached Items:
+        uint32_t from = this->cache.begin();
+        uint32_t to = from + std::min(this->cache.size(), maxItems);
+        size_t items = 0;
+        for(uint32_t index = from; index != to; index++) {
+            data_record_t record;
+            if(!this->cache.read(index, record)) {
+                break; // flushed to disk file meanwhile
+            }
+            items++;
+            if(!callback(DataCodec::unpack(record))) {
+                break;
+            }
+        }
+        this->exportedCache = true;
+        this->exportedFile = NULL;
+        this->exportedHead = from;
     }
 
-    // [INFO]
-    // At this point we need to reallocate data from cache (RAM) to disk file
-    log_d("cache is (nearly) full [size = %u], copy data to file", cacheSize); 
+    return true;
+}
 
-    // Make Local Copy of Cache:
-    std::vector<sensor_data_t> cacheCopy; // local copy of cache for critical section
-    if(!xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT)) { // blocking wait
+/**
+ * Strips the first 'num' items of this file. The first item after shrinking, will be index
+ * 'num'. Because 'exportData()' only exports items either from cache, archive, coarse or disk file,
+ * this method does only shrink one of them. If the exported items were flushed from cache to
+ * disk file in the meantime, they are stripped from the disk file instead. It is intended to be
+ * used in combination with 'exportData()'
+ * @param num line number of the first line to keep 
+ * @return true on success, false otherwise
+ * @note Use this method after you successfully exported items with 'exportData()'
+ */
+bool DataFileClass::shrink(size_t num) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
         log_e("Could not take semaphore");
         return false;
     }
-    cacheCopy.assign(this->cache.begin(), this->cache.end());
-    if (!xSemaphoreGive(this->semaphore)) {
-        log_d("Failed to give semaphore (copy)");
-        return false;
-    }
 
-    // Stringify Cache Data:
-    std::string buffer;
-    buffer.reserve(cacheCopy.size() * DATA_STRING_LENGTH);
-    for(const sensor_data_t& data : cacheCopy) {
-        char line[DATA_STRING_LENGTH]; // format: "TIME,FLOW,PRESSURE,LEVEL<CR><NL>"
-        size_t bytes = snprintf(line, sizeof(line), "%s,%d,%d,%d\r\n", TimeManager::toString(data.timestamp).c_str(), data.flow, data.pressure, data.level);
-        if(bytes >= sizeof(line)) {
-            log_w("Formatted line exceeded buffer size (increase DATA_STRING_LENGTH)");
-            return false;
-        }
-        if(bytes == 0) {
-            log_e("Failed to build line from sensor data");
-            return false;
+    // Shrink Exported Cache:
+    if(this->exportedCache) {
+        this->exportedCache = false;
+        log_d("shrink cache by %u items", num);
+        if(this->cache.consume(this->exportedHead, num)) {
+            return true;
         }
-        buffer.append(line, bytes);
+        log_d("Cached items were flushed to disk file meanwhile, shrink disk file instead");
+        return this->file.shrink(num, true);
     }
 
-    // Copy Buffer to File:
-    if(!this->file.append(buffer)) {
-        log_e("Failed to write buffer to data file");
-        return false;
+    // Shrink Exported File:
+    if(this->exportedFile) {
+        RecordLog<data_record_t, DataCodec>* file = this->exportedFile;
+        this->exportedFile = NULL;
+        return file->shrink(num, false);
+    }
+
+    // Shrink Disk File:
+    if(this->file.count()) { // check if file holds any records
+        return this->file.shrink(num, false);
     }
 
-    // Clear Moved Data From Cache:
-    if(!shrinkCache(cacheCopy.size())) { // shrink by the number of items just written
+    // File Already Empty, Shrink Cache Instead:
+    log_d("shrink cache by %u items", num);
+    if(!this->cache.consume(this->cache.begin(), num)) {
         log_e("Failed to shrink cache");
         return false;
     }
-
-    log_d("cache shrunk [size = %u]", this->cache.size());
     return true;
 }
 
 /**
- * Extracts sensor data from this file into the given buffer. Oldest data is exported first. At
- * most 'data.capacity()' items are exported.
- * @param data buffer to be filled. Needs to be allocated with reserve(), so 'data.capacity()'
- * works
+ * @brief Strips the oldest items taken before the given time without exporting them, e.g. once
+ * they are summarized by uploaded rollups. Like 'forEach()' this strips either items of the archive
+ * file, of the coarse file, of the disk file or of the cache. Only entire frames are stripped from the files, the
+ * remaining items are stripped by the next call.
+ * @param before seconds since epoch, items taken at or after this time are kept
+ * @param maxItems maximum number of items to strip
  * @return true on success, false otherwise
  */
-bool DataFileClass::exportData(std::vector<sensor_data_t>& data) {
-    size_t fSize = this->file.size();
-    if(fSize) { // check if file is not empty
-        log_d("Export from file (file size = %u bytes)", fSize);
-
-        // Read From File:
-        std::vector<std::string> lines;
-        lines.reserve(data.capacity()); // initialize buffer
-        if(!this->file.readLines(lines)) {
-            log_e("Failed to read lines from file");
+bool DataFileClass::skip(uint32_t before, size_t maxItems) {
+    // Count Items Before:
+    size_t num = 0;
+    bool exported = this->forEach(maxItems, [&num, before](const sensor_data_t& data) {
+        if((uint32_t)TimeManager::toEpoch(data.timestamp) >= before) {
             return false;
         }
+        num++;
+        return true;
+    });
+    if(!exported) {
+        return false;
+    }
+    if(num == 0) {
+        this->exportedCache = false;
+        this->exportedFile = NULL;
+        return true; // nothing to skip
+    }
+
+    // Strip Items:
+    log_d("Skipping %u items summarized by rollups", num);
+    if(this->exportedCache) {
+        return this->shrink(num);
+    }
+    RecordLog<data_record_t, DataCodec>& file = this->exportedFile ? *this->exportedFile : this->file;
+    this->exportedFile = NULL;
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    return file.shrink(num, true);
+}
+
+/**
+ * @brief Calls the callback for each stored item taken within the given time range, oldest first,
+ * without consuming anything (see the resumable 'query()' below)
+ * @param start seconds since epoch, beginning of the range
+ * @param stop seconds since epoch, end of the range (exclusive)
+ * @param callback function called with each item, returns false to stop
+ * @return true on success, false otherwise
+ */
+bool DataFileClass::query(uint32_t start, uint32_t stop, const std::function<bool(const sensor_data_t& data)>& callback) {
+    data_query_t query = {};
+    query.start = start;
+    query.stop = stop;
+    return this->query(query, callback, portMAX_DELAY);
+}
 
-        // Sanity Check:
-        if(lines.size() == 0) {
-            log_w("No lines read from disk file, despite the file is not empty");
-            log_i("Resetting corrupted disk file");
-            this->file.reset();
+/**
+ * @brief Calls the callback for the stored items taken within the range of the given query, oldest
+ * first, without consuming anything. Reading continues where the previous call stopped (e.g. once
+ * a chunk of a response is full), so a range is read once, no matter in how many calls. The archive
+ * and the coarse file are read from their beginning, the disk file from the offset the time index
+ * gives for the start and the cache last. Items appended to a file read already (e.g. flushed from
+ * the cache) are read as well, unless visited before.
+ * @param query range and position of the query, initialize with zeros and the range
+ * @param callback function called with each item, returns false to stop. The item it returns false
+ * for is passed again by the next call.
+ * @param timeout maximum number of ticks to wait while records are appended or stripped
+ * @return true if called (the query is complete once 'query.tier' is QUERY_DONE), false on timeout
+ * @note Safe to call from any task (e.g. the web server). Items consumed by the sync task before
+ * they were read are missed.
+ */
+bool DataFileClass::query(data_query_t& query, const std::function<bool(const sensor_data_t& data)>& callback, TickType_t timeout) {
+    if(query.tier == QUERY_DONE) {
+        return true;
+    }
+    if(this->semaphore == NULL || xSemaphoreTake(this->semaphore, timeout) != pdTRUE) {
+        return false; // records are appended or stripped, try again later
+    }
+
+    // Open Query:
+    if(!query.opened) {
+        query.positions[QUERY_ARCHIVE] = this->archive.front();
+        query.positions[QUERY_COARSE] = this->coarse.front();
+        size_t offset = this->index.lookup(query.start, this->file.size());
+        log_d("Query from %u starts at offset %u of disk file", query.start, offset);
+        query.positions[QUERY_DISK] = this->file.front() + offset;
+        query.cacheIndex = this->cache.begin();
+        query.opened = true;
+    }
+
+    // Filter Items:
+    bool stopped = false;
+    auto visit = [&query, &callback, &stopped](const data_record_t& record, uint8_t tier) {
+        if(record.timestamp >= query.stop) {
+            query.tier = QUERY_DONE;
+            stopped = true;
             return false;
         }
-
-        // Parse CSV Lines:
-        for(std::string line : lines) {
-            sensor_data_t d;
-            if(parseCSVLine(line.c_str(), d)) {
-                data.push_back(d);
+        if(record.timestamp < query.start) {
+            return true; // before range, keep reading
+        }
+        if(tier < query.tier && record.timestamp <= query.last) { // appended to a file read already
+            if(tier != QUERY_DISK || record.timestamp < query.last || query.repeats > 0) {
+                query.repeats -= tier == QUERY_DISK && record.timestamp == query.last ? 1 : 0;
+                return true; // visited in the cache or merged from items visited
             }
         }
-        log_d("Parsed %d/%d lines from disk", data.size(), lines.size());
-    } else {
-        log_d("Export from cache (cache size = %u elements)",this->cache.size());
-
-        // Copy From Cache to Buffer:
-        if(!xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT)) { // blocking wait
-            log_e("Could not take semaphore");
+        if(!callback(DataCodec::unpack(record))) {
+            stopped = true;
             return false;
         }
-        auto iter = this->cache.begin(); // get cache iterator
-        auto end = std::next(iter, std::min(this->cache.size(), data.capacity())); // advance by maximum of 'capacity' steps
-        for (; iter != end; ++iter) { // iterate at most the available size of data buffer
-            sensor_data_t element = (*iter);
-            data.push_back(element);
+        if(record.timestamp != query.last) {
+            query.last = record.timestamp;
+            query.repeats = 0;
         }
-        if(!xSemaphoreGive(this->semaphore)) { // give mutex semaphore back
-            log_d("Failed to give semaphore");
-            return false;
+        query.repeats += tier == QUERY_CACHE ? 1 : 0; // flushed to the disk file later
+        return true;
+    };
+
+    // Read Files:
+    for(uint8_t tier = QUERY_ARCHIVE; tier < QUERY_FILES && tier <= query.tier && !stopped; tier++) {
+        if(this->queryFile(query, tier, visit) && tier == query.tier) {
+            query.tier++; // reached the end of the file
         }
     }
 
-    // Return Count of Actually Read Lines:
-    log_d("Exported %d/%d lines", data.size(), data.capacity());
+    // Read Cache:
+    if(query.tier == QUERY_CACHE && !stopped) {
+        if((int32_t)(this->cache.begin() - query.cacheIndex) > 0) {
+            query.cacheIndex = this->cache.begin(); // flushed to the disk file or consumed meanwhile
+        }
+        data_record_t record;
+        while(query.cacheIndex != this->cache.end() && this->cache.read(query.cacheIndex, record) && visit(record, QUERY_CACHE)) {
+            query.cacheIndex++;
+        }
+        query.tier = stopped ? query.tier : QUERY_DONE;
+    }
+
+    xSemaphoreGive(this->semaphore);
     return true;
 }
 
 /**
- * Strips the first 'num' items of this file. The first item after shrinking, will be index
- * 'num'. If there is no data on the disk file, the cache is cleared instead, following the same
- * principels. Because 'exportData()' only exports items either from cache or disk file, this
- * method does only shrink either cache or disk file. It is intended to be used in combination
- * with 'exportData()'
- * @param num line number of the first line to keep 
- * @return true on success, false otherwise
- * @note Use this method after you successfully exported items with 'exportData()'
+ * @brief Reads the given file of a query from the position reached by the previous call on. Call
+ * with semaphore taken.
+ * @param query query to continue
+ * @param tier file to read (QUERY_ARCHIVE, QUERY_COARSE or QUERY_DISK)
+ * @param visit function called with each record and the tier, returns false to stop
+ * @return true if the end of the file was reached, false if stopped
  */
-bool DataFileClass::shrink(size_t num) {
-    if(this->file.size()) { // check if file is not empty
-        log_d("shrink disk file by %u lines", num);
-        if(!this->file.shrink(num)) {
-            log_e("Failed to shrink data file");
-            return false;
-        }
-    } else { // file already empty, shrink cache instead
-        log_d("shrink cache by %u items", num);
-        if(!shrinkCache(num)) {
-            log_e("Failed to shrink cache");
-            return false;
-        }
+bool DataFileClass::queryFile(data_query_t& query, uint8_t tier, const std::function<bool(const data_record_t& record, uint8_t tier)>& visit) {
+    RecordLog<data_record_t, DataCodec>* files[QUERY_FILES] = {&this->archive, &this->coarse, &this->file};
+    RecordLog<data_record_t, DataCodec>& file = *files[tier];
+
+    // Find Position:
+    int32_t position = (int32_t)(query.positions[tier] - file.front());
+    if(position < 0) {
+        position = 0; // consumed meanwhile, continue at the oldest record
+        query.visited[tier] = 0;
     }
 
-    return true;
+    // Read Records:
+    size_t offset = position;
+    bool end = file.scan(offset, query.visited[tier], [&visit, tier](const data_record_t& record) {
+        return visit(record, tier);
+    });
+    query.positions[tier] = file.front() + offset;
+    return end;
+}
+
+/**
+ * @brief Get a rollup series to export its rollups
+ * @param series series to get (e.g. ROLLUP_MINUTE)
+ * @return rollup series
+ */
+RollupSeries& DataFileClass::rollups(rollup_series_t series) {
+    return *this->rollupSeries[series];
 }
 
 /**
@@ -207,24 +460,100 @@ bool DataFileClass::shrink(size_t num) {
  * @return true on success, false otherwise
  */
 bool DataFileClass::clear() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
     // Clear Disk File:
-    if(!this->file.reset()) {
-        log_e("Could not reset disk file");
+    if(!this->file.clear() || !this->coarse.clear() || !this->archive.clear()) {
         return false;
     }
+    this->index.reset();
+    this->coarseMerge = {};
+    this->archiveMerge = {};
+    this->exportedCache = false;
+    this->exportedFile = NULL;
 
     // Clear Cache:
-    if(!xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT)) { // blocking wait
+    this->cache.clear();
+    return true;
+}
+
+/**
+ * @brief Checks every record of the disk, coarse and archive file and drops only what cannot be
+ * decoded, instead of clearing the whole file (see 'RecordLog::recover()')
+ * @return true if the files hold no corrupted records (anymore), false otherwise
+ */
+bool DataFileClass::recover() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
         log_e("Could not take semaphore");
         return false;
     }
-    this->cache.clear();
-    if(!xSemaphoreGive(this->semaphore)) { // give back mutex semaphore
-        log_d("Failed to give semaphore");
-        return false;
+
+    bool archiveIntact = this->archive.recover();
+    bool coarseIntact = this->coarse.recover();
+    bool fileIntact = this->file.recover();
+    return archiveIntact && coarseIntact && fileIntact;
+}
+
+/**
+ * @brief Applies the storage pressure level matching the current usage (see DATA_PRESSURE_LEVELS).
+ * Instead of dropping samples once the storage is full, the oldest records are merged into
+ * aggregates of the resolution of the level and moved to the coarse file, batch by batch, until
+ * the usage drops below the lowest level. Once the coarse file is full, its oldest records are
+ * merged again into the archive file, which drops its oldest records once it is full. The history
+ * gets coarser, but has no gaps. Windows still open are written once the pressure is gone.
+ * @return minimum measurement period in milliseconds of the current level (0 if not limited)
+ * @note Call from the sync task only, like 'forEach()' and 'shrink()' it consumes the oldest records
+ */
+uint32_t DataFileClass::relieve() {
+    static const pressure_level_t levels[] = DATA_PRESSURE_LEVELS;
+    const size_t numLevels = sizeof(levels) / sizeof(levels[0]);
+
+    // Find Level:
+    uint8_t used = this->usage();
+    uint8_t level = 0;
+    while(level < numLevels && used >= levels[level].usage) {
+        level++;
+    }
+    if(level != this->pressure) {
+        log_w("Storage pressure level changed from %u to %u (%u %% used)", this->pressure, level, used);
+        this->pressure = level;
     }
+    if(level == 0) {
+        // Write Windows Carried Over:
+        if(!this->closeWindow(this->archive, this->archiveMerge) || !this->closeWindow(this->coarse, this->coarseMerge)) {
+            log_w("Failed to write merged windows carried over");
+        }
+        return 0; // no pressure
+    }
+    const pressure_level_t& current = levels[level - 1];
 
-    return true;
+    // Downsample Oldest Records:
+    for(size_t i = 0; i < DATA_PRESSURE_BATCHES && current.resolution > 0 && used >= levels[0].usage; i++) {
+        if(this->downsample(current.resolution) == 0) {
+            break; // nothing left to merge or in case of error
+        }
+        used = this->usage();
+    }
+    return current.period;
+}
+
+/**
+ * @brief Get the usage of the storage, i.e. the larger of the usage of the disk file capacity and
+ * of the file system
+ * @return percentage of the storage used
+ */
+uint8_t DataFileClass::usage() {
+    size_t used = this->file.size();
+    size_t total = used + this->file.store().available();
+    uint8_t fileUsage = total > 0 ? (uint8_t)((uint64_t)used * 100 / total) : 100;
+    uint64_t fsTotal = Storage.totalBytes();
+    uint8_t fsUsage = fsTotal > 0 ? (uint8_t)(Storage.usedBytes() * 100 / fsTotal) : 100;
+    return std::max(fileUsage, fsUsage);
 }
 
 /**
@@ -232,100 +561,263 @@ bool DataFileClass::clear() {
  * @return item counter (items in cache and disk file combined)
  */
 size_t DataFileClass::itemCount() {
-    size_t counter = 0; // total count
+    size_t queued = this->queue ? uxQueueMessagesWaiting(this->queue) : 0;
+    return this->archive.count() + this->coarse.count() + this->file.count() + this->cache.size() + queued; // all kept as counters, no need to scan
+}
 
-    // Item Count of Disk File:
-    counter += this->file.lineCount();
+/**
+ * @brief Appends the record to the cache and moves the cache to the disk file once it is (nearly)
+ * full.
+ * @param record record to append
+ * @return true on success, false otherwise
+ */
+bool DataFileClass::cacheRecord(const data_record_t& record) {
+    // Store Sensor Data:
+    if(!this->cache.push(record)) {
+        log_e("Failed to store sensor data because cache is full");
+    }
 
-    // Item Count of Cache:
-    if(!xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT)) { // blocking wait
-        log_e("Could not take semaphore");
-        return false;
+    // Check Cache Size:
+    size_t cacheSize = this->cache.size();
+    if(cacheSize < SAMPLE_CACHE_SIZE - 2) {
+        return true; // cache is not full, no data reallocation needed   
     }
-    counter += this->cache.size();
-    if(!xSemaphoreGive(this->semaphore)) { // give back mutex semaphore
-        log_d("Failed to give semaphore");
+
+    // [INFO]
+    // At this point we need to reallocate data from cache (RAM) to disk file
+    log_d("cache is (nearly) full [size = %u], copy data to file", cacheSize); 
+
+    // Move Records to File:
+    if(!this->flushCache()) {
         return false;
     }
 
-    return counter;
+    // Migrate Sealed Segments:
+    if(!this->file.store().maintain()) {
+        log_w("Failed to maintain data file, retrying after next flush");
+    }
+
+    log_d("cache shrunk [size = %u]", this->cache.size());
+    return true;
 }
 
 /**
- * Tries to parse sensor data from the given line (CSV format) into the sensor data.
- * @param line string holding the CSV line in format TIME,FLOW,PRESSURE,LEVEL
- * @param data sensor data struct to be filled with parsed values
- * @return true on success, false if one of values failed to parse
+ * @brief Moves the cached records to the disk file in one batch and indexes them. Holds the
+ * semaphore, so a query sees the records either in the cache or in the disk file.
+ * @return true on success, false otherwise
  */
-bool DataFileClass::parseCSVLine(const char line[], sensor_data_t& data) {
-    // Copy Into Local String Buffer:
-    size_t len = strlen(line);
-    char buffer[len+1];
-    strncpy(buffer, line, len+1);
-
-    // Parse Time String:
-    char* token = strtok(buffer,",");
-    if(token == NULL) {
+bool DataFileClass::flushCache() {
+    // Claim Cached Records:
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
         return false;
     }
-    if(!TimeManager::fromDateTimeString(token, data.timestamp)) {
-        return false;
+    uint32_t from, to;
+    do {
+        from = this->cache.begin();
+        to = this->cache.end();
+    } while(!this->cache.claim(from, to - from)); // sync task consumed records meanwhile, retry
+
+    // Encode Claimed Records in Place:
+    std::vector<uint8_t> buffer;
+    uint32_t timestamp = 0; // time of the first record
+    for(uint32_t index = from; index != to;) {
+        const data_record_t* records;
+        size_t num = this->cache.span(index, to, records);
+        if(index == from && num > 0) {
+            timestamp = records[0].timestamp;
+        }
+        if(!DataCodec::encode(records, num, buffer)) {
+            log_e("Failed to encode %u records", num);
+            this->cache.rewind(from, to);
+            return false;
+        }
+        index += num;
     }
 
-    // Parse Flow Value:
-    token = strtok(NULL, ",");
-    if(token == NULL) {
+    // Copy Records to File:
+    if(!this->file.push(buffer, to - from)) {
+        log_e("Failed to write records to data file");
+        this->cache.rewind(from, to); // keep records in cache to retry with the next sample
         return false;
     }
-    data.flow = atoi(token);
+    this->cache.commit(to); // records are stored, a reboot does not adopt them anymore
+    if(!this->index.append(timestamp, buffer.size(), this->file.size())) {
+        log_w("Failed to update time index");
+    }
+    return true;
+}
 
-    // Parse Pressure Value:
-    token = strtok(NULL, ",");
-    if(token == NULL) {
-        return false;
+/**
+ * @brief Moves the oldest batch of records of the disk file to the coarse file, merged into one
+ * record per 'resolution' seconds (see 'merge()'). If the coarse file has no room left for them,
+ * its oldest records are merged into the archive file first.
+ * @param resolution seconds merged into one record
+ * @return number of records stripped from the disk file (zero if none or in case of error)
+ */
+size_t DataFileClass::downsample(uint16_t resolution) {
+    // Make Room in Coarse File:
+    while(this->coarse.store().available() < DataCodec::maxSize(DATA_PRESSURE_BATCH)) {
+        log_d("Coarse file is full, merging its oldest records into %u seconds", DATA_ARCHIVE_RESOLUTION);
+        if(this->merge(this->coarse, this->archive, DATA_ARCHIVE_RESOLUTION, this->archiveMerge) == 0) {
+            log_w("Failed to make room in coarse file");
+            return 0;
+        }
     }
-    data.pressure = atoi(token);
 
-    // Parse Level Value:
-    token = strtok(NULL, ",");
-    if(token == NULL) {
-        return false;
+    // Merge Oldest Records of Disk File:
+    return this->merge(this->file, this->coarse, resolution, this->coarseMerge);
+}
+
+/**
+ * @brief Merges the oldest batch of records of 'from' into one record per 'resolution' seconds
+ * (mean values, timestamp at the beginning of the window) and moves these to 'to'. Only complete
+ * windows are written, the partial sums of the window still open at the end of the batch are
+ * carried over to the next batch in 'state'. A window starts no earlier than the end of the window
+ * written before, so the timestamps keep increasing if the resolution changes in between. The
+ * merged records are appended to 'to' before they are stripped from 'from', so a power loss in
+ * between duplicates records instead of losing them.
+ * @param from file to strip the oldest records from
+ * @param to file to append the merged records to
+ * @param resolution seconds merged into one record
+ * @param state window carried over between the batches of the same files
+ * @return number of records stripped from 'from' (zero if none or in case of error)
+ */
+size_t DataFileClass::merge(RecordLog<data_record_t, DataCodec>& from, RecordLog<data_record_t, DataCodec>& to, uint16_t resolution, merge_state_t& state) {
+    // Merge Oldest Records:
+    merge_state_t next = state; // taken over once the merged records are written
+    std::vector<data_record_t> merged;
+    size_t items = from.exportRecords(DATA_PRESSURE_BATCH, [&next, &merged, resolution](const data_record_t& record) {
+        if(record.timestamp < next.end) {
+            return true; // merged already, stripping was interrupted
+        }
+        if(next.num > 0 && record.timestamp >= next.stop) {
+            finishWindow(next, merged);
+        }
+        if(next.num == 0) {
+            uint32_t start = record.timestamp - record.timestamp % resolution;
+            next.window.timestamp = std::max(start, next.end);
+            next.stop = start + resolution;
+            next.sums[0] = next.sums[1] = next.sums[2] = 0;
+        }
+        next.sums[0] += record.flow;
+        next.sums[1] += record.pressure;
+        next.sums[2] += record.level;
+        next.num++;
+        return true;
+    });
+    if(items == 0) {
+        return 0;
     }
-    data.level = atoi(token);
 
-    // Return Success:
-    return true;
+    // Move Merged Records:
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    if(!merged.empty() && !to.append(merged.data(), merged.size())) {
+        log_w("Failed to append %u merged records", merged.size());
+        return 0;
+    }
+    state = next;
+    if(!from.shrink(items, false)) {
+        log_e("Failed to strip %u merged records", items);
+        state.num = 0; // records of the open window are merged again by the next batch
+        return 0;
+    }
+    log_d("Merged %u records into %u records of %u seconds", items, merged.size(), resolution);
+    return items;
 }
 
 /**
- * @brief Removes the given numbers of elements from the front of the cache.
- * @param num number of elements to remove
- * @return 
+ * @brief Writes the window carried over in 'state' to 'to', although it is not complete. The
+ * remaining records of the window start a new window once merged.
+ * @param to file to append the window to
+ * @param state merge state holding the open window
+ * @return true on success or if no window is open, false otherwise
  */
-bool DataFileClass::shrinkCache(size_t num) {
-    // Take Mutex Semaphore:
-    if(!xSemaphoreTake(this->semaphore, MUTEX_TIMEOUT)) { // blocking wait
+bool DataFileClass::closeWindow(RecordLog<data_record_t, DataCodec>& to, merge_state_t& state) {
+    if(state.num == 0) {
+        return true; // no window open
+    }
+    merge_state_t next = state;
+    std::vector<data_record_t> merged;
+    finishWindow(next, merged);
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
         log_e("Could not take semaphore");
         return false;
     }
+    if(!to.append(merged.data(), merged.size())) {
+        return false;
+    }
+    next.end = next.window.timestamp + 1; // remaining records of the window are newer
+    state = next;
+    return true;
+}
 
-    bool success = true;
-    for(size_t i = 0; i < num; i++) {
-        if(this->cache.empty()) {
-            log_e("Unexpected state: Cache already empty after shrinking element %u/%u", i, num);
-            success = false;
-            break;
-        }
-        this->cache.pop_front();
+/**
+ * @brief Get the file holding the oldest records, which is exported first
+ * @return archive file, coarse file or disk file, the first one holding any records
+ */
+RecordLog<data_record_t, DataCodec>& DataFileClass::oldest() {
+    if(this->archive.count()) {
+        return this->archive;
     }
+    if(this->coarse.count()) {
+        return this->coarse;
+    }
+    return this->file;
+}
 
-    // Give Mutex Semaphore Back:
-    if(!xSemaphoreGive(this->semaphore)) { // give back mutex semaphore
-        log_d("Failed to give semaphore");
+/**
+ * @brief Encodes the given records, appends them to the disk file and indexes them
+ * @param records records to append, oldest first
+ * @return true on success, false otherwise
+ */
+bool DataFileClass::appendRecords(const std::vector<data_record_t>& records) {
+    std::vector<uint8_t> buffer;
+    if(!DataCodec::encode(records.data(), records.size(), buffer)) {
+        log_e("Failed to encode %u records", records.size());
         return false;
     }
-
-    return success;
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    if(!this->file.push(buffer, records.size())) {
+        return false;
+    }
+    if(!records.empty() && !this->index.append(records.front().timestamp, buffer.size(), this->file.size())) {
+        log_w("Failed to update time index");
+    }
+    return true;
 }
 
-DataFileClass DataFile = DataFileClass("/data.txt");
\ No newline at end of file
+RingFile coarseStore = RingFile(Storage.fs(), "/coarse.bin", DATA_COARSE_CAPACITY, DATA_FILE_FORMAT);
+RingFile archiveStore = RingFile(Storage.fs(), "/archive.bin", DATA_ARCHIVE_CAPACITY, DATA_FILE_FORMAT);
+RingFile indexStore = RingFile(Storage.fs(), "/data.idx", DATA_INDEX_CAPACITY, TIME_INDEX_FORMAT);
+#if defined(DATA_FILE_PARTITION)
+PartitionLog dataStore = PartitionLog(DATA_FILE_PARTITION, DATA_FILE_FORMAT);
+#elif defined(DATA_FILE_SEGMENTS) && defined(SD_CARD) && STORAGE_BACKEND != STORAGE_SD
+SegmentStore hotStore = SegmentStore(Storage.fs(), "/data", DATA_SEGMENT_SIZE, DATA_FILE_CAPACITY, DATA_FILE_FORMAT);
+SegmentStore historyStore = SegmentStore(SD, DATA_HISTORY_DIR "/data", DATA_HISTORY_SEGMENT_SIZE, DATA_HISTORY_CAPACITY, DATA_FILE_FORMAT, DATA_HISTORY_JOB_LIST, false);
+TieredStore dataStore = TieredStore(hotStore, historyStore); // falls back to flash only without SD card
+#elif defined(DATA_FILE_SEGMENTS)
+SegmentStore dataStore = SegmentStore(Storage.fs(), "/data", DATA_SEGMENT_SIZE, DATA_FILE_CAPACITY, DATA_FILE_FORMAT);
+#else
+RingFile dataStore = RingFile(Storage.fs(), "/data.bin", DATA_FILE_CAPACITY, DATA_FILE_FORMAT);
+#endif
+#ifdef DATA_CACHE_RTC
+RTC_NOINIT_ATTR sample_cache_memory_t cacheMemory; // not initialized on reboot, see 'SampleCache::adopt()'
+#else
+sample_cache_memory_t cacheMemory;
+#endif
+RingFile minuteRollupStore = RingFile(Storage.fs(), "/rollup_60.bin", DATA_ROLLUP_MINUTE_CAPACITY, ROLLUP_FORMAT);
+RingFile hourRollupStore = RingFile(Storage.fs(), "/rollup_3600.bin", DATA_ROLLUP_HOUR_CAPACITY, ROLLUP_FORMAT);
+RollupSeries minuteRollups = RollupSeries(minuteRollupStore, 60);
+RollupSeries hourRollups = RollupSeries(hourRollupStore, 3600);
+DataFileClass DataFile = DataFileClass(dataStore, coarseStore, archiveStore, indexStore, minuteRollups, hourRollups, cacheMemory);
\ No newline at end of file
@@ -1,38 +1,134 @@
 #ifndef DATA_FILE_H
 #define DATA_FILE_H
 
-#include <deque>
-#include "FileManager.h"
-#include "SPIFFS.h"
+#include "DataCodec.h"
+#include "PartitionLog.h"
+#include "RecordLog.h"
+#include "RingFile.h"
+#include "Rollup.h"
+#include "SampleCache.h"
+#include "SegmentStore.h"
 #include "Sensors.h"
+#include "Storage.h"
+#include "TieredStore.h"
+#include "TimeIndex.h"
 #include "TimeManager.h"
 
-// SD Card:
-#define SD_CARD
-#define SPI_CD 5
-#define SPI_MOSI 23
-#define SPI_CLK 18
-#define SPI_MISO 19
-
 // String Lenghts:
 #define FILE_NAME_LENGTH 25
-#define DATA_STRING_LENGTH 40
+
+// Binary Format:
+#define DATA_FILE_FORMAT DATA_CODEC_FORMAT // format of the records on disk
+#define DATA_FILE_CAPACITY (768 * 1024) // maximum number of bytes stored on disk
+
+// Storage Engine:
+#define DATA_FILE_SEGMENTS // store records in daily segments (comment out to use a single ring file)
+#define DATA_SEGMENT_SIZE (64 * 1024) // maximum size of a segment in bytes
+// #define DATA_FILE_PARTITION "datalog" // store records in this raw flash partition instead (uncomment, needs "partitions_datalog.csv")
+#define LEGACY_DATA_FILE "/data.txt" // CSV data file of previous firmware versions
+#define DATA_QUEUE_LENGTH 16 // samples waiting for the storage task
+#define DATA_CACHE_RTC // keep the cache in RTC memory to survive soft reboots (comment out to keep it in RAM)
+
+// History (SD Card, Segments on Flash Only):
+#define DATA_HISTORY_DIR "/history" // directory of the history segments on the SD card
+#define DATA_HISTORY_SEGMENT_SIZE (4 * 1024 * 1024) // maximum size of a history segment in bytes
+#define DATA_HISTORY_CAPACITY (256 * 1024 * 1024) // maximum number of bytes of history, oldest segments are deleted
+#define DATA_HISTORY_JOB_LIST "sd" // job list of the history segments in the config
+
+// Storage Pressure:
+#define DATA_COARSE_CAPACITY (64 * 1024) // maximum number of bytes of downsampled records on disk
+#define DATA_ARCHIVE_CAPACITY (32 * 1024) // maximum number of bytes of records merged again once the coarse file is full, oldest are dropped
+#define DATA_ARCHIVE_RESOLUTION 3600 // seconds merged into one record of the archive file
+#define DATA_PRESSURE_BATCH 180 // number of the oldest records downsampled at once (multiple of DATA_FRAME_LENGTH)
+#define DATA_PRESSURE_BATCHES 10 // maximum number of batches downsampled per call of 'relieve()'
+#define DATA_PRESSURE_LEVELS { \
+    {60, 60, 0},        /* merge the oldest records into per-minute aggregates */ \
+    {80, 600, 0},       /* merge them into per-ten-minute aggregates instead */ \
+    {90, 600, 60000}    /* additionally measure only once per minute */ \
+} // levels of storage usage, see 'pressure_level_t'
+
+// Rollups:
+#define DATA_ROLLUP_MINUTE_CAPACITY (40 * 1024) // maximum number of bytes of per-minute rollups (about a day)
+#define DATA_ROLLUP_HOUR_CAPACITY (20 * 1024) // maximum number of bytes of per-hour rollups (about a month)
+
+// Time Index:
+#define DATA_INDEX_CAPACITY (24 * 1024) // maximum number of bytes of the time index (one entry per cache flush)
+
+// Queries:
+#define QUERY_ARCHIVE 0 // tiers of a query, read in this order
+#define QUERY_COARSE 1
+#define QUERY_DISK 2
+#define QUERY_CACHE 3
+#define QUERY_DONE 4
+#define QUERY_FILES 3 // number of tiers read from files
+
+typedef struct {
+    uint8_t usage;          // percentage of the storage used from which this level applies
+    uint16_t resolution;    // seconds merged into one record when downsampling (0 = keep raw records)
+    uint32_t period;        // minimum measurement period in milliseconds (0 = unchanged)
+} pressure_level_t;
+
+typedef struct {
+    data_record_t window;   // window merged currently, timestamp at its beginning
+    uint32_t sums[3];       // flow, pressure and level of the records merged into the window so far
+    uint32_t num;           // number of records merged into the window so far (0 = no window open)
+    uint32_t stop;          // end of the window, records taken at or after this time close it
+    uint32_t end;           // end of the last window written, later windows start at or after it
+} merge_state_t;
+
+typedef struct {
+    uint32_t start;                     // beginning of the range, seconds since epoch
+    uint32_t stop;                      // end of the range (exclusive)
+    uint8_t tier;                       // tier read currently, QUERY_ARCHIVE to QUERY_DONE
+    bool opened;                        // positions were set by the first call
+    uint32_t positions[QUERY_FILES];    // position reached in each file, see 'RecordLog::front()'
+    size_t visited[QUERY_FILES];        // items after these positions visited already
+    uint32_t cacheIndex;                // index of the next cached item to visit
+    uint32_t last;                      // timestamp of the last item visited
+    size_t repeats;                     // items visited from the cache with timestamp 'last'
+} data_query_t;
 
 class DataFileClass {
 public:
-    DataFileClass(const std::string& filename);
+    DataFileClass(RecordStore& store, RecordStore& coarseStore, RecordStore& archiveStore, RecordStore& indexStore, RollupSeries& minuteRollups, RollupSeries& hourRollups, sample_cache_memory_t& cacheMemory);
     bool begin();
     bool store(sensor_data_t data);
+    bool persist(TickType_t timeout);
     bool exportData(std::vector<sensor_data_t>& data);
+    bool forEach(size_t maxItems, const std::function<bool(const sensor_data_t& data)>& callback);
     bool shrink(size_t num);
+    bool skip(uint32_t before, size_t maxItems);
+    bool query(uint32_t start, uint32_t stop, const std::function<bool(const sensor_data_t& data)>& callback);
+    bool query(data_query_t& query, const std::function<bool(const sensor_data_t& data)>& callback, TickType_t timeout);
+    RollupSeries& rollups(rollup_series_t series);
     bool clear();
+    bool recover();
+    uint32_t relieve();
+    uint8_t usage();
     size_t itemCount();
 private:
-    FileManager file;
-    std::deque<sensor_data_t> cache;
-    SemaphoreHandle_t semaphore;
-    bool parseCSVLine(const char line[], sensor_data_t& data);
-    bool shrinkCache(size_t num);
+    RecordLog<data_record_t, DataCodec> file;
+    RecordLog<data_record_t, DataCodec> coarse; // downsampled records, older than the records of the disk file
+    RecordLog<data_record_t, DataCodec> archive; // records of the coarse file merged again once it is full, the oldest records
+    TimeIndex index; // sparse index of the disk file, finds records by time
+    RollupSeries* rollupSeries[ROLLUP_SERIES]; // summaries of the samples, built as they arrive
+    uint8_t pressure; // current storage pressure level, 0 if none applies
+    merge_state_t coarseMerge; // window carried over to the next records downsampled into the coarse file
+    merge_state_t archiveMerge; // window carried over to the next records merged into the archive file
+    QueueHandle_t queue; // samples from the measurement task
+    SampleCache cache; // lock-free, storage task produces and storage and sync task consume
+    bool exportedCache; // last export was from the cache
+    RecordLog<data_record_t, DataCodec>* exportedFile; // file of the last export, NULL if from the cache
+    uint32_t exportedHead; // cache index of the first item of the last export
+    SemaphoreHandle_t semaphore; // held while records are appended to or stripped from the files, see 'query()'
+    bool cacheRecord(const data_record_t& record);
+    bool flushCache();
+    size_t downsample(uint16_t resolution);
+    size_t merge(RecordLog<data_record_t, DataCodec>& from, RecordLog<data_record_t, DataCodec>& to, uint16_t resolution, merge_state_t& state);
+    bool closeWindow(RecordLog<data_record_t, DataCodec>& to, merge_state_t& state);
+    RecordLog<data_record_t, DataCodec>& oldest();
+    bool appendRecords(const std::vector<data_record_t>& records);
+    bool queryFile(data_query_t& query, uint8_t tier, const std::function<bool(const data_record_t& record, uint8_t tier)>& visit);
 };
 
 extern DataFileClass DataFile;
@@ -127,6 +127,18 @@ const char* statusToString(int statusCode) {
     }
 }
 
+upload_mode_t stringToUpload(const char* uploadString) {
+    if(uploadString == NULL) { // not given, the server stores raw samples only
+        return UPLOAD_RAW;
+    } else if(strcmp(uploadString, "raw") == 0) {
+        return UPLOAD_RAW;
+    } else if(strcmp(uploadString, "rollups") == 0) {
+        return UPLOAD_ROLLUPS;
+    } else {
+        return UPLOAD_BOTH;
+    }
+}
+
 sync_mode_t stringToMode(const char* modeString) {
     if(strcmp(modeString, "short") == 0) {
         return SHORT;
@@ -173,6 +185,16 @@ std::string GatewayClass::getResponse() {
             ...
         }
     },
+    "rollups": {
+        "columns": ["flow", "pressure", "level"],
+        "60": {
+            "2024-09-10T00:00:00": {"count": 60, "min": [3, 2, 1], "max": [5, 2, 1], "mean": [4, 2, 1]},
+            ...
+        },
+        "3600": {
+            ...
+        }
+    },
     "logs": {
         "2024-09-10T00:00:00": ["I am a log message", "debug"],
         "2024-09-10T00:00:01": ["I am a info message", "info"],
@@ -185,40 +207,85 @@ std::string GatewayClass::getResponse() {
         "firmware": {
             "version": "2024-09-10T00:00:00"
         }
+    },
+    "wear": {
+        "uptime": 86400,
+        "owners": {
+            "data": {"bytes": 524288, "writes": 2880, "rewrites": 0, "rewritten": 0, "erases": 0, "commits": 0},
+            "nvs:job": {"bytes": 120, "writes": 0, "rewrites": 0, "rewritten": 0, "erases": 0, "commits": 6},
+            ...
+        }
     }
 }
 */
 
-bool GatewayClass::insertData(std::vector<sensor_data_t> sensorData) {
-    if(sensorData.size() == 0) {
-        return true;
-    }
+bool GatewayClass::insertData(const sensor_data_t& sensorData) {
+    JsonObject data = this->doc["data"].as<JsonObject>();
+    if(data.isNull()) { // first data point of this request
+        data = this->doc["data"].to<JsonObject>();
+        JsonArray columns = data["columns"].to<JsonArray>();
+        columns.add("flow");
+        columns.add("pressure");
+        columns.add("level");
+        data["values"].to<JsonObject>();
+    }
+    JsonObject values = data["values"].as<JsonObject>();
+
+    std::string ts = TimeManager::toString(sensorData.timestamp);
+    JsonArray a = values[ts].to<JsonArray>();
+    a.add(sensorData.flow);
+    a.add(sensorData.pressure);
+    a.add(sensorData.level);
+
+    return !this->doc.overflowed();
+}
 
-    JsonObject data = this->doc["data"].to<JsonObject>();
-    JsonArray columns = data["columns"].to<JsonArray>();
-    columns.add("flow");
-    columns.add("pressure");
-    columns.add("level");
-    JsonObject values = data["values"].to<JsonObject>();
-    
-    for(sensor_data_t sensdata : sensorData) {
-        std::string ts = TimeManager::toString(sensdata.timestamp);
-        JsonArray a = values[ts].to<JsonArray>();
-        a.add(sensdata.flow);
-        a.add(sensdata.pressure);
-        a.add(sensdata.level);
+bool GatewayClass::insertData(const std::vector<sensor_data_t>& sensorData) {
+    for(const sensor_data_t& sensdata : sensorData) {
+        if(!this->insertData(sensdata)) {
+            return false;
+        }
     }
-
     return true;
 }
 
-bool GatewayClass::insertLogs(std::vector<log_message_t> logMessages) {
+bool GatewayClass::insertRollup(const rollup_record_t& rollup, uint32_t resolution) {
+    JsonObject rollups = this->doc["rollups"].as<JsonObject>();
+    if(rollups.isNull()) { // first rollup of this request
+        rollups = this->doc["rollups"].to<JsonObject>();
+        JsonArray columns = rollups["columns"].to<JsonArray>();
+        columns.add("flow");
+        columns.add("pressure");
+        columns.add("level");
+    }
+    std::string key = std::to_string(resolution);
+    JsonObject series = rollups[key].as<JsonObject>();
+    if(series.isNull()) {
+        series = rollups[key].to<JsonObject>();
+    }
+
+    std::string ts = TimeManager::toString(TimeManager::fromEpoch((time_t)rollup.start));
+    JsonObject r = series[ts].to<JsonObject>();
+    r["count"] = rollup.count;
+    JsonArray min = r["min"].to<JsonArray>();
+    JsonArray max = r["max"].to<JsonArray>();
+    JsonArray mean = r["mean"].to<JsonArray>();
+    for(size_t i = 0; i < 3; i++) {
+        min.add(rollup.min[i]);
+        max.add(rollup.max[i]);
+        mean.add(rollup.mean[i]);
+    }
+
+    return !this->doc.overflowed();
+}
+
+bool GatewayClass::insertLogs(const std::vector<log_message_t>& logMessages) {
     if(logMessages.size() == 0) {
         return true;
     }
     JsonObject logs = this->doc["logs"].to<JsonObject>();
     
-    for(log_message_t log : logMessages) {
+    for(const log_message_t& log : logMessages) {
         std::string ts = TimeManager::toString(log.timestamp);
         JsonArray a = logs[ts].to<JsonArray>();
         a.add(log.message);
@@ -236,10 +303,15 @@ bool GatewayClass::insertFirmwareVersion(std::string &version) {
     return true;
 }
 
+bool GatewayClass::insertWearStats() {
+    JsonObject wear = this->doc["wear"].to<JsonObject>();
+    return wearToJson(wear) && !this->doc.overflowed();
+}
+
 bool GatewayClass::synchronize() {
     // Connect to WiFi:
     if(!Wlan.connect()) {
-        LogFile.log(WARNING, "Cannot synchronize without network connection");
+        LogFile.log(WARNING, LOG_SYNC_OFFLINE);
         return false;
     }
 
@@ -250,7 +322,7 @@ bool GatewayClass::synchronize() {
 
     // Initialize and Make GET Request:
     if(!http.begin(this->api_host.c_str(), this->api_port, this->api_path.c_str())) {
-        LogFile.log(WARNING,"Failed to begin request!");
+        LogFile.log(WARNING, LOG_REQUEST_BEGIN_FAILED);
         return false;
     }
 
@@ -265,7 +337,7 @@ bool GatewayClass::synchronize() {
     if(this->doc.isNull()) {
         payload = "{}";
     } else {
-        serializeJsonPretty(this->doc, payload);
+        serializeJson(this->doc, payload);
     }
     log_v("Payload:\r\n%s", payload.c_str());
     // log_d("Synchronize with payload size: %d", payload.size());
@@ -275,7 +347,7 @@ bool GatewayClass::synchronize() {
 
     // Check Response:
     if(httpCode < 0) { // httpCode is negative on error
-        LogFile.log(WARNING,"Request failed: "+std::string(http.errorToString(httpCode).c_str()));
+        LogFile.log(WARNING, LOG_REQUEST_FAILED, {httpCode});
         return false;
     }
     if(httpCode != HTTP_CODE_OK) {
@@ -283,7 +355,7 @@ bool GatewayClass::synchronize() {
         return false;
     }
     if(http.getSize() > RESPONSE_BUFFER_SIZE) { // check reponse body size
-        LogFile.log(WARNING,"Response body too large.");
+        LogFile.log(WARNING, LOG_RESPONSE_TOO_LARGE);
         return false;
     }
 
@@ -412,6 +484,7 @@ bool GatewayClass::getSync(sync_t* buffer) {
     buffer->periods[MEDIUM] = medium_period;
     buffer->periods[LONG] = long_period;
     buffer->mode = stringToMode(sync_mode);
+    buffer->upload = stringToUpload(sync["upload"].as<const char*>()); // optional
     return true;
 }
 
@@ -444,10 +517,30 @@ bool GatewayClass::getFirmware(std::string &fw) {
     return true;
 }
 
+/**
+ * @brief Get the number of rollups the server confirmed to have stored with the last request,
+ * given by the response as "stored": {"rollups": 42}. Servers without rollup support do not send it.
+ * @param count number of rollups stored
+ * @return true if the response confirms stored rollups, false otherwise
+ */
+bool GatewayClass::getStoredRollups(size_t& count) {
+    // Convert to JSON:
+    JsonObjectConst obj = this->doc.as<JsonObjectConst>();
+
+    // Parse JSON Document:
+    JsonObjectConst stored = obj["stored"].as<JsonObjectConst>();
+    if(!stored || !stored["rollups"].is<unsigned int>()) {
+        log_d("response does not confirm stored rollups");
+        return false;
+    }
+    count = stored["rollups"].as<unsigned int>();
+    return true;
+}
+
 bool GatewayClass::downloadFirmware() {
     // Connect to WiFi:
     if(!Wlan.connect()) {
-        LogFile.log(WARNING, "Cannot fetch firmware without network connection");
+        LogFile.log(WARNING, LOG_FETCH_OFFLINE);
         return false;
     }
     
@@ -455,7 +548,7 @@ bool GatewayClass::downloadFirmware() {
     HTTPClient http;
     std::string path = this->api_path + "/firmware";
     if(!http.begin(this->api_host.c_str(), this->api_port, path.c_str())) {
-        LogFile.log(WARNING,"Failed to begin request!");
+        LogFile.log(WARNING, LOG_REQUEST_BEGIN_FAILED);
         return false;
     }
 
@@ -477,7 +570,7 @@ bool GatewayClass::downloadFirmware() {
 
     // Check Response:
     if(httpCode < 0) { // httpCode is negative on error
-        LogFile.log(WARNING,"Request failed: "+std::string(http.errorToString(httpCode).c_str()));
+        LogFile.log(WARNING, LOG_REQUEST_FAILED, {httpCode});
         return false;
     }
     if(httpCode != HTTP_CODE_OK) {
@@ -565,4 +658,29 @@ bool GatewayClass::downloadFirmware() {
     return true;
 }
 
+/**
+ * @brief Fills the given object with the flash write counters of all owners since boot (see
+ * 'WriteStats'), as sent in the "wear" key of the sync request
+ * @param wear object to be filled
+ * @return true on success, false otherwise
+ */
+bool GatewayClass::wearToJson(JsonObject wear) {
+    std::vector<write_stats_t> stats;
+    if(!WriteStats.snapshot(stats)) {
+        return false;
+    }
+    wear["uptime"] = WriteStats.uptime();
+    JsonObject owners = wear["owners"].to<JsonObject>();
+    for(const write_stats_t& s : stats) {
+        JsonObject o = owners[(const char*)s.owner].to<JsonObject>();
+        o["bytes"] = s.bytes;
+        o["writes"] = s.writes;
+        o["rewrites"] = s.rewrites;
+        o["rewritten"] = s.rewritten;
+        o["erases"] = s.erases;
+        o["commits"] = s.commits;
+    }
+    return true;
+}
+
 GatewayClass Gateway = GatewayClass();
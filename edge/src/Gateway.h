@@ -12,9 +12,11 @@
 #include "LogFile.h"
 #include "TimeManager.h"
 #include "WiFiManager.h"
+#include "WriteStats.h"
 
 // Modules:
 #include "Pump.h"
+#include "Rollup.h"
 #include "Sensors.h"
 
 // Pin Definitions:
@@ -34,9 +36,16 @@ typedef enum {
     LONG = 2
 } sync_mode_t;
 
+typedef enum {
+    UPLOAD_RAW = 0,     // raw samples only
+    UPLOAD_ROLLUPS = 1, // rollups only, raw samples summarized by them are skipped once the server confirms it stored the rollups
+    UPLOAD_BOTH = 2
+} upload_mode_t;
+
 typedef struct {
     unsigned int periods[3];
     sync_mode_t mode;
+    upload_mode_t upload; // what to upload with the next requests
 } sync_t;
 
 class GatewayClass {
@@ -48,14 +57,19 @@ public:
     std::string getResponse();
     
     // Tree API:
-    bool insertData(std::vector<sensor_data_t> sensorData);
-    bool insertLogs(std::vector<log_message_t> logMessages);
+    bool insertData(const sensor_data_t& sensorData);
+    bool insertData(const std::vector<sensor_data_t>& sensorData);
+    bool insertRollup(const rollup_record_t& rollup, uint32_t resolution);
+    bool insertLogs(const std::vector<log_message_t>& logMessages);
     bool insertFirmwareVersion(std::string &version);
+    bool insertWearStats();
     bool synchronize();
     bool getIntervals(std::vector<interval_t>& intervals);
     bool getSync(sync_t* sync);
     bool getFirmware(std::string &firmware);
+    bool getStoredRollups(size_t& count);
     bool downloadFirmware();
+    static bool wearToJson(JsonObject wear);
 
 private:
     // Hardware:
@@ -0,0 +1,220 @@
+#include "LogCodec.h"
+#include "TimeManager.h"
+#include "esp_rom_crc.h"
+
+#define CHECKSUM_LENGTH (sizeof(LOG_CHECKSUM_SEPARATOR) - 1 + 4) // separator and 4 hex digits
+#define HEADER_SIZE sizeof(log_record_header_t)
+
+static log_mode_t stringToMode(std::string tagString) {
+    if(tagString == "[INFO]") {
+        return INFO;
+    } else if(tagString == "[WARNING]") {
+        return WARNING;
+    } else if(tagString == "[ERROR]") {
+        return ERROR;
+    } else {
+        return DEBUG;
+    }
+}
+
+/**
+ * @brief Encodes the given messages into records and appends them to the buffer
+ * @param entries messages to encode, oldest first
+ * @param num number of messages
+ * @param buffer buffer the encoded bytes are appended to
+ * @return true on success, false otherwise
+ */
+bool LogCodec::encode(const log_entry_t* entries, size_t num, std::vector<uint8_t>& buffer) {
+    for(size_t i = 0; i < num; i++) {
+        size_t start = buffer.size();
+        buffer.resize(start + LOG_RECORD_MAX_SIZE);
+        buffer.resize(start + encodeRecord(entries[i], buffer.data() + start));
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes the records at the beginning of the given bytes and calls the callback for each
+ * of them. Decoding stops at the first record that is incomplete or corrupted.
+ * @param buffer encoded bytes, starting at a record
+ * @param len number of bytes in buffer
+ * @param max maximum number of records to decode
+ * @param callback function called with each message, returns false to stop decoding
+ * @param corrupt set to true if decoding stopped at a corrupted record, see 'resync()'
+ * @return number of bytes of the records passed to the callback
+ */
+size_t LogCodec::decode(const uint8_t* buffer, size_t len, size_t max, const std::function<bool(const log_entry_t& entry)>& callback, bool& corrupt) {
+    size_t position = 0;
+    corrupt = false;
+    for(size_t records = 0; records < max && position < len; records++) {
+        log_entry_t entry;
+        size_t size = decodeRecord(buffer + position, len - position, entry, corrupt);
+        if(size == 0 || !callback(entry)) {
+            break; // corrupted, continues in next chunk or stopped by callback
+        }
+        position += size;
+    }
+    return position;
+}
+
+/**
+ * @brief Searches the given bytes for the next record after the first byte, i.e. the next position
+ * a record with a matching checksum or an incomplete record starts at. Use this to skip a
+ * corrupted record reported by 'decode()'.
+ * @param buffer encoded bytes, starting at the corrupted record
+ * @param len number of bytes in buffer
+ * @param items set to the number of records skipped, i.e. the corrupted record
+ * @return number of bytes to skip ('len' if there is no record in the buffer)
+ */
+size_t LogCodec::resync(const uint8_t* buffer, size_t len, size_t& items) {
+    items = 1;
+    for(size_t i = 1; i < len; i++) {
+        log_entry_t entry;
+        bool corrupt;
+        decodeRecord(buffer + i, len - i, entry, corrupt);
+        if(!corrupt) {
+            return i;
+        }
+    }
+    return len;
+}
+
+/**
+ * Tries to parse a log message from the given line of a legacy log file into the entry. Lines
+ * without checksum are accepted.
+ * @param line view of the line in format TIME [TAG] MESSAGE *CRC16
+ * @param entry entry to be filled with parsed values (free text)
+ * @return true on success, false if one of values failed to parse
+ */
+bool LogCodec::parse(std::string_view line, log_entry_t& entry) {
+    // Verify Checksum:
+    size_t separator = line.size() - std::min(line.size(), CHECKSUM_LENGTH);
+    if(line.size() >= CHECKSUM_LENGTH && line.compare(separator, CHECKSUM_LENGTH - 4, LOG_CHECKSUM_SEPARATOR) == 0) {
+        char digits[5];
+        memcpy(digits, line.data() + line.size() - 4, 4);
+        digits[4] = '\0';
+        char* end;
+        unsigned long crc = strtoul(digits, &end, 16);
+        line.remove_suffix(CHECKSUM_LENGTH);
+        if(*end != '\0' || crc != esp_rom_crc16_le(0, (const uint8_t*)line.data(), line.size())) {
+            return false;
+        }
+    }
+
+    // Copy Into Local String Buffer:
+    size_t len = line.size();
+    char buffer[len+1];
+    memcpy(buffer, line.data(), len);
+    buffer[len] = '\0';
+
+    // Parse Time String:
+    char* token = strtok(buffer," ");
+    if(token == NULL) {
+        return false;
+    }
+    tm timestamp;
+    if(!TimeManager::fromDateTimeString(token, timestamp)) {
+        return false;
+    }
+    entry.timestamp = TimeManager::toEpoch(timestamp);
+
+    // Parse Log Tag:
+    token = strtok(NULL, " ");
+    if(token == NULL) {
+        return false;
+    }
+    entry.mode = stringToMode(token);
+
+    // Parse Message:
+    token = strtok(NULL, ""); // rest of the line
+    if(token == NULL) {
+        return false;
+    }
+    entry.id = LOG_TEXT;
+    entry.argc = 0;
+    strncpy(entry.text, token, sizeof(entry.text) - 1);
+    entry.text[sizeof(entry.text) - 1] = '\0';
+
+    // Return Success:
+    return true;
+}
+
+/**
+ * @brief Encodes the given message into a record
+ * @param entry message to encode
+ * @param buffer buffer to be filled, needs to hold LOG_RECORD_MAX_SIZE bytes
+ * @return number of bytes of the record
+ */
+size_t LogCodec::encodeRecord(const log_entry_t& entry, uint8_t* buffer) {
+    // Select Payload:
+    const uint8_t* payload = (const uint8_t*)entry.args;
+    size_t len = entry.argc * sizeof(int32_t);
+    if(entry.id == LOG_TEXT) {
+        payload = (const uint8_t*)entry.text;
+        len = strnlen(entry.text, sizeof(entry.text) - 1);
+    }
+
+    // Write Header, Payload and Checksum:
+    log_record_header_t header;
+    header.timestamp = (uint32_t)entry.timestamp;
+    header.mode = (uint8_t)entry.mode;
+    header.length = (uint8_t)len;
+    header.id = (uint16_t)entry.id;
+    memcpy(buffer, &header, HEADER_SIZE);
+    memcpy(buffer + HEADER_SIZE, payload, len);
+    uint16_t crc = esp_rom_crc16_le(0, buffer, HEADER_SIZE + len);
+    memcpy(buffer + HEADER_SIZE + len, &crc, sizeof(crc));
+    return HEADER_SIZE + len + sizeof(crc);
+}
+
+/**
+ * @brief Decodes the record at the beginning of the given buffer
+ * @param buffer buffer holding the record
+ * @param len number of bytes in the buffer
+ * @param entry message to be filled
+ * @param corrupt set to true if the buffer does not start with a valid record
+ * @return number of bytes of the record, 0 if corrupted or not entirely in the buffer
+ */
+size_t LogCodec::decodeRecord(const uint8_t* buffer, size_t len, log_entry_t& entry, bool& corrupt) {
+    corrupt = false;
+    if(len < HEADER_SIZE) {
+        return 0;
+    }
+
+    // Check Header:
+    log_record_header_t header;
+    memcpy(&header, buffer, HEADER_SIZE);
+    bool text = header.id == LOG_TEXT;
+    if(header.mode > DEBUG || header.id >= LOG_MESSAGE_COUNT || (text && header.length >= MAX_LOG_LENGTH) ||
+       (!text && (header.length % sizeof(int32_t) != 0 || header.length > LOG_MAX_ARGS * sizeof(int32_t)))) {
+        corrupt = true;
+        return 0;
+    }
+    size_t size = HEADER_SIZE + header.length + sizeof(uint16_t);
+    if(len < size) {
+        return 0;
+    }
+
+    // Verify Checksum:
+    uint16_t crc;
+    memcpy(&crc, buffer + HEADER_SIZE + header.length, sizeof(crc));
+    if(crc != esp_rom_crc16_le(0, buffer, HEADER_SIZE + header.length)) {
+        corrupt = true;
+        return 0;
+    }
+
+    // Fill Entry:
+    entry.timestamp = header.timestamp;
+    entry.mode = (log_mode_t)header.mode;
+    entry.id = (log_id_t)header.id;
+    entry.argc = text ? 0 : header.length / sizeof(int32_t);
+    memset(entry.args, 0, sizeof(entry.args));
+    entry.text[0] = '\0';
+    if(text) {
+        memcpy(entry.text, buffer + HEADER_SIZE, header.length);
+        entry.text[header.length] = '\0';
+    } else {
+        memcpy(entry.args, buffer + HEADER_SIZE, header.length);
+    }
+    return size;
+}
@@ -0,0 +1,47 @@
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <ctime>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "LogMessages.h"
+
+#define MAX_LOG_LENGTH 100
+#define LOG_MAX_ARGS 4 // maximum number of integer arguments of a message
+#define LOG_CHECKSUM_SEPARATOR " *" // precedes the CRC16 (4 hex digits) at the end of every line of legacy log files
+
+typedef enum {INFO, WARNING, ERROR, DEBUG} log_mode_t;
+
+typedef struct {
+    time_t timestamp;               // time the message was logged
+    log_mode_t mode;
+    log_id_t id;                    // message, see LogMessages.h
+    uint8_t argc;                   // number of arguments
+    int32_t args[LOG_MAX_ARGS];
+    char text[MAX_LOG_LENGTH];      // free text of LOG_TEXT messages, null-terminated, truncated if longer
+} log_entry_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp; // seconds since epoch
+    uint8_t mode;       // see 'log_mode_t'
+    uint8_t length;     // number of bytes of the arguments (4 each) or of the text following this header
+    uint16_t id;        // see 'log_id_t'
+} log_record_header_t; // followed by the arguments or the text and a CRC16 of header and these bytes
+
+#define LOG_RECORD_MAX_SIZE (sizeof(log_record_header_t) + MAX_LOG_LENGTH + sizeof(uint16_t)) // longest free text and checksum
+
+class LogCodec {
+public:
+    static constexpr size_t CHUNK_SIZE = 256; // bytes read from disk at once, needs to hold an entire record
+    static constexpr size_t UNIT_LENGTH = 1; // every record has its own checksum
+    static bool encode(const log_entry_t* entries, size_t num, std::vector<uint8_t>& buffer);
+    static size_t decode(const uint8_t* buffer, size_t len, size_t max, const std::function<bool(const log_entry_t& entry)>& callback, bool& corrupt);
+    static size_t resync(const uint8_t* buffer, size_t len, size_t& items);
+    static bool parse(std::string_view line, log_entry_t& entry);
+    static size_t encodeRecord(const log_entry_t& entry, uint8_t* buffer);
+private:
+    static size_t decodeRecord(const uint8_t* buffer, size_t len, log_entry_t& entry, bool& corrupt);
+};
+
+#endif /* LOG_CODEC_H */
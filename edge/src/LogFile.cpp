@@ -1,168 +1,297 @@
 #include "LogFile.h"
+#include "CriticalRuntime.h"
+#include "Config.h"
+#include "esp_rom_crc.h"
 
-#define MUTEX_TIMEOUT (2*1000)/portTICK_PERIOD_MS // 2000 ms
+/**
+ * [INFO]
+ * The log file holds binary records instead of text lines: timestamp, mode, message ID and the
+ * integer arguments of the message (see LogMessages.h), or the text of messages logged as free
+ * text. A record takes about 10 bytes instead of 60 to 100 bytes of text. The format string of a
+ * message is only looked up when the log is printed to serial or exported, so the sync path does
+ * not parse any text. The records are encoded by 'LogCodec', reading, stripping and dropping them
+ * is left to 'RecordLog'.
+ */
+
+#define LOG_MESSAGE_FORMAT(id, format) format,
+static const char* const formats[LOG_MESSAGE_COUNT] = { LOG_MESSAGES(LOG_MESSAGE_FORMAT) };
+#undef LOG_MESSAGE_FORMAT
+
+uint8_t modeToSeverity(log_mode_t mode) {
+    switch (mode) {
+    case DEBUG:
+        return 0;
+    case INFO:
+        return 1;
+    case WARNING:
+        return 2;
+    default:
+        return 3; // ERROR
+    }
+}
+
+const char* modeToPrefix(log_mode_t mode) {
+    switch (mode) {
+    case INFO:
+        return "INFO";
+    case WARNING:
+        return "WARNING";
+    case ERROR:
+        return "ERROR";
+    case DEBUG:
+        return "DEBUG";
+    default:
+        return "";
+    }
+}
 
-std::string stringToTag(std::string tagString) {
-    if(tagString == "[INFO]") {
+std::string modeToTag(log_mode_t mode) {
+    switch (mode) {
+    case INFO:
         return "info";
-    } else if(tagString == "[WARNING]") {
+    case WARNING:
         return "warning";
-    } else if(tagString == "[ERROR]") {
+    case ERROR:
         return "error";
-    } else {
+    default:
         return "debug";
     }
 }
 
 /**
- * @brief Constructor initalizes a log file at the file system and creates a semaphore to be ready
- * for multi process usage.
- * @param filename file name of the log file (e.g. "/log,txt")
+ * @brief Constructor initalizes a log file on top of the given record store and creates a
+ * semaphore to be ready for multi process usage.
+ * @param store store holding the log records on disk
  */
-Log::Log(const std::string& filename) : file(SPIFFS, filename), led(LED_RED) {
+Log::Log(RecordStore& store) : file(store, "log file", true), led(LED_RED), head(0), tail(0), dropped(0) {
+    this->droppedSerial = 0;
+    this->urgent = false;
+    this->minFileSeverity = modeToSeverity(DEBUG);
+    this->minSerialSeverity = modeToSeverity(DEBUG);
+    memset(this->sites, 0, sizeof(this->sites));
+    for(uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+        this->ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
     this->semaphore = xSemaphoreCreateMutex();
     if(semaphore == NULL) {
         log_e("Not enough heap to use log file semaphore");
     }
+    this->signal = xSemaphoreCreateBinary();
+    if(this->signal == NULL) {
+        log_e("Not enough heap to use log file signal");
+    }
 }
 
 /**
- * @brief Mounts the internal file system SPIFFS and creates the log file (if it does not exist)
+ * @brief Mounts the storage backend and creates the log file (if it does not exist). The text log
+ * file of previous firmware versions is converted.
  * @return true on success, false otherwise
  */
 bool Log::begin() {
-    // Mount Internal Filesystem:
-    if(!SPIFFS.begin(true)) {
-        log_e("Unable to mount SPIFFS");
+    // Mount Filesystem:
+    if(!Storage.begin()) {
+        log_e("Unable to mount %s", Storage.name());
         return false;
     }
 
     // Initialize File:
-    if(!this->file.check()) {
-        log_w("Log file broken or not found");
-        log_d("Resetting log file");
-        if(!file.reset()) {
-            log_e("Could not reset log file");
-            return false;
+    if(!this->file.begin()) {
+        return false;
+    }
+
+    // Convert Log of Previous Firmware Versions:
+    if(Storage.fs().exists(LEGACY_LOG_FILE)) {
+        CriticalRuntime run(this->semaphore);
+        bool migrated = run.isValid() && this->file.migrate(Storage.fs(), LEGACY_LOG_FILE, LOG_MIGRATION_BATCH_SIZE, Config.loadMigratedLines(LOG_MIGRATION_NAME), [this](const std::vector<log_entry_t>& entries) {
+            return this->file.append(entries.data(), entries.size());
+        }, [](size_t lines) {
+            Config.storeMigratedLines(LOG_MIGRATION_NAME, lines);
+        });
+        if(!migrated) {
+            log_w("Could not convert legacy log file, retrying after next boot");
         }
     }
 
-    log_d("Reusing existing log file (file passed check)");
+    // Load Levels:
+    this->setLevels((log_mode_t)Config.loadLogFileLevel(DEBUG), (log_mode_t)Config.loadLogSerialLevel(DEBUG));
     return true;
 }
 
 /**
- * @brief Write the given message with the current timestamp and a prefix according to the log mode
- * to the log file
+ * @brief Queues the given message with the current timestamp for the writer task, which prints it
+ * to serial and appends it to the log file (see 'persist()'). Only copies the message into a slot
+ * of the ring, so it neither waits for the flash nor for the serial port. Prefer logging by ID
+ * for messages logged regularly, free text takes much more space on disk.
  * @param mode mode of log (e.g. INFO, ERROR, etc.)
- * @param msg message without line ending
- * @return true on success, false otherwise
+ * @param msg message without line ending, truncated to MAX_LOG_LENGTH - 1 characters
+ * @return true on success, false if the ring is full and the message was dropped
+ * @note Safe to call from any task
  */
 bool Log::log(log_mode_t mode, std::string&& msg) {
-    std::string prefix;
-    switch (mode) {
-    case INFO:
-        prefix = "INFO";
-        break;
-    case WARNING:
-        prefix = "WARNING";
-        break;
-    case ERROR:
-        prefix = "ERROR";
-        this->led.on();
-        break;
-    case DEBUG:
-        prefix = "DEBUG";
-        break;
-    default:
-        prefix = "";
-        break;
+    if(!this->accepts(mode)) {
+        return true; // neither written nor printed, not even queued
+    }
+    uint32_t position;
+    log_slot_t* slot = this->claim(position);
+    if(slot == NULL) {
+        return false;
     }
 
-    // Remove Control Characters:
-    auto isControlCharacter = [](unsigned char c){ return std::isspace(c) && c != ' '; }; // is whitespace but not space character
-    auto newEnd = std::remove_if(msg.begin(), msg.end(), isControlCharacter); // rearanges control chracters to the end of string
-    msg.erase(newEnd, msg.end());
+    // Fill Slot Without Control Characters:
+    slot->entry.timestamp = time(NULL);
+    slot->entry.mode = mode;
+    slot->entry.id = LOG_TEXT;
+    slot->entry.argc = 0;
+    size_t len = 0;
+    for(size_t i = 0; i < msg.size() && len < MAX_LOG_LENGTH - 1; i++) {
+        unsigned char c = msg[i];
+        if(!std::isspace(c) || c == ' ') { // is whitespace but not space character
+            slot->entry.text[len++] = c;
+        }
+    }
+    slot->entry.text[len] = '\0';
 
-    // Build String:
-    std::string timestamp = Time.toString();
-    std::string buffer = timestamp+" ["+prefix+"] "+msg+"\r\n";
-    
-    // Print to Serial:
-    Serial.printf(buffer.c_str());
-    if(timestamp.size() == 0) { // invalid timestamp, only print to serial
+    this->publish(slot, position);
+    return true;
+}
+
+/**
+ * @brief Queues the message of the given ID with its arguments, like 'log(mode, msg)'. Only the ID
+ * and the arguments are stored, the message is formatted on export.
+ * @param mode mode of log (e.g. INFO, ERROR, etc.)
+ * @param id message ID, see LogMessages.h
+ * @param args integer arguments of the format string, at most LOG_MAX_ARGS
+ * @return true on success, false if the ring is full and the message was dropped
+ * @note Safe to call from any task
+ */
+bool Log::log(log_mode_t mode, log_id_t id, std::initializer_list<int32_t> args) {
+    if(!this->accepts(mode)) {
+        return true; // neither written nor printed, not even queued
+    }
+    uint32_t position;
+    log_slot_t* slot = this->claim(position);
+    if(slot == NULL) {
         return false;
     }
 
-    // Check Storage:
-    if(SPIFFS.totalBytes() - SPIFFS.usedBytes() < 500) { // less then 500 bytes free
-        log_e("Cannot write log file because onboard filesystem is (nearly) full");
+    // Fill Slot:
+    slot->entry.timestamp = time(NULL);
+    slot->entry.mode = mode;
+    slot->entry.id = id < LOG_MESSAGE_COUNT ? id : LOG_TEXT;
+    slot->entry.argc = 0;
+    for(int32_t arg : args) {
+        if(slot->entry.argc == LOG_MAX_ARGS) {
+            break;
+        }
+        slot->entry.args[slot->entry.argc++] = arg;
+    }
+    slot->entry.text[0] = '\0';
+
+    this->publish(slot, position);
+    return true;
+}
+
+/**
+ * @brief Waits for queued messages, prints them to serial and stages their records. The store
+ * stages the records in RAM and appends them to the log file in whole flash pages, or once the
+ * oldest of them waited LOG_FLUSH_PERIOD ms (see 'AppendBuffer'). Records of mode LOG_FLUSH_MODE
+ * are appended right away.
+ * @param timeout maximum number of ticks to wait for a message, at most LOG_WAKE_PERIOD ms
+ * @return true on success, false if the staged records could not be appended
+ * @note Call from the writer task only, it is the single consumer of the ring
+ */
+bool Log::persist(TickType_t timeout) {
+    // Wait for Messages:
+    if(this->signal != NULL) {
+        xSemaphoreTake(this->signal, timeout);
+    } else {
+        vTaskDelay(timeout); // poll without signal
+    }
+
+    // Collect Records:
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
         return false;
     }
+    this->drain();
 
-    // Write to File:
-    if(!this->file.append(buffer)) {
-        log_w("Could not append log message");
-        if(!this->file.check()) {
-            log_w("The log file failed the check");
-            if(!this->file.reset()) {
-                log_e("Could not reset the log file as a fix");
-                return false;
-            }
+    // Summarize Collapsed Messages of Past Windows:
+    time_t now = time(NULL);
+    for(log_site_t& site : this->sites) {
+        if(site.hash != 0) {
+            this->expire(site, now);
         }
     }
 
-    return true;
+    // Append Staged Records if Due:
+    if(this->urgent) {
+        this->urgent = false;
+        return this->file.store().flush();
+    }
+    return this->file.store().maintain();
+}
+
+/**
+ * @brief Appends all queued and staged records to the log file right away, e.g. before a reboot
+ * @return true on success, false otherwise
+ * @note Safe to call from any task
+ */
+bool Log::flush() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    this->drain();
+    this->urgent = false;
+    return this->file.store().flush();
 }
 
 /**
- * @brief Reads lines from log file into the given vector. The lines are read withput line endings.
- * At most N lines are read, where N is the size of the vector
+ * @brief Reads the oldest records of the log file and expands them into the given vector. At most
+ * N messages are read, where N is the capacity of the vector. Corrupted records at the front are
+ * dropped.
  * @param logs buffer to be filled. Needs to be allocated with reserve(), so 'logs.capacity()' works
  * @return true on success, false otherwise
  */
 bool Log::exportLogs(std::vector<log_message_t>& logs) {
-    // Read Log File:
-    std::vector<std::string> lines;
-    lines.reserve(logs.capacity());
-    if(!this->file.readLines(lines)) {
-        log_e("Failed to read lines from file");
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
         return false;
     }
-    
-    /*std::vector<std::string> lines = {
-        "17-07-2023T00:14:11 [DEBUG] Largest region currently free in heap at 87876 bytes.",
-        "17-07-2023T00:14:11 [INFO] Requesting weather data from OpenMeteo API."
-        "17-07-2023T00:14:14 [INFO] Rain today is 0 mm.",
-        "17-07-2023T00:14:14 [INFO] Too little rain, resume pump operation.",
-        "17-07-2023T00:14:14 [INFO] Sending Mail."
-    };*/
-
-    // Parse CSV Lines:
-    for(std::string line : lines) {
-        log_message_t l;
-        if(parseLogLine(line.c_str(), l)) {
-            logs.push_back(l);
-        }
-    }
 
-    // Return Count of Actually Read Lines:
-    log_d("Exported %d/%d lines", logs.size(), logs.capacity());
+    // Read and Expand Records:
+    this->file.exportRecords(logs.capacity() - logs.size(), [&logs](const log_entry_t& entry) {
+        char text[MAX_LOG_LENGTH];
+        expand(entry, text, sizeof(text));
+        log_message_t message;
+        message.timestamp = TimeManager::fromEpoch(entry.timestamp);
+        message.tag = modeToTag(entry.mode);
+        message.message = text;
+        logs.push_back(message);
+        return true;
+    });
+
+    // Return Count of Actually Read Messages:
+    log_d("Exported %d/%d messages", logs.size(), logs.capacity());
     return true;
 }
 
 /**
- * @brief Strips the first 'num' lines of this file. 
- * @param num line number of first line to keep 
+ * @brief Strips the oldest 'num' messages of this file
+ * @param num number of messages to strip
  * @return true on success, false otherwise
- * @note This operation is expensive and should be called with care.
  */
 bool Log::shrink(size_t num) {
-    if(!this->file.shrink(num)) {
-        log_e("Failed to shrink file");
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
         return false;
     }
-    return true;
+
+    return this->file.shrink(num, true);
 }
 
 /**
@@ -170,8 +299,12 @@ bool Log::shrink(size_t num) {
  * @return true on success, false otherwise
  */
 bool Log::clear() {
-    if(!this->file.reset()) {
-        log_e("Failed to reset file");
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    if(!this->file.clear()) {
         return false;
     }
     this->led.off();
@@ -187,43 +320,286 @@ void Log::acknowledge() {
 }
 
 /**
- * Tries to parse sensor data from the given line (CSV format) into the sensor data.
- * @param line string holding the CSV line in format TIME,FLOW,PRESSURE,LEVEL
- * @param data sensor data struct to be filled with parsed values
- * @return true on success, false if one of values failed to parse
+ * @brief Sets the minimum levels of the messages appended to the log file and printed to serial.
+ * Messages below both levels are not even queued. The levels are ordered DEBUG, INFO, WARNING,
+ * ERROR.
+ * @param fileLevel lowest mode appended to the log file
+ * @param serialLevel lowest mode printed to serial
+ * @note Safe to call from any task, store the levels with 'Config' to keep them after reboot
  */
-bool Log::parseLogLine(const char line[], log_message_t& log) {
-    // Copy Into Local String Buffer:
-    size_t len = strlen(line);
-    char buffer[len+1];
-    strncpy(buffer, line, len+1);
+void Log::setLevels(log_mode_t fileLevel, log_mode_t serialLevel) {
+    this->minFileSeverity.store(modeToSeverity(fileLevel), std::memory_order_relaxed);
+    this->minSerialSeverity.store(modeToSeverity(serialLevel), std::memory_order_relaxed);
+}
 
-    // Parse Time String:
-    char* token = strtok(buffer," ");
-    if(token == NULL) {
-        return false;
+/**
+ * @brief Get the lowest mode appended to the log file
+ * @return log mode
+ */
+log_mode_t Log::fileLevel() {
+    static const log_mode_t modes[] = {DEBUG, INFO, WARNING, ERROR}; // by severity
+    return modes[this->minFileSeverity.load(std::memory_order_relaxed)];
+}
+
+/**
+ * @brief Get the lowest mode printed to serial
+ * @return log mode
+ */
+log_mode_t Log::serialLevel() {
+    static const log_mode_t modes[] = {DEBUG, INFO, WARNING, ERROR}; // by severity
+    return modes[this->minSerialSeverity.load(std::memory_order_relaxed)];
+}
+
+/**
+ * @brief Checks if messages of the given mode are written or printed at all. Messages of mode
+ * ERROR turn on the error led.
+ * @param mode mode of log
+ * @return true if the message needs to be queued, false otherwise
+ */
+bool Log::accepts(log_mode_t mode) {
+    if(mode == ERROR) {
+        this->led.on();
     }
-    if(!TimeManager::fromDateTimeString(token, log.timestamp)) {
-        return false;
+    uint8_t severity = modeToSeverity(mode);
+    return severity >= this->minFileSeverity.load(std::memory_order_relaxed) || severity >= this->minSerialSeverity.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Claims the next slot of the ring for a message
+ * @param position set to the position of the claimed slot, see 'publish()'
+ * @return claimed slot, NULL if the ring is full (the message is counted as dropped)
+ */
+log_slot_t* Log::claim(uint32_t& position) {
+    position = this->tail.load(std::memory_order_relaxed);
+    while(true) {
+        log_slot_t* slot = &this->ring[position % LOG_RING_SIZE];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+        if(diff == 0) {
+            if(this->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                return slot; // slot claimed
+            }
+        } else if(diff < 0) {
+            this->dropped.fetch_add(1, std::memory_order_relaxed); // ring full, writer is behind
+            return NULL;
+        } else {
+            position = this->tail.load(std::memory_order_relaxed); // claimed by another task meanwhile
+        }
     }
+}
 
-    // Parse Log Tag:
-    token = strtok(NULL, " ");
-    if(token == NULL) {
-        return false;
+/**
+ * @brief Hands the filled slot over to the writer task and wakes it up
+ * @param slot slot returned by 'claim()'
+ * @param position position returned by 'claim()'
+ */
+void Log::publish(log_slot_t* slot, uint32_t position) {
+    slot->sequence.store(position + 1, std::memory_order_release);
+    if(this->signal != NULL) {
+        xSemaphoreGive(this->signal);
     }
-    log.tag = stringToTag(token);
+}
 
-    // Parse Message:
-    token = strtok(NULL, "'");
-    if(token == NULL) {
-        return false;
+/**
+ * @brief Takes the oldest message out of the ring
+ * @param entry entry to be filled
+ * @return true on success, false if there is no (completely written) message
+ * @note Call with semaphore taken
+ */
+bool Log::take(log_entry_t& entry) {
+    uint32_t position = this->head.load(std::memory_order_relaxed);
+    log_slot_t& slot = this->ring[position % LOG_RING_SIZE];
+    if(slot.sequence.load(std::memory_order_acquire) != position + 1) {
+        return false; // empty or still being written
+    }
+    entry = slot.entry;
+    slot.sequence.store(position + LOG_RING_SIZE, std::memory_order_release); // free slot for the next round
+    this->head.store(position + 1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Takes all messages out of the ring and collects them (see 'collect()'). Messages dropped
+ * because the ring was full are reported by a warning afterwards.
+ * @note Call with semaphore taken
+ */
+void Log::drain() {
+    log_entry_t entry;
+    while(this->take(entry)) {
+        if(this->admit(entry)) {
+            this->collect(entry);
+        }
     }
-    log.message = std::string(token);
+    uint32_t lost = this->dropped.exchange(0, std::memory_order_relaxed);
+    if(lost > 0) {
+        entry.timestamp = time(NULL);
+        entry.mode = WARNING;
+        entry.id = LOG_DROPPED;
+        entry.argc = 1;
+        entry.args[0] = lost;
+        this->collect(entry);
+    }
+}
+
+/**
+ * @brief Prints the given message to serial as a line with a prefix according to the log mode and
+ * appends its record to the log file (see 'append()'). The line is only printed if it fits into the serial
+ * buffer, so a slow or disconnected serial port never blocks the writer.
+ * @param entry message to collect
+ * @note Call with semaphore taken
+ */
+void Log::collect(const log_entry_t& entry) {
+    std::string timestamp = TimeManager::toString(TimeManager::fromEpoch(entry.timestamp));
 
-    // Return Success:
+    // Print to Serial:
+    uint8_t severity = modeToSeverity(entry.mode);
+    if(severity >= this->minSerialSeverity.load(std::memory_order_relaxed)) {
+        char text[MAX_LOG_LENGTH];
+        expand(entry, text, sizeof(text));
+        std::string buffer = timestamp+" ["+modeToPrefix(entry.mode)+"] "+text+"\r\n";
+        int space = Serial.availableForWrite(); // negative if the port is not ready
+        if(space >= 0 && (size_t)space >= buffer.size()) {
+            if(this->droppedSerial > 0 && (size_t)space >= buffer.size() + 48) {
+                Serial.printf("(%u log lines not printed)\r\n", this->droppedSerial);
+                this->droppedSerial = 0;
+            }
+            Serial.write((const uint8_t*)buffer.data(), buffer.size());
+        } else {
+            this->droppedSerial++;
+        }
+    }
+    if(timestamp.size() == 0 || severity < this->minFileSeverity.load(std::memory_order_relaxed)) { // invalid timestamp or below file level
+        return;
+    }
+
+    // Append Record:
+    this->append(entry);
+    this->urgent = this->urgent || entry.mode == LOG_FLUSH_MODE;
+}
+
+/**
+ * @brief Rate limits the given message per message: of all messages with the same mode, ID,
+ * arguments and text within LOG_RATE_PERIOD seconds, only the first LOG_RATE_BURST are passed.
+ * Further repeats are counted and summarized by a single message once the window ends (see
+ * 'expire()'). This keeps messages logged every cycle during an outage from filling the file and
+ * the uploads.
+ * @param entry message to check
+ * @return true if the message is passed, false if it is collapsed
+ * @note Call with semaphore taken
+ */
+bool Log::admit(const log_entry_t& entry) {
+    uint8_t record[LOG_RECORD_MAX_SIZE];
+    size_t size = LogCodec::encodeRecord(entry, record);
+    const size_t skip = offsetof(log_record_header_t, mode); // timestamp differs
+    uint32_t hash = esp_rom_crc32_le(0, record + skip, size - skip - sizeof(uint16_t));
+    hash = hash != 0 ? hash : 1; // zero marks unused sites
+
+    // Find Site:
+    log_site_t* site = NULL;
+    log_site_t* oldest = &this->sites[0];
+    for(log_site_t& candidate : this->sites) {
+        if(candidate.hash == hash) {
+            site = &candidate;
+            break;
+        }
+        if(candidate.hash == 0 || (oldest->hash != 0 && candidate.seen < oldest->seen)) {
+            oldest = &candidate; // unused or least recent
+        }
+    }
+    if(site == NULL) {
+        // Replace Least Recent Site:
+        if(oldest->repeats > 0) {
+            this->expire(*oldest, oldest->start + LOG_RATE_PERIOD); // summarize before it is lost
+        }
+        site = oldest;
+        site->hash = hash;
+        site->start = entry.timestamp;
+        site->passed = 0;
+        site->repeats = 0;
+    }
+    this->expire(*site, entry.timestamp);
+    site->seen = entry.timestamp;
+
+    // Pass or Collapse:
+    if(site->passed < LOG_RATE_BURST) {
+        site->passed++;
+        return true;
+    }
+    site->repeats++;
+    site->entry = entry;
+    return false;
+}
+
+/**
+ * @brief Ends the window of the given site if it is over: collapsed repeats are summarized by a
+ * message like "Last message repeated 37 times in 20 min: ..." and the next window starts.
+ * @param site site to check
+ * @param now seconds since epoch
+ * @note Call with semaphore taken
+ */
+void Log::expire(log_site_t& site, time_t now) {
+    if(now - site.start < LOG_RATE_PERIOD) {
+        return; // window not over yet
+    }
+    if(site.repeats > 0) {
+        char text[MAX_LOG_LENGTH];
+        expand(site.entry, text, sizeof(text));
+        log_entry_t summary;
+        summary.timestamp = site.seen;
+        summary.mode = site.entry.mode;
+        summary.id = LOG_TEXT;
+        summary.argc = 0;
+        unsigned long minutes = std::max<time_t>(site.seen - site.start, 60) / 60;
+        int len = snprintf(summary.text, sizeof(summary.text), "Last message repeated %u times in %lu min: ", site.repeats, minutes);
+        if(len > 0 && (size_t)len < sizeof(summary.text) - 1) { // message shortened to the space left
+            int left = (int)(sizeof(summary.text) - len - 1);
+            snprintf(summary.text + len, sizeof(summary.text) - len, "%.*s", left, text);
+        }
+        this->collect(summary);
+    }
+    site.start = now;
+    site.passed = 0;
+    site.repeats = 0;
+}
+
+/**
+ * @brief Appends the record of the given message to the log file. If the file is full, its
+ * oldest records are dropped first. The record is only staged in RAM by the store, see
+ * 'AppendBuffer'.
+ * @param entry message to append
+ * @return true on success, false otherwise
+ * @note Call with semaphore taken
+ */
+bool Log::append(const log_entry_t& entry) {
+    if(!this->file.append(&entry, 1)) {
+        log_w("Could not append log record");
+        RecordStore& store = this->file.store();
+        if(!store.check()) {
+            log_w("The log file failed the check");
+            if(!store.reset()) { // file is missing, nothing to lose
+                log_e("Could not recreate the log file as a fix");
+            }
+        }
+        return false;
+    }
     return true;
 }
 
+/**
+ * @brief Formats the given message with its format string (see LogMessages.h)
+ * @param entry message to format
+ * @param buffer buffer to be filled with the null-terminated text
+ * @param len size of the buffer
+ */
+void Log::expand(const log_entry_t& entry, char* buffer, size_t len) {
+    if(entry.id == LOG_TEXT || entry.id >= LOG_MESSAGE_COUNT) {
+        snprintf(buffer, len, "%s", entry.text);
+        return;
+    }
+    int32_t args[LOG_MAX_ARGS] = {};
+    memcpy(args, entry.args, std::min<size_t>(entry.argc, LOG_MAX_ARGS) * sizeof(int32_t));
+    snprintf(buffer, len, formats[entry.id], (int)args[0], (int)args[1], (int)args[2], (int)args[3]);
+}
 
-Log LogFile = Log("/log.txt");
+RingFile logStore = RingFile(Storage.fs(), "/log.bin", LOG_FILE_CAPACITY, LOG_FILE_FORMAT);
+AppendBuffer logBuffer = AppendBuffer(logStore, LOG_BUFFER_SIZE, LOG_FLUSH_PERIOD);
+Log LogFile = Log(logBuffer);
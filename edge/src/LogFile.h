@@ -1,17 +1,52 @@
 #ifndef LOG_FILE_H
 #define LOG_FILE_H
 
+#include <atomic>
+#include <initializer_list>
+#include "AppendBuffer.h"
 #include "FileManager.h"
-#include "SPIFFS.h"
+#include "LogCodec.h"
+#include "RecordLog.h"
+#include "RingFile.h"
+#include "Storage.h"
 #include "Output.h"
 #include "TimeManager.h"
 
 // Pin Definitions:
 #define LED_RED 4
 
-#define MAX_LOG_LENGTH 100
+// Binary Format:
+#define LOG_FILE_FORMAT 1 // format of the log records on disk
+#define LOG_FILE_CAPACITY (64 * 1024) // maximum number of bytes stored on disk, oldest records are dropped
+#define LEGACY_LOG_FILE "/log.txt" // text log file of previous firmware versions
+#define LOG_MIGRATION_BATCH_SIZE 16 // number of legacy lines converted at once
+#define LOG_MIGRATION_NAME "log" // name of the migration progress in the config
 
-typedef enum {INFO, WARNING, ERROR, DEBUG} log_mode_t;
+// Buffering:
+#define LOG_RING_SIZE 32 // messages buffered in RAM until the writer task takes them (power of two)
+#define LOG_BUFFER_SIZE (4 * FLASH_PAGE_SIZE) // bytes of records staged in RAM, appended to the log file in whole flash pages
+#define LOG_FLUSH_PERIOD (30 * 1000) // maximum time in ms a record is staged before it is appended
+#define LOG_WAKE_PERIOD (5 * 1000) // maximum time in ms the writer task sleeps, bounds the delay past LOG_FLUSH_PERIOD
+#define LOG_FLUSH_MODE ERROR // records of this mode are appended right away
+
+// Rate Limiting:
+#define LOG_SITES 16 // distinct messages tracked at once, the least recent one is replaced
+#define LOG_RATE_PERIOD (20 * 60) // length of a rate limiting window in seconds
+#define LOG_RATE_BURST 2 // lines of the same message written per window, further repeats are collapsed
+
+typedef struct {
+    std::atomic<uint32_t> sequence; // position the slot is written at next, or position + 1 once written
+    log_entry_t entry;
+} log_slot_t;
+
+typedef struct {
+    uint32_t hash;          // CRC32 of mode, ID, arguments and text, 0 if unused
+    time_t start;           // beginning of the current window
+    time_t seen;            // time the message was logged last
+    uint16_t passed;        // lines written in the current window
+    uint32_t repeats;       // lines collapsed in the current window
+    log_entry_t entry;      // message collapsed
+} log_site_t;
 
 typedef struct {
     tm timestamp;
@@ -21,19 +56,44 @@ typedef struct {
 
 class Log {
 public:
-    Log(const std::string& filename);
+    Log(RecordStore& store);
     bool begin();
     bool log(log_mode_t mode, std::string&& msg);
+    bool log(log_mode_t mode, log_id_t id, std::initializer_list<int32_t> args = {});
+    bool persist(TickType_t timeout);
+    bool flush();
     bool exportLogs(std::vector<log_message_t>& logs);
     bool shrink(size_t num);
     bool clear(void);
     void acknowledge();
+    void setLevels(log_mode_t fileLevel, log_mode_t serialLevel);
+    log_mode_t fileLevel();
+    log_mode_t serialLevel();
 private:
-    FileManager file;
+    RecordLog<log_entry_t, LogCodec> file;
     Output::Digital led;
-    SemaphoreHandle_t semaphore;
+    SemaphoreHandle_t semaphore; // taken by the writer of the file
+    SemaphoreHandle_t signal; // given by 'log()' to wake the writer task
+    log_slot_t ring[LOG_RING_SIZE]; // lock-free, any task produces and the writer task consumes
+    std::atomic<uint32_t> head; // position of the oldest message, advanced by the writer
+    std::atomic<uint32_t> tail; // position of the next message, advanced by the producers
+    std::atomic<uint32_t> dropped; // messages dropped because the ring was full
+    uint32_t droppedSerial; // lines not printed because the serial buffer was full
+    bool urgent; // a staged record needs to be appended right away
+    std::atomic<uint8_t> minFileSeverity; // records of lower severity are not appended to the file
+    std::atomic<uint8_t> minSerialSeverity; // lines of lower severity are not printed to serial
+    log_site_t sites[LOG_SITES]; // messages seen recently, for rate limiting
 
-    bool parseLogLine(const char line[], log_message_t& msg);
+    bool accepts(log_mode_t mode);
+    log_slot_t* claim(uint32_t& position);
+    void publish(log_slot_t* slot, uint32_t position);
+    bool take(log_entry_t& entry);
+    void drain();
+    void collect(const log_entry_t& entry);
+    bool admit(const log_entry_t& entry);
+    void expire(log_site_t& site, time_t now);
+    bool append(const log_entry_t& entry);
+    static void expand(const log_entry_t& entry, char* buffer, size_t len);
 };
 
 extern Log LogFile;
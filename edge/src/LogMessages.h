@@ -0,0 +1,56 @@
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+#include <cstdint>
+
+/**
+ * Table of the messages logged by ID (see 'Log::log(mode, id, args)'). Only the ID and the integer
+ * arguments of a message are stored, its format string is looked up when the log is exported.
+ * IDs are stored on disk, so append new messages at the end and never reorder or remove entries.
+ * Formats take up to LOG_MAX_ARGS integer arguments ("%d").
+ */
+#define LOG_MESSAGES(X) \
+    X(LOG_TEXT,                     "%s") /* free text, see 'Log::log(mode, msg)' */ \
+    X(LOG_DROPPED,                  "Dropped %d log messages because the log buffer was full") \
+    X(LOG_DEVICE_SETUP,             "Device setup.") \
+    X(LOG_DATA_FILE_INIT_FAILED,    "Failed to initialize data file") \
+    X(LOG_UI_ENABLE_FAILED,         "Failed to enable ui") \
+    X(LOG_UI_TOGGLE,                "toggle user interface") \
+    X(LOG_UI_TOGGLE_FAILED,         "Failed to enable interface") \
+    X(LOG_MODE_TOGGLE,              "toggle relais and operating mode") \
+    X(LOG_FIRMWARE_DOWNLOADING,     "Downloading firmware") \
+    X(LOG_FIRMWARE_DOWNLOAD_FAILED, "Failed to download firmware") \
+    X(LOG_FIRMWARE_INSTALLED,       "Firmware installed. Rebooting...") \
+    X(LOG_FIRMWARE_AVAILABLE,       "New firmware version available") \
+    X(LOG_SYNC_REBOOT,              "Too many errors during synchronization. Rebooting...") \
+    X(LOG_FREE_HEAP,                "Largest region currently free in heap at %d bytes.") \
+    X(LOG_NETWORK_FAILED,           "Cannot connect to network.") \
+    X(LOG_EXPORT_DATA_FAILED,       "Failed to export sensor values") \
+    X(LOG_DATA_CORRUPTED,           "Skipping corrupted records of data file") \
+    X(LOG_INSERT_DATA_FAILED,       "Failed to insert data") \
+    X(LOG_NO_DATA,                  "No data exported") \
+    X(LOG_DATA_CHECK,               "Checking data file") \
+    X(LOG_INSERT_ROLLUPS_FAILED,    "Failed to insert rollups") \
+    X(LOG_EXPORT_LOGS_FAILED,       "Failed to export log messages") \
+    X(LOG_INSERT_LOGS_FAILED,       "Failed to insert logs") \
+    X(LOG_INSERT_VERSION_FAILED,    "Failed to insert firmware version") \
+    X(LOG_SYNC_FAILED,              "Failed to synchronize.") \
+    X(LOG_SHRINK_DATA_FAILED,       "Failed to shrink data file") \
+    X(LOG_SHRINK_ROLLUPS_FAILED,    "Failed to shrink rollups") \
+    X(LOG_SKIP_DATA_FAILED,         "Failed to skip data summarized by rollups") \
+    X(LOG_SHRINK_LOGS_FAILED,       "Failed to shrink log file") \
+    X(LOG_SYNC_OFFLINE,             "Cannot synchronize without network connection") \
+    X(LOG_FETCH_OFFLINE,            "Cannot fetch firmware without network connection") \
+    X(LOG_REQUEST_BEGIN_FAILED,     "Failed to begin request!") \
+    X(LOG_REQUEST_FAILED,           "Request failed: HTTP client error %d") \
+    X(LOG_RESPONSE_TOO_LARGE,       "Response body too large.") \
+    X(LOG_INSERT_WEAR_FAILED,       "Failed to insert flash write counters")
+
+#define LOG_MESSAGE_ID(id, format) id,
+typedef enum : uint16_t {
+    LOG_MESSAGES(LOG_MESSAGE_ID)
+    LOG_MESSAGE_COUNT
+} log_id_t;
+#undef LOG_MESSAGE_ID
+
+#endif /* LOG_MESSAGES_H */
@@ -0,0 +1,219 @@
+#include "Rollup.h"
+#include "esp_rom_crc.h"
+
+#define ROLLUP_SIZE sizeof(rollup_record_t)
+
+/**
+ * [INFO]
+ * A rollup series summarizes the measurement stream in windows of a fixed length, aligned to the
+ * epoch (e.g. full minutes). The storage task adds every sample as it arrives, so the open window
+ * is kept in RAM and closed as soon as a sample of the next window arrives. Closed windows are
+ * appended to the store in batches of ROLLUP_FLUSH_PERIOD seconds, so a per-minute series writes
+ * to flash every ten minutes. The sync task reads and consumes the stored rollups from the front.
+ * The store only keeps the newest rollups, older ones are dropped once it is full (see
+ * 'RecordLog').
+ */
+
+/**
+ * Constructor initalizes a rollup series on top of the given store
+ * @param store store holding the closed windows on disk (fixed-size records)
+ * @param resolution length of a window in seconds (e.g. 60 for per-minute rollups)
+ */
+RollupSeries::RollupSeries(RecordStore& store, uint32_t resolution) : records(store, name, true), length(resolution), end(0) {
+    snprintf(this->name, sizeof(this->name), "rollup file (%u s)", (unsigned)resolution);
+    this->current = {};
+    this->sums[0] = this->sums[1] = this->sums[2] = 0;
+}
+
+/**
+ * @brief Checks the store and finds the end of the newest stored window
+ * @return true on success, false otherwise
+ */
+bool RollupSeries::begin() {
+    // Initialize Store:
+    if(!this->records.begin()) {
+        return false;
+    }
+
+    // Find End of Newest Window:
+    RecordStore& store = this->records.store();
+    size_t size = store.size();
+    rollup_record_t rollup;
+    if(size >= ROLLUP_SIZE && store.peek(size - ROLLUP_SIZE, (uint8_t*)&rollup, ROLLUP_SIZE) == ROLLUP_SIZE && rollup.crc == RollupCodec::checksum(rollup)) {
+        this->end.store(rollup.start + this->length, std::memory_order_release);
+    }
+    return true;
+}
+
+/**
+ * @brief Adds the given sample to the open window. A sample of another window closes the open
+ * window first.
+ * @param record sample to add
+ * @return true on success, false if closed windows could not be appended to the store
+ * @note Call from the storage task only, it is the single producer of this series
+ */
+bool RollupSeries::add(const data_record_t& record) {
+    // Close Window:
+    uint32_t start = record.timestamp - record.timestamp % this->length;
+    bool success = true;
+    if(this->current.count > 0 && start != this->current.start) {
+        for(size_t i = 0; i < 3; i++) {
+            this->current.mean[i] = this->sums[i] / this->current.count;
+        }
+        this->closed.push_back(this->current);
+        this->current.count = 0;
+        if(this->closed.size() * this->length >= ROLLUP_FLUSH_PERIOD) {
+            success = this->flush();
+        }
+    }
+
+    // Open Window:
+    const uint16_t values[3] = {record.flow, record.pressure, record.level};
+    if(this->current.count == 0) {
+        this->current.start = start;
+        for(size_t i = 0; i < 3; i++) {
+            this->current.min[i] = values[i];
+            this->current.max[i] = values[i];
+            this->sums[i] = 0;
+        }
+    }
+
+    // Add Sample:
+    for(size_t i = 0; i < 3; i++) {
+        this->current.min[i] = std::min(this->current.min[i], values[i]);
+        this->current.max[i] = std::max(this->current.max[i], values[i]);
+        this->sums[i] += values[i];
+    }
+    this->current.count++;
+    return success;
+}
+
+/**
+ * @brief Calls the given callback for the oldest stored rollups, one at a time. Corrupted rollups
+ * at the front are dropped, see 'RecordLog::exportRecords()'.
+ * @param maxItems maximum number of rollups to visit
+ * @param callback function called with each rollup, returns false to stop
+ * @return true on success, false otherwise
+ */
+bool RollupSeries::forEach(size_t maxItems, const std::function<bool(const rollup_record_t& rollup)>& callback) {
+    this->records.exportRecords(maxItems, callback);
+    return true;
+}
+
+/**
+ * @brief Strips the oldest 'num' rollups
+ * @param num number of rollups to strip
+ * @return true on success, false otherwise
+ */
+bool RollupSeries::shrink(size_t num) {
+    return this->records.shrink(num, true);
+}
+
+/**
+ * @brief Get the number of stored rollups
+ * @return number of rollups
+ */
+size_t RollupSeries::count() {
+    return this->records.count();
+}
+
+/**
+ * @brief Get the length of the windows
+ * @return seconds per window
+ */
+uint32_t RollupSeries::resolution() {
+    return this->length;
+}
+
+/**
+ * @brief Get the time up to which samples are summarized by stored rollups, i.e. the end of the
+ * newest window appended to the store
+ * @return seconds since epoch (zero if no window was stored yet)
+ */
+uint32_t RollupSeries::covered() {
+    return this->end.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Appends the closed windows to the store. The oldest rollups are dropped if the store is
+ * full. On failure the closed windows are kept in RAM and appended with the next flush.
+ * @return true on success, false otherwise
+ */
+bool RollupSeries::flush() {
+    if(!this->records.append(this->closed.data(), this->closed.size())) {
+        log_e("Failed to append %u rollups (%u s)", this->closed.size(), this->length);
+        if(this->closed.size() * this->length > 4 * ROLLUP_FLUSH_PERIOD) {
+            this->closed.erase(this->closed.begin()); // keep RAM bounded while the store fails
+        }
+        return false;
+    }
+    this->end.store(this->closed.back().start + this->length, std::memory_order_release);
+    this->closed.clear();
+    return true;
+}
+
+/**
+ * @brief Appends the given rollups with their checksums to the buffer
+ * @param rollups rollups to encode, oldest first
+ * @param num number of rollups
+ * @param buffer buffer the encoded bytes are appended to
+ * @return true on success, false otherwise
+ */
+bool RollupCodec::encode(const rollup_record_t* rollups, size_t num, std::vector<uint8_t>& buffer) {
+    buffer.reserve(buffer.size() + num * ROLLUP_SIZE);
+    for(size_t i = 0; i < num; i++) {
+        rollup_record_t rollup = rollups[i];
+        rollup.crc = checksum(rollup);
+        const uint8_t* bytes = (const uint8_t*)&rollup;
+        buffer.insert(buffer.end(), bytes, bytes + ROLLUP_SIZE);
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes the rollups at the beginning of the given bytes and calls the callback for each
+ * of them. Decoding stops at the first rollup failing its checksum.
+ * @param buffer encoded bytes, starting at a rollup
+ * @param len number of bytes in buffer
+ * @param max maximum number of rollups to decode
+ * @param callback function called with each rollup, returns false to stop decoding
+ * @param corrupt set to true if decoding stopped at a corrupted rollup
+ * @return number of bytes of the rollups passed to the callback
+ */
+size_t RollupCodec::decode(const uint8_t* buffer, size_t len, size_t max, const std::function<bool(const rollup_record_t& rollup)>& callback, bool& corrupt) {
+    corrupt = false;
+    size_t num = std::min(len / ROLLUP_SIZE, max);
+    for(size_t i = 0; i < num; i++) {
+        rollup_record_t rollup;
+        memcpy(&rollup, buffer + i * ROLLUP_SIZE, ROLLUP_SIZE);
+        if(rollup.crc != checksum(rollup)) {
+            corrupt = true;
+            return i * ROLLUP_SIZE;
+        }
+        if(!callback(rollup)) {
+            return i * ROLLUP_SIZE; // stopped by callback
+        }
+    }
+    return num * ROLLUP_SIZE;
+}
+
+/**
+ * @brief Get the number of bytes to skip a corrupted rollup reported by 'decode()'
+ * @param buffer encoded bytes, starting at the corrupted rollup
+ * @param len number of bytes in buffer
+ * @param items set to the number of rollups skipped (0 if the buffer holds no entire rollup)
+ * @return number of bytes to skip
+ */
+size_t RollupCodec::resync(const uint8_t* buffer, size_t len, size_t& items) {
+    items = len >= ROLLUP_SIZE ? 1 : 0;
+    return std::min(len, ROLLUP_SIZE);
+}
+
+/**
+ * @brief Calculates the checksum of the given rollup
+ * @param rollup rollup to check
+ * @return CRC16 of all fields but the checksum
+ */
+uint16_t RollupCodec::checksum(const rollup_record_t& rollup) {
+    return esp_rom_crc16_le(0, (const uint8_t*)&rollup, offsetof(rollup_record_t, crc));
+}
@@ -0,0 +1,60 @@
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "DataCodec.h"
+#include "RecordLog.h"
+
+#define ROLLUP_FORMAT 1 // format of the rollup records on disk
+#define ROLLUP_FLUSH_PERIOD 600 // seconds of closed windows kept in RAM before they are appended at once
+
+// Series:
+typedef enum {
+    ROLLUP_MINUTE = 0,
+    ROLLUP_HOUR = 1
+} rollup_series_t;
+#define ROLLUP_SERIES 2
+
+typedef struct __attribute__((packed)) {
+    uint32_t start;     // beginning of the window, seconds since epoch
+    uint16_t count;     // number of samples in the window
+    uint16_t min[3];    // flow, pressure and level
+    uint16_t max[3];
+    uint16_t mean[3];
+    uint16_t crc;       // CRC16 of the fields above
+} rollup_record_t;
+
+class RollupCodec {
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * sizeof(rollup_record_t); // rollups read from the store at once
+    static constexpr size_t UNIT_LENGTH = 1; // fixed-size records, each with its own checksum
+    static bool encode(const rollup_record_t* rollups, size_t num, std::vector<uint8_t>& buffer);
+    static size_t decode(const uint8_t* buffer, size_t len, size_t max, const std::function<bool(const rollup_record_t& rollup)>& callback, bool& corrupt);
+    static size_t resync(const uint8_t* buffer, size_t len, size_t& items);
+    static uint16_t checksum(const rollup_record_t& rollup);
+};
+
+class RollupSeries {
+public:
+    RollupSeries(RecordStore& store, uint32_t resolution);
+    bool begin();
+    bool add(const data_record_t& record);
+    bool forEach(size_t maxItems, const std::function<bool(const rollup_record_t& rollup)>& callback);
+    bool shrink(size_t num);
+    size_t count();
+    uint32_t resolution();
+    uint32_t covered();
+private:
+    char name[24]; // name of the file used in log messages, e.g. "rollup file (60 s)"
+    RecordLog<rollup_record_t, RollupCodec> records;
+    uint32_t length; // length of a window in seconds
+    rollup_record_t current; // open window, 'count' is zero if there is none
+    uint32_t sums[3]; // sums of flow, pressure and level of the open window
+    std::vector<rollup_record_t> closed; // closed windows not appended to the store yet
+    std::atomic<uint32_t> end; // end of the newest window appended to the store
+    bool flush();
+};
+
+#endif /* ROLLUP_H */
@@ -0,0 +1,219 @@
+#include "SampleCache.h"
+#include "esp_rom_crc.h"
+
+/**
+ * [INFO]
+ * The cache is a statically sized ring of packed records. The storage task (see
+ * 'DataFile.persist()') is the only producer and the only one writing to the slots. Records are
+ * consumed from the front either by the storage task itself (claiming them to flush them to the
+ * disk file, committed once stored) or by the sync task (after syncing cached records). Both
+ * advance the head with compare-and-swap, so only one of them consumes a range.
+ * Indices grow monotonically and wrap around at 2^32, the slot of an index is 'index % size'.
+ * The slots are kept in the given memory together with a copy of the indices, so the records can
+ * be adopted again after a reboot if the memory is not initialized on boot (RTC_NOINIT_ATTR).
+ * The atomic indices themselves stay in RAM, since compare-and-swap does not work on RTC memory.
+ */
+
+SampleCache::SampleCache(sample_cache_memory_t& memory) : memory(memory), head(0), tail(0) {}
+
+/**
+ * @brief Adopts the records left in memory by the previous boot. Records are only adopted if the
+ * memory was initialized and their checksum matches. All other records are dropped. Without valid
+ * records the cache starts empty.
+ * @return number of adopted records
+ * @note Call once before using the cache
+ */
+size_t SampleCache::adopt() {
+    uint32_t h = this->memory.head;
+    uint32_t t = this->memory.tail;
+    size_t adopted = 0;
+    if(this->memory.magic == SAMPLE_CACHE_MAGIC && t - h <= SAMPLE_CACHE_SIZE) {
+        // Move Valid Records to the Front:
+        for(uint32_t index = h; index != t; index++) {
+            data_record_t record = this->memory.records[index % SAMPLE_CACHE_SIZE];
+            if(checksum(record, index) != this->memory.checksums[index % SAMPLE_CACHE_SIZE]) {
+                continue; // torn or stale record
+            }
+            uint32_t target = h + adopted;
+            this->memory.records[target % SAMPLE_CACHE_SIZE] = record;
+            this->memory.checksums[target % SAMPLE_CACHE_SIZE] = checksum(record, target);
+            adopted++;
+        }
+        t = h + adopted;
+    } else {
+        h = t = 0; // not initialized yet
+    }
+
+    // Initialize Indices:
+    this->memory.magic = SAMPLE_CACHE_MAGIC;
+    this->memory.head = h;
+    this->memory.tail = t;
+    this->head.store(h, std::memory_order_release);
+    this->tail.store(t, std::memory_order_release);
+    return adopted;
+}
+
+/**
+ * @brief Marks the memory as not initialized, so 'adopt()' starts with an empty cache
+ */
+void SampleCache::discard() {
+    this->memory.magic = 0;
+}
+
+/**
+ * @brief Appends the record to the end of the cache
+ * @param record record to append
+ * @return true on success, false if the cache is full
+ * @note Call from the storage task only
+ */
+bool SampleCache::push(const data_record_t& record) {
+    uint32_t t = this->tail.load(std::memory_order_relaxed);
+    if(t - this->head.load(std::memory_order_acquire) >= SAMPLE_CACHE_SIZE) {
+        return false; // full
+    }
+    this->memory.records[t % SAMPLE_CACHE_SIZE] = record;
+    this->memory.checksums[t % SAMPLE_CACHE_SIZE] = checksum(record, t);
+    this->tail.store(t + 1, std::memory_order_release);
+    this->memory.tail = t + 1;
+    return true;
+}
+
+/**
+ * @brief Copies the record with the given index. The copy is checked afterwards, since the
+ * storage task may reuse the slot once the record was consumed by someone else.
+ * @param index index of the record, between 'begin()' and 'end()'
+ * @param record copy of the record
+ * @return true on success, false if the record was overwritten
+ */
+bool SampleCache::read(uint32_t index, data_record_t& record) {
+    uint32_t h = this->head.load(std::memory_order_acquire);
+    if(index - h >= this->tail.load(std::memory_order_acquire) - h) {
+        return false; // not in cache
+    }
+    record = this->memory.records[index % SAMPLE_CACHE_SIZE];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return this->tail.load(std::memory_order_relaxed) - index < SAMPLE_CACHE_SIZE;
+}
+
+/**
+ * @brief Get the records from index 'from' up to 'to' (exclusive) that are stored contiguously,
+ * i.e. up to the wrap around of the ring. Call again with the next index for the rest.
+ * @param from index of the first record
+ * @param to index after the last record
+ * @param records pointer to the first record
+ * @return number of contiguous records
+ * @note Call from the storage task only, other tasks use 'read()'
+ */
+size_t SampleCache::span(uint32_t from, uint32_t to, const data_record_t*& records) {
+    size_t slot = from % SAMPLE_CACHE_SIZE;
+    records = &this->memory.records[slot];
+    return std::min((size_t)(to - from), SAMPLE_CACHE_SIZE - slot);
+}
+
+/**
+ * @brief Removes 'num' records from the front of the cache, if the front is still at index 'from'.
+ * @param from index of the first record to remove, i.e. the value of 'begin()' the caller saw
+ * @param num number of records to remove
+ * @return true on success, false if the records were already consumed by someone else
+ */
+bool SampleCache::consume(uint32_t from, size_t num) {
+    if(num > this->tail.load(std::memory_order_acquire) - from) {
+        return false; // not that many records
+    }
+    if(!this->head.compare_exchange_strong(from, from + num, std::memory_order_acq_rel)) {
+        return false;
+    }
+    this->memory.head = from + num; // a racing consumer may store an older copy, records are then adopted twice at worst
+    return true;
+}
+
+/**
+ * @brief Removes 'num' records from the front of the cache like 'consume()', but keeps the copy of
+ * the head in memory. Other consumers cannot take the records anymore, but they are adopted again
+ * after a reboot until the claim is committed with 'commit()' (or undone with 'rewind()').
+ * @param from index of the first record to claim, i.e. the value of 'begin()' the caller saw
+ * @param num number of records to claim
+ * @return true on success, false if the records were already consumed by someone else
+ * @note Call from the storage task only
+ */
+bool SampleCache::claim(uint32_t from, size_t num) {
+    if(num > this->tail.load(std::memory_order_acquire) - from) {
+        return false; // not that many records
+    }
+    return this->head.compare_exchange_strong(from, from + num, std::memory_order_acq_rel);
+}
+
+/**
+ * @brief Commits the records claimed with 'claim()' once they are stored elsewhere, so they are
+ * not adopted again after a reboot
+ * @param to index after the last claimed record
+ * @note Call from the storage task only
+ */
+void SampleCache::commit(uint32_t to) {
+    this->memory.head = to;
+}
+
+/**
+ * @brief Puts records consumed with 'consume()' or claimed with 'claim()' back to the front of the cache, e.g. after they
+ * failed to flush. The records must not have been overwritten since.
+ * @param from index of the first consumed record
+ * @param to index after the last consumed record, i.e. the front of the cache after consuming
+ * @return true on success, false if the front of the cache moved on already
+ * @note Call from the storage task only
+ */
+bool SampleCache::rewind(uint32_t from, uint32_t to) {
+    if(!this->head.compare_exchange_strong(to, from, std::memory_order_acq_rel)) {
+        return false;
+    }
+    this->memory.head = from;
+    return true;
+}
+
+/**
+ * @brief Removes all records from the cache
+ */
+void SampleCache::clear() {
+    uint32_t h = this->head.load(std::memory_order_acquire);
+    uint32_t t;
+    do {
+        t = this->tail.load(std::memory_order_acquire);
+    } while(!this->head.compare_exchange_weak(h, t, std::memory_order_acq_rel));
+    this->memory.head = t;
+}
+
+/**
+ * @brief Get the index of the oldest record
+ * @return index
+ */
+uint32_t SampleCache::begin() {
+    return this->head.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Get the index after the newest record
+ * @return index
+ */
+uint32_t SampleCache::end() {
+    return this->tail.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Get the number of records in the cache
+ * @return number of records
+ */
+size_t SampleCache::size() {
+    uint32_t h = this->head.load(std::memory_order_acquire);
+    return this->tail.load(std::memory_order_acquire) - h;
+}
+
+/**
+ * @brief Calculates the checksum of the record in the slot of the given index. The index is part
+ * of the checksum, so records left over from an earlier round of the ring do not pass.
+ * @param record record to check
+ * @param index index of the record
+ * @return CRC16
+ */
+uint16_t SampleCache::checksum(const data_record_t& record, uint32_t index) {
+    uint16_t crc = esp_rom_crc16_le(0, (const uint8_t*)&record, sizeof(record));
+    return esp_rom_crc16_le(crc, (const uint8_t*)&index, sizeof(index));
+}
@@ -0,0 +1,41 @@
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <atomic>
+#include "DataCodec.h"
+
+#define SAMPLE_CACHE_SIZE 120 // number of records held in RAM
+#define SAMPLE_CACHE_MAGIC 0x48434153 // "SACH" in little endian byte order
+
+typedef struct {
+    uint32_t magic; // identifies initialized memory
+    uint32_t head;  // copy of the head index
+    uint32_t tail;  // copy of the tail index
+    data_record_t records[SAMPLE_CACHE_SIZE];
+    uint16_t checksums[SAMPLE_CACHE_SIZE]; // CRC of each record and its index
+} sample_cache_memory_t;
+
+class SampleCache {
+public:
+    SampleCache(sample_cache_memory_t& memory);
+    size_t adopt();
+    void discard();
+    bool push(const data_record_t& record);
+    bool read(uint32_t index, data_record_t& record);
+    size_t span(uint32_t from, uint32_t to, const data_record_t*& records);
+    bool consume(uint32_t from, size_t num);
+    bool claim(uint32_t from, size_t num);
+    void commit(uint32_t to);
+    bool rewind(uint32_t from, uint32_t to);
+    void clear();
+    uint32_t begin();
+    uint32_t end();
+    size_t size();
+private:
+    sample_cache_memory_t& memory; // slots, may live in RTC memory to survive a reboot
+    std::atomic<uint32_t> head; // index of the oldest record, advanced by consumers
+    std::atomic<uint32_t> tail; // index after the newest record, advanced by the producer (storage task)
+    static uint16_t checksum(const data_record_t& record, uint32_t index);
+};
+
+#endif /* SAMPLE_CACHE_H */
@@ -0,0 +1,591 @@
+#include "SegmentStore.h"
+#include "CriticalRuntime.h"
+#include "TimeManager.h"
+
+#define HEADER_SIZE sizeof(segment_header_t)
+#define MIGRATION_CHUNK_SIZE 512 // bytes copied at once when migrating segments
+
+/**
+ * @brief Constructor initializes a store of append-only segment files. A new segment is started
+ * every day or once the current segment reached its maximum size. The file names of all segments
+ * are kept in the job list of the config, which is used as a ring so starting or deleting a segment
+ * only writes the job of that segment. Consumed items are dropped by deleting whole segments,
+ * unless consumed segments are retained (see 'retain()').
+ * @param fs file system holding the segments
+ * @param prefix path prefix of the segment files (e.g. "/data"), the directory must exist
+ * @param segmentSize maximum size of a single segment in bytes
+ * @param capacity maximum size of all segments combined in bytes, oldest segments are deleted
+ * once it is reached
+ * @param format format of the items, checked when reusing existing segments
+ * @param jobList name of the job list in the config, every store needs its own list
+ * @param daily start a new segment every day, otherwise only once the current segment is full
+ */
+SegmentStore::SegmentStore(fs::FS& filesystem, const std::string& prefix, size_t segmentSize, size_t capacity, uint16_t format, const char* jobList, bool daily) : fs(filesystem), prefix(prefix), segmentSize(segmentSize), capacity(capacity), format(format), jobList(jobList), daily(daily) {
+    this->retainConsumed = false;
+    this->jobStart = 0;
+    this->semaphore = xSemaphoreCreateMutex();
+    if(semaphore == NULL) {
+        log_e("Not enough heap to use segment store semaphore.");
+    }
+}
+
+/**
+ * @brief Loads the segments listed in the job list. Segments that are missing or broken are
+ * removed from the list.
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::check() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Check Directory:
+    size_t slash = this->prefix.rfind('/');
+    if(slash != std::string::npos && slash > 0 && !this->fs.exists(this->prefix.substr(0, slash).c_str())) {
+        log_w("Directory of segments %s not found", this->prefix.c_str());
+        return false; // e.g. removable media missing, keep the job list
+    }
+
+    // Load Segments From Job List:
+    this->segments.clear();
+    this->jobStart = Config.loadJobStart(this->jobList) % MAX_SEGMENTS;
+    size_t jobLength = Config.loadJobLength(this->jobList);
+    for(size_t i = 0; i < jobLength; i++) {
+        std::string path = Config.loadJob(this->jobIndex(i), this->jobList);
+        segment_t segment;
+        if(!this->load(path, segment)) {
+            log_w("Dropping broken segment %s from job list", path.c_str());
+            this->fs.remove(path.c_str());
+            continue;
+        }
+        this->segments.push_back(segment);
+    }
+
+    // Update Job List:
+    if(this->segments.size() != jobLength) {
+        this->storeJobs(jobLength);
+    }
+
+    log_d("Loaded %u segments", this->segments.size());
+    return true;
+}
+
+/**
+ * @brief Deletes all segments and clears the job list
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::reset() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    size_t jobLength = this->segments.size();
+    for(const segment_t& segment : this->segments) {
+        this->fs.remove(segment.path.c_str());
+    }
+    this->segments.clear();
+    this->storeJobs(jobLength);
+    return true;
+}
+
+/**
+ * @brief Appends the given bytes to the current segment. A new segment is started if the day
+ * changed or the bytes do not fit into the current segment. If the capacity is reached the
+ * oldest segments are deleted, even if they were not consumed yet.
+ * @param buffer bytes to append
+ * @param len number of bytes in buffer
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::push(const uint8_t* buffer, size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Start New Segment:
+    if(!this->prepare(len)) {
+        return false;
+    }
+
+    // Append Bytes:
+    segment_t& segment = this->segments.back();
+    if(!segment.file->write(HEADER_SIZE + segment.header.used, buffer, len)) { // overwrites bytes of a torn append
+        log_e("Failed to append to segment %s", segment.path.c_str());
+        return false;
+    }
+
+    // Commit Bytes:
+    segment_header_t previous = segment.header;
+    segment.header.used += len;
+    segment.header.count += items;
+    if(!this->writeHeader(segment)) {
+        segment.header = previous;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads bytes from the segments without consuming them, starting 'offset' bytes after the
+ * oldest unconsumed byte. Reading continues with the next segment at the end of a segment.
+ * @param offset number of bytes to skip
+ * @param buffer buffer to be filled, needs to hold at least 'len' bytes
+ * @param len maximum number of bytes to read
+ * @return number of bytes actually read (zero in case of error)
+ */
+size_t SegmentStore::peek(size_t offset, uint8_t* buffer, size_t len) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+
+    size_t bytes = 0;
+    for(const segment_t& segment : this->segments) {
+        // Skip Segment:
+        size_t remaining = segment.header.used - segment.header.head;
+        if(offset >= remaining) {
+            offset -= remaining;
+            continue;
+        }
+
+        // Read From Segment:
+        size_t chunk = std::min(len - bytes, remaining - offset);
+        size_t num = segment.file->read(HEADER_SIZE + segment.header.head + offset, buffer + bytes, chunk);
+        bytes += num;
+        offset = 0;
+        if(num < chunk || bytes == len) {
+            break; // read error or buffer full
+        }
+    }
+    return bytes;
+}
+
+/**
+ * @brief Consumes bytes from the oldest segments. Segments that are consumed entirely are
+ * deleted (unless consumed segments are retained), otherwise only the header of the segment is
+ * updated.
+ * @param len number of bytes to consume
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::pop(size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    size_t i = 0;
+    while(len > 0 && i < this->segments.size()) {
+        segment_t& segment = this->segments[i];
+        size_t remainingBytes = segment.header.used - segment.header.head;
+        size_t remainingItems = segment.header.count - segment.header.consumed;
+
+        // Skip Retained Segment:
+        if(remainingBytes == 0) {
+            i++;
+            continue;
+        }
+
+        // Delete Consumed Segment:
+        if(len >= remainingBytes && !this->retainConsumed && i == 0) {
+            if(!this->drop()) {
+                return false;
+            }
+            len -= remainingBytes;
+            items -= std::min(items, remainingItems);
+            continue;
+        }
+
+        // Advance Head of Segment:
+        size_t bytes = std::min(len, remainingBytes);
+        size_t num = bytes == remainingBytes ? remainingItems : std::min(items, remainingItems);
+        segment.header.head += bytes;
+        segment.header.consumed += num;
+        if(!this->writeHeader(segment)) {
+            return false;
+        }
+        len -= bytes;
+        items -= std::min(items, num);
+        i++;
+    }
+
+    if(len > 0) {
+        log_e("Consumed %u bytes more than stored in segments", len);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the number of unconsumed bytes in all segments
+ * @return number of bytes
+ */
+size_t SegmentStore::size() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return this->unconsumed();
+}
+
+/**
+ * @brief Get the number of unconsumed items in all segments
+ * @return number of items
+ */
+size_t SegmentStore::count() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    size_t items = 0;
+    for(const segment_t& segment : this->segments) {
+        items += segment.header.count - segment.header.consumed;
+    }
+    return items;
+}
+
+/**
+ * @brief Get the number of bytes that can still be pushed before the oldest segments get deleted
+ * @return number of bytes
+ */
+size_t SegmentStore::available() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    size_t total = 0;
+    for(const segment_t& segment : this->segments) {
+        total += HEADER_SIZE + segment.header.used;
+    }
+    return total < this->capacity ? this->capacity - total : 0;
+}
+
+/**
+ * @brief Get the file offset the next pushed byte is written at in the newest segment. A push that
+ * does not fit starts a new segment instead.
+ * @return byte offset in the newest segment file
+ */
+size_t SegmentStore::tail() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return HEADER_SIZE + (this->segments.empty() ? 0 : this->segments.back().header.used);
+}
+
+/**
+ * @brief Sets whether segments are kept after they were consumed entirely, e.g. to keep a
+ * history. Retained segments are deleted once the capacity is reached or they were migrated.
+ * Disabling it deletes the retained segments at the front right away.
+ * @param enable true to retain consumed segments, false to delete them
+ */
+void SegmentStore::retain(bool enable) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return;
+    }
+
+    this->retainConsumed = enable;
+    while(!enable && this->segments.size() > 1 && this->segments.front().header.head == this->segments.front().header.used) {
+        if(!this->drop()) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Moves the sealed segments of the given store, i.e. all but its newest segment, to the
+ * end of this store. The bytes of a sealed segment are appended to the current segment of this
+ * store as a whole, consumed bytes included, so this store may start new segments less often
+ * than the source. Bytes consumed in the source stay consumed as long as this store has no
+ * unconsumed bytes left. This holds if items are consumed from this store before the source.
+ * The sealed segments are deleted from the source afterwards.
+ * @param source store to move the sealed segments from, may be on another file system
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::migrate(SegmentStore& source) {
+    CriticalRuntime sourceRun(source.semaphore);
+    CriticalRuntime run(this->semaphore);
+    if(!sourceRun.isValid() || !run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    while(source.segments.size() > 1) {
+        const segment_t& sealed = source.segments.front();
+        const segment_header_t& h = sealed.header;
+        if(h.used > 0) {
+            // Start New Segment:
+            if(!this->prepare(h.used)) {
+                return false;
+            }
+            segment_t& segment = this->segments.back();
+
+            // Copy Bytes:
+            File from = source.fs.open(sealed.path.c_str(), FILE_READ);
+            File to = this->fs.open(segment.path.c_str(), "r+"); // read and write without truncating
+            if(!from || !to || !from.seek(HEADER_SIZE) || !to.seek(HEADER_SIZE + segment.header.used)) {
+                log_e("Could not open segment %s or %s", sealed.path.c_str(), segment.path.c_str());
+                return false;
+            }
+            uint8_t buffer[MIGRATION_CHUNK_SIZE];
+            size_t copied = 0;
+            while(copied < h.used) {
+                size_t len = std::min(sizeof(buffer), (size_t)(h.used - copied));
+                if(from.read(buffer, len) != len || to.write(buffer, len) != len) {
+                    break;
+                }
+                copied += len;
+            }
+            from.close();
+            to.close();
+            if(copied != h.used) {
+                log_e("Failed to copy segment %s to %s [%u/%u bytes]", sealed.path.c_str(), segment.path.c_str(), copied, h.used);
+                return false;
+            }
+
+            // Commit Bytes:
+            segment_header_t previous = segment.header;
+            if(this->unconsumed() == 0) { // keep consumed bytes consumed
+                segment.header.head = segment.header.used + h.head;
+                segment.header.consumed = segment.header.count + h.consumed;
+            } else if(h.head > 0) {
+                log_w("Consumed items of segment %s are unconsumed after migration", sealed.path.c_str());
+            }
+            segment.header.used += h.used;
+            segment.header.count += h.count;
+            if(!this->writeHeader(segment)) {
+                segment.header = previous;
+                return false;
+            }
+            log_i("Migrated segment %s to %s [%u bytes]", sealed.path.c_str(), segment.path.c_str(), h.used);
+        }
+
+        // Delete Sealed Segment:
+        if(!source.fs.remove(sealed.path.c_str())) {
+            log_e("Failed to delete migrated segment %s", sealed.path.c_str());
+            return false;
+        }
+        source.segments.pop_front();
+        source.dropJob();
+    }
+    return true;
+}
+
+/**
+ * @brief Reads and checks the header of the segment file with the given path
+ * @param path path of the segment file
+ * @param segment segment to be filled
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::load(const std::string& path, segment_t& segment) {
+    // Check Path:
+    size_t dateStart = this->prefix.size() + 1; // format: PREFIX_YYYY-MM-DD_NN.bin
+    if(path.compare(0, this->prefix.size(), this->prefix) != 0 || path.size() < dateStart + 10) {
+        log_w("Segment %s does not match prefix %s", path.c_str(), this->prefix.c_str());
+        return false;
+    }
+
+    // Read Header:
+    std::shared_ptr<FileManager> file = std::make_shared<FileManager>(this->fs, path);
+    if(!file->check()) {
+        return false;
+    }
+    segment_header_t h;
+    if(file->read(0, (uint8_t*)&h, HEADER_SIZE) != HEADER_SIZE) {
+        log_w("Segment %s too short to hold a header", path.c_str());
+        return false;
+    }
+    if(h.magic != SEGMENT_MAGIC || h.version != SEGMENT_VERSION || h.format != this->format) {
+        log_w("Segment %s has unknown format (magic = 0x%08X, version = %u, format = %u)", path.c_str(), h.magic, h.version, h.format);
+        return false;
+    }
+    if(h.head > h.used || h.consumed > h.count) {
+        log_w("Segment %s has invalid offsets (head = %u, used = %u)", path.c_str(), h.head, h.used);
+        return false;
+    }
+
+    segment.path = path;
+    segment.date = path.substr(dateStart, 10);
+    segment.header = h;
+    segment.file = file;
+    return true;
+}
+
+/**
+ * @brief Creates a new (empty) segment file for the date of the given segment. The segments of
+ * a single day are numbered consecutively.
+ * @param segment segment with date set, to be filled
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::create(segment_t& segment) {
+    // Find Unused File Name:
+    char path[SEGMENT_NAME_LENGTH];
+    size_t number = 0;
+    do {
+        snprintf(path, sizeof(path), "%s_%s_%02u.bin", this->prefix.c_str(), segment.date.c_str(), number++);
+    } while(this->fs.exists(path) && number < MAX_SEGMENTS);
+
+    // Write Header:
+    segment.path = path;
+    segment.header = {
+        .magic = SEGMENT_MAGIC,
+        .version = SEGMENT_VERSION,
+        .format = this->format,
+        .head = 0,
+        .used = 0,
+        .consumed = 0,
+        .count = 0
+    };
+    segment.file = std::make_shared<FileManager>(this->fs, segment.path);
+    if(!segment.file->write((const uint8_t*)&segment.header, HEADER_SIZE)) {
+        log_e("Could not write header of segment %s", path);
+        return false;
+    }
+
+    log_d("Started segment %s", path);
+    return true;
+}
+
+/**
+ * @brief Makes sure the current segment can take 'len' more bytes. A new segment is started if
+ * there is none, the day changed (daily segments only) or the bytes do not fit. If the capacity
+ * is reached the oldest segments are deleted, even if they were not consumed yet. Call with
+ * semaphore taken.
+ * @param len number of bytes to append
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::prepare(size_t len) {
+    std::string today = Time.toDateString();
+    bool full = !this->segments.empty() && this->segments.back().header.used + len > this->segmentSize;
+    bool expired = this->daily && !this->segments.empty() && this->segments.back().date != today;
+    if(!this->segments.empty() && !full && !expired) {
+        return true;
+    }
+
+    // Apply Retention Limit:
+    size_t total = HEADER_SIZE + len; // size of all segments including the new one
+    for(const segment_t& segment : this->segments) {
+        total += HEADER_SIZE + segment.header.used;
+    }
+    while(!this->segments.empty() && (total > this->capacity || this->segments.size() >= MAX_SEGMENTS)) {
+        total -= HEADER_SIZE + this->segments.front().header.used;
+        if(!this->drop()) {
+            return false;
+        }
+    }
+
+    // Create Segment:
+    segment_t segment;
+    segment.date = today;
+    if(!this->create(segment)) {
+        log_e("Failed to create new segment");
+        return false;
+    }
+    this->segments.push_back(segment);
+    this->appendJob();
+    return true;
+}
+
+/**
+ * @brief Deletes the oldest segment and removes it from the job list. Call with semaphore taken.
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::drop() {
+    segment_t& segment = this->segments.front();
+    size_t unconsumed = segment.header.count - segment.header.consumed;
+    if(unconsumed > 0) {
+        log_w("Deleting segment %s with %u unconsumed items", segment.path.c_str(), unconsumed);
+    }
+    if(!this->fs.remove(segment.path.c_str())) {
+        log_e("Failed to delete segment %s", segment.path.c_str());
+        return false;
+    }
+    this->segments.pop_front();
+    this->dropJob();
+    return true;
+}
+
+/**
+ * @brief Writes the header of the given segment to disk. Call with semaphore taken.
+ * @param segment segment to write the header of
+ * @return true on success, false otherwise
+ */
+bool SegmentStore::writeHeader(segment_t& segment) {
+    if(!segment.file->write(0, (const uint8_t*)&segment.header, HEADER_SIZE)) {
+        log_e("Failed to write header of segment %s", segment.path.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the number of unconsumed bytes in all segments. Call with semaphore taken.
+ * @return number of bytes
+ */
+size_t SegmentStore::unconsumed() {
+    size_t bytes = 0;
+    for(const segment_t& segment : this->segments) {
+        bytes += segment.header.used - segment.header.head;
+    }
+    return bytes;
+}
+
+/**
+ * @brief Get the index in the job list of the segment at the given position
+ * @param position position of the segment, zero for the oldest
+ * @return index of the job
+ */
+size_t SegmentStore::jobIndex(size_t position) {
+    return (this->jobStart + position) % MAX_SEGMENTS;
+}
+
+/**
+ * @brief Writes the file names of all segments to the job list of the config, e.g. after broken
+ * segments were removed from the middle. Call with semaphore taken.
+ * @param previousLength length of the job list before, superfluous jobs are deleted
+ */
+void SegmentStore::storeJobs(size_t previousLength) {
+    for(size_t i = 0; i < this->segments.size(); i++) {
+        Config.storeJob(this->segments[i].path.c_str(), this->jobIndex(i), this->jobList);
+    }
+    for(size_t i = this->segments.size(); i < previousLength; i++) {
+        Config.deleteJob(this->jobIndex(i), this->jobList);
+    }
+    Config.storeJobLength(this->segments.size(), this->jobList);
+}
+
+/**
+ * @brief Adds the newest segment to the end of the job list, the other jobs are kept. Call with
+ * semaphore taken.
+ */
+void SegmentStore::appendJob() {
+    size_t position = this->segments.size() - 1;
+    Config.storeJob(this->segments.back().path.c_str(), this->jobIndex(position), this->jobList);
+    Config.storeJobLength(this->segments.size(), this->jobList); // job is listed once written
+}
+
+/**
+ * @brief Removes the oldest job from the job list after its segment was deleted, the other jobs
+ * are kept. Call with semaphore taken.
+ */
+void SegmentStore::dropJob() {
+    size_t index = this->jobStart;
+    this->jobStart = this->jobIndex(1);
+    Config.storeJobStart(this->jobStart, this->jobList);
+    Config.storeJobLength(this->segments.size(), this->jobList);
+    Config.deleteJob(index, this->jobList); // unlisted already, a leftover key is overwritten later
+}
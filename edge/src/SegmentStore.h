@@ -0,0 +1,70 @@
+#ifndef SEGMENT_STORE_H
+#define SEGMENT_STORE_H
+
+#include <deque>
+#include <memory>
+#include "Config.h"
+#include "FileManager.h"
+#include "RecordStore.h"
+
+#define SEGMENT_MAGIC 0x4D474553 // "SEGM" in little endian byte order
+#define SEGMENT_VERSION 1
+#define MAX_SEGMENTS 100 // job keys are numbered "LIST_00" to "LIST_99" and used as a ring
+#define SEGMENT_NAME_LENGTH 32 // maximum file name length of SPIFFS
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;     // identifies a segment file
+    uint16_t version;   // layout version of the segment file
+    uint16_t format;    // format of the items, defined by the owner of the store
+    uint32_t head;      // number of bytes already consumed
+    uint32_t used;      // number of bytes appended
+    uint32_t consumed;  // number of items already consumed
+    uint32_t count;     // number of items appended
+} segment_header_t;
+
+typedef struct {
+    std::string path;   // e.g. "/data_2025-04-16_00.bin"
+    std::string date;   // e.g. "2025-04-16"
+    segment_header_t header;
+    std::shared_ptr<FileManager> file; // reused for every access to the segment file
+} segment_t;
+
+class SegmentStore : public RecordStore {
+public:
+    SegmentStore(fs::FS& fs, const std::string& prefix, size_t segmentSize, size_t capacity, uint16_t format, const char* jobList = JOB_LIST, bool daily = true);
+    bool check() override;
+    bool reset() override;
+    bool push(const uint8_t* buffer, size_t len, size_t items) override;
+    size_t peek(size_t offset, uint8_t* buffer, size_t len) override;
+    bool pop(size_t len, size_t items) override;
+    size_t size() override;
+    size_t count() override;
+    size_t available() override;
+    size_t tail() override;
+    void retain(bool enable);
+    bool migrate(SegmentStore& source);
+private:
+    fs::FS& fs;
+    std::string prefix; // e.g. "/data"
+    size_t segmentSize; // maximum size of a single segment in bytes
+    size_t capacity; // maximum size of all segments combined in bytes
+    uint16_t format;
+    const char* jobList; // name of the job list in the config, unique per store
+    size_t jobStart; // index of the job of the oldest segment, the job list is a ring
+    bool daily; // start a new segment every day
+    bool retainConsumed; // keep consumed segments until the capacity is reached
+    std::deque<segment_t> segments; // oldest segment first
+    SemaphoreHandle_t semaphore;
+    bool load(const std::string& path, segment_t& segment);
+    bool create(segment_t& segment);
+    bool prepare(size_t len);
+    bool drop();
+    bool writeHeader(segment_t& segment);
+    size_t unconsumed();
+    size_t jobIndex(size_t position);
+    void storeJobs(size_t previousLength);
+    void appendJob();
+    void dropJob();
+};
+
+#endif /* SEGMENT_STORE_H */
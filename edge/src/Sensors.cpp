@@ -45,7 +45,7 @@ void SensorClass::read() {
     this->sensorSwitch.off(); // disable water level sensor again
     
     // Store Sensor Values:
-    DataFile.store(this->data);
+    DataFile.store(this->data); // only queued, written by the storage task
 }
 
 /**
@@ -0,0 +1,459 @@
+#include "Storage.h"
+#include "Config.h"
+#include "FileManager.h"
+#include "LittleFS.h"
+#include "SD.h"
+#include "SPIFFS.h"
+
+#define COPY_CHUNK_SIZE 512 // bytes copied at once
+#define STAGING_HEAP_RESERVE (32 * 1024) // heap kept free while staging files in RAM
+
+// Benchmark:
+#define BENCHMARK_CHUNK_SIZE 512 // bytes per append, about one flush of the sample cache
+#define BENCHMARK_ROUNDS 50 // appends per fill level
+#define BENCHMARK_LINE "2025-04-16 12:00:00 [INFO] Benchmark log message of typical length\r\n"
+
+/**
+ * [INFO]
+ * Data file and log file live on the file system selected with STORAGE_BACKEND. SPIFFS and
+ * LittleFS share the same flash partition ("spiffs" label), so only one of them can be mounted.
+ * The backend of the last boot is kept in the config. If it differs, the files of its root
+ * directory are copied to the new backend once. Switching between SPIFFS and LittleFS formats
+ * the partition, so the files are staged on the SD card meanwhile (or in RAM without SD card).
+ */
+
+/**
+ * @brief Constructor initializes the storage, nothing is mounted before 'begin()'
+ */
+StorageClass::StorageClass() {
+    this->mounted = false;
+    this->sdMounted = false;
+}
+
+/**
+ * @brief Mounts the SD card (if present) and the storage backend. Files of the backend used by
+ * the previous boot are migrated to the current backend first. Calling this again does nothing.
+ * @return true on success, false otherwise
+ */
+bool StorageClass::begin() {
+    if(this->mounted) {
+        return true;
+    }
+
+#ifdef SD_CARD
+    // Mount SD Card:
+    this->sdMounted = mount(STORAGE_SD, false);
+    if(!this->sdMounted) {
+        log_w("Unable to mount SD card");
+    }
+#endif
+
+    // Migrate Files of Previous Backend:
+    uint8_t previous = Config.loadStorageBackend();
+    if(previous != STORAGE_BACKEND) {
+        log_i("Storage backend changed from %s to %s, migrating files", name(previous), name(STORAGE_BACKEND));
+        if(this->migrate(previous)) {
+            Config.storeStorageBackend(STORAGE_BACKEND);
+        } else {
+            log_e("Failed to migrate files from %s, retrying on next boot", name(previous));
+        }
+    }
+
+    // Mount Backend:
+    if(!mount(STORAGE_BACKEND, true)) {
+        log_e("Unable to mount %s", name(STORAGE_BACKEND));
+        return false;
+    }
+    this->mounted = true;
+    return true;
+}
+
+/**
+ * @brief Get the file system of the storage backend
+ * @return file system
+ */
+fs::FS& StorageClass::fs() {
+    return filesystem(STORAGE_BACKEND);
+}
+
+/**
+ * @brief Get the name of the storage backend
+ * @return name (e.g. "SPIFFS")
+ */
+const char* StorageClass::name() {
+    return name(STORAGE_BACKEND);
+}
+
+/**
+ * @brief Get the size of the storage backend
+ * @return number of bytes
+ */
+uint64_t StorageClass::totalBytes() {
+    return totalBytes(STORAGE_BACKEND);
+}
+
+/**
+ * @brief Get the number of bytes used on the storage backend
+ * @return number of bytes
+ */
+uint64_t StorageClass::usedBytes() {
+    return usedBytes(STORAGE_BACKEND);
+}
+
+/**
+ * @brief Check if the SD card is mounted
+ * @return true if mounted, false otherwise
+ */
+bool StorageClass::hasSD() {
+    return this->sdMounted;
+}
+
+/**
+ * @brief Measures append latency, shrink latency and free space of the storage backend at
+ * different fill levels and reports them to the serial log. The SD card is measured at its
+ * current fill level only. Build with each STORAGE_BACKEND to compare SPIFFS and LittleFS.
+ * @note Fills the file system temporarily, call before other tasks write to it
+ */
+void StorageClass::benchmark() {
+    this->benchmark(STORAGE_BACKEND);
+    if(this->sdMounted && STORAGE_BACKEND != STORAGE_SD) {
+        this->benchmark(STORAGE_SD);
+    }
+}
+
+/**
+ * @brief Get the file system of the given backend
+ * @param backend backend (e.g. STORAGE_SPIFFS)
+ * @return file system
+ */
+fs::FS& StorageClass::filesystem(uint8_t backend) {
+    switch(backend) {
+    case STORAGE_LITTLEFS:
+        return LittleFS;
+    case STORAGE_SD:
+        return SD;
+    default:
+        return SPIFFS;
+    }
+}
+
+/**
+ * @brief Get the name of the given backend
+ * @param backend backend (e.g. STORAGE_SPIFFS)
+ * @return name
+ */
+const char* StorageClass::name(uint8_t backend) {
+    switch(backend) {
+    case STORAGE_SPIFFS:
+        return "SPIFFS";
+    case STORAGE_LITTLEFS:
+        return "LittleFS";
+    case STORAGE_SD:
+        return "SD";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @brief Get the size of the given backend
+ * @param backend backend (e.g. STORAGE_SPIFFS)
+ * @return number of bytes
+ */
+uint64_t StorageClass::totalBytes(uint8_t backend) {
+    switch(backend) {
+    case STORAGE_LITTLEFS:
+        return LittleFS.totalBytes();
+    case STORAGE_SD:
+        return SD.totalBytes();
+    default:
+        return SPIFFS.totalBytes();
+    }
+}
+
+/**
+ * @brief Get the number of bytes used on the given backend
+ * @param backend backend (e.g. STORAGE_SPIFFS)
+ * @return number of bytes
+ */
+uint64_t StorageClass::usedBytes(uint8_t backend) {
+    switch(backend) {
+    case STORAGE_LITTLEFS:
+        return LittleFS.usedBytes();
+    case STORAGE_SD:
+        return SD.usedBytes();
+    default:
+        return SPIFFS.usedBytes();
+    }
+}
+
+/**
+ * @brief Mounts the given backend
+ * @param backend backend (e.g. STORAGE_SPIFFS)
+ * @param format format the flash partition if it does not hold this file system (not for SD)
+ * @return true on success, false otherwise
+ */
+bool StorageClass::mount(uint8_t backend, bool format) {
+    switch(backend) {
+    case STORAGE_SPIFFS:
+        return SPIFFS.begin(format);
+    case STORAGE_LITTLEFS:
+        return LittleFS.begin(format);
+    case STORAGE_SD:
+        SPI.begin(SPI_CLK, SPI_MISO, SPI_MOSI, SPI_CD);
+        return SD.begin(SPI_CD);
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Unmounts the given backend
+ * @param backend backend (e.g. STORAGE_SPIFFS)
+ */
+void StorageClass::unmount(uint8_t backend) {
+    switch(backend) {
+    case STORAGE_SPIFFS:
+        SPIFFS.end();
+        break;
+    case STORAGE_LITTLEFS:
+        LittleFS.end();
+        break;
+    case STORAGE_SD:
+        SD.end();
+        break;
+    }
+}
+
+/**
+ * @brief Copies the files in the root directory of the previous backend to the current backend.
+ * Files on different media are copied directly and kept on the previous backend. Files on the
+ * shared flash partition are staged on the SD card or in RAM, since the partition is formatted.
+ * Files that do not fit into RAM are lost in that case. Files staged on the SD card are kept until
+ * they are restored, so a retry restores them if the partition is formatted already.
+ * @param previous backend used by the previous boot
+ * @return true on success, false to retry on the next boot
+ */
+bool StorageClass::migrate(uint8_t previous) {
+    // Mount Previous Backend:
+    if(previous == STORAGE_SD ? !this->sdMounted : !mount(previous, false)) {
+        if(previous != STORAGE_SD && STORAGE_BACKEND != STORAGE_SD && this->sdMounted && SD.exists(STORAGE_STAGING_DIR)) {
+            log_i("Partition formatted already, restoring files staged on SD card");
+            return mount(STORAGE_BACKEND, true) && this->restore(filesystem(STORAGE_BACKEND));
+        }
+        log_w("No files to migrate on %s", name(previous));
+        return previous != STORAGE_SD; // retry once the SD card is inserted again
+    }
+    fs::FS& from = filesystem(previous);
+    fs::FS& to = filesystem(STORAGE_BACKEND);
+    std::vector<std::string> paths = list(from);
+
+    // Copy Files Between Different Media:
+    if(previous == STORAGE_SD || STORAGE_BACKEND == STORAGE_SD) {
+        if(STORAGE_BACKEND == STORAGE_SD ? !this->sdMounted : !mount(STORAGE_BACKEND, true)) {
+            log_e("Unable to mount %s", name(STORAGE_BACKEND));
+            return false;
+        }
+        for(const std::string& path : paths) {
+            if(!copy(from, path, to, path)) {
+                return false;
+            }
+        }
+        log_i("Copied %u files from %s to %s", paths.size(), name(previous), name(STORAGE_BACKEND));
+        return true;
+    }
+
+    // Stage Files:
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> staged; // files kept in RAM
+    bool sdStaging = this->sdMounted && (SD.exists(STORAGE_STAGING_DIR) || SD.mkdir(STORAGE_STAGING_DIR));
+    for(const std::string& path : paths) {
+        if(sdStaging) {
+            if(!copy(from, path, SD, STORAGE_STAGING_DIR + path)) {
+                return false; // partition not formatted yet, nothing lost
+            }
+            continue;
+        }
+        File file = from.open(path.c_str(), FILE_READ);
+        size_t size = file.size();
+        if(size + STAGING_HEAP_RESERVE > ESP.getMaxAllocHeap()) {
+            log_e("Not enough heap to keep %s [%u bytes] while formatting, file is lost", path.c_str(), size);
+            file.close();
+            continue;
+        }
+        staged.emplace_back(path, std::vector<uint8_t>(size));
+        size_t bytes = file.read(staged.back().second.data(), size);
+        file.close();
+        if(bytes != size) {
+            log_e("Could not read %s [%u/%u bytes]", path.c_str(), bytes, size);
+            return false;
+        }
+    }
+
+    // Format Partition:
+    unmount(previous);
+    if(!mount(STORAGE_BACKEND, true)) {
+        log_e("Unable to format %s", name(STORAGE_BACKEND));
+        return false;
+    }
+
+    // Restore Files:
+    bool complete = !sdStaging || this->restore(to);
+    for(const auto& file : staged) {
+        FileManager restored(to, file.first);
+        restored.write(file.second.data(), file.second.size());
+    }
+    if(!complete) {
+        return false; // retry restores the files left on the SD card
+    }
+    log_i("Migrated %u files from %s to %s", paths.size(), name(previous), name(STORAGE_BACKEND));
+    return true; // partition is formatted, a retry has nothing left to migrate
+}
+
+/**
+ * @brief Copies the files staged on the SD card to the given file system. A staged file is only
+ * removed once it is copied, so a retry copies the remaining files.
+ * @param to file system to restore the files to
+ * @return true if all staged files were restored, false otherwise
+ */
+bool StorageClass::restore(fs::FS& to) {
+    bool restored = true;
+    for(const std::string& path : list(SD, STORAGE_STAGING_DIR)) {
+        if(!copy(SD, STORAGE_STAGING_DIR + path, to, path)) {
+            log_e("Failed to restore %s, keeping it on SD card", path.c_str());
+            restored = false;
+            continue;
+        }
+        SD.remove((STORAGE_STAGING_DIR + path).c_str());
+    }
+    return restored;
+}
+
+/**
+ * @brief Lists the files in a directory of the given file system
+ * @param fs file system to list
+ * @param dir directory to list
+ * @return paths of the files relative to the directory (e.g. "/log.txt")
+ */
+std::vector<std::string> StorageClass::list(fs::FS& fs, const char* dir) {
+    std::vector<std::string> paths;
+    File root = fs.open(dir);
+    if(!root) {
+        return paths;
+    }
+    File file = root.openNextFile();
+    while(file) {
+        if(!file.isDirectory()) {
+            paths.push_back(std::string("/") + file.name());
+        }
+        file = root.openNextFile(); // iterate next
+    }
+    root.close();
+    return paths;
+}
+
+/**
+ * @brief Copies a file, possibly to another file system
+ * @param from file system to copy from
+ * @param fromPath path of the file to copy
+ * @param to file system to copy to
+ * @param toPath path of the copy, overwritten if it exists
+ * @return true on success, false otherwise
+ */
+bool StorageClass::copy(fs::FS& from, const std::string& fromPath, fs::FS& to, const std::string& toPath) {
+    File source = from.open(fromPath.c_str(), FILE_READ);
+    File target = to.open(toPath.c_str(), FILE_WRITE);
+    if(!source || !target) {
+        log_e("Could not open %s or %s", fromPath.c_str(), toPath.c_str());
+        return false;
+    }
+    uint8_t buffer[COPY_CHUNK_SIZE];
+    size_t copied = 0;
+    size_t size = source.size();
+    while(copied < size) {
+        size_t len = source.read(buffer, sizeof(buffer));
+        if(len == 0 || target.write(buffer, len) != len) {
+            break;
+        }
+        copied += len;
+    }
+    source.close();
+    target.close();
+    if(copied != size) {
+        log_e("Failed to copy %s to %s [%u/%u bytes]", fromPath.c_str(), toPath.c_str(), copied, size);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Measures the given backend, see 'benchmark()'. Appends are measured like a segment
+ * store push (positional write and header update), log appends and shrinking like the log file.
+ * @param backend backend to measure (mounted)
+ */
+void StorageClass::benchmark(uint8_t backend) {
+    fs::FS& fs = filesystem(backend);
+    FileManager data(fs, "/bench_data.bin");
+    FileManager text(fs, "/bench_log.txt");
+    const char* fillPath = "/bench_fill.bin";
+    std::vector<uint8_t> chunk(BENCHMARK_CHUNK_SIZE, 0xA5);
+    std::string line = BENCHMARK_LINE;
+
+    const uint8_t levels[] = {0, 25, 50, 75, 90}; // fill levels in percent
+    for(uint8_t level : levels) {
+        // Fill File System:
+        uint64_t total = totalBytes(backend);
+        if(backend == STORAGE_SD && level > 0) {
+            break; // filling a card takes too long
+        }
+        File fill = fs.open(fillPath, FILE_APPEND);
+        while(fill && usedBytes(backend) * 100 < total * level) {
+            if(fill.write(chunk.data(), chunk.size()) != chunk.size()) {
+                break; // full
+            }
+            fill.flush();
+        }
+        fill.close();
+        if(usedBytes(backend) * 100 < total * level) {
+            log_w("Benchmark %s stopped, cannot fill to %u%%", name(backend), level);
+            break;
+        }
+
+        // Measure Appends:
+        uint64_t freeBefore = total - usedBytes(backend);
+        data.write(chunk.data(), sizeof(uint32_t)); // header
+        unsigned long appendSum = 0, appendMax = 0;
+        for(size_t i = 0; i < BENCHMARK_ROUNDS; i++) {
+            unsigned long start = micros();
+            data.write(sizeof(uint32_t) + i * chunk.size(), chunk.data(), chunk.size());
+            data.write(0, chunk.data(), sizeof(uint32_t));
+            unsigned long duration = micros() - start;
+            appendSum += duration;
+            appendMax = std::max(appendMax, duration);
+        }
+        uint64_t freeAfter = total - usedBytes(backend);
+
+        // Measure Log Appends and Shrinking:
+        text.reset();
+        unsigned long logSum = 0;
+        for(size_t i = 0; i < BENCHMARK_ROUNDS; i++) {
+            unsigned long start = micros();
+            text.append(line);
+            logSum += micros() - start;
+        }
+        unsigned long start = micros();
+        text.shrink(BENCHMARK_ROUNDS / 2);
+        unsigned long shrinkDuration = micros() - start;
+
+        // Report:
+        Serial.printf("Benchmark %s at %u%%: append avg %lu us max %lu us, log append avg %lu us, shrink %lu us, free %llu bytes (%llu bytes taken by %u bytes appended)\r\n", // printed at any debug level
+            name(backend), level, appendSum / BENCHMARK_ROUNDS, appendMax, logSum / BENCHMARK_ROUNDS, shrinkDuration,
+            (unsigned long long)freeAfter, (unsigned long long)(freeBefore - std::min(freeBefore, freeAfter)), (unsigned)(BENCHMARK_ROUNDS * chunk.size()));
+        data.remove();
+    }
+
+    // Clean Up:
+    text.remove();
+    fs.remove(fillPath);
+}
+
+StorageClass Storage = StorageClass();
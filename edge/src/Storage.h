@@ -0,0 +1,55 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <string>
+#include <vector>
+#include "FS.h"
+
+// Backends:
+#define STORAGE_SPIFFS 0
+#define STORAGE_LITTLEFS 1
+#define STORAGE_SD 2
+
+// Storage Backend:
+#ifndef STORAGE_BACKEND
+#define STORAGE_BACKEND STORAGE_SPIFFS // file system of data, logs and web files (set "board_build.filesystem" to match)
+#endif
+#define STORAGE_STAGING_DIR "/migrate" // directory on the SD card holding files while the flash partition is formatted
+// #define STORAGE_BENCHMARK // measure the file systems at boot (uncomment to enable, fills the file systems temporarily)
+
+// SD Card:
+#define SD_CARD
+#define SPI_CD 5
+#define SPI_MOSI 23
+#define SPI_CLK 18
+#define SPI_MISO 19
+
+class StorageClass {
+public:
+    StorageClass();
+    bool begin();
+    fs::FS& fs();
+    const char* name();
+    uint64_t totalBytes();
+    uint64_t usedBytes();
+    bool hasSD();
+    void benchmark();
+private:
+    bool mounted; // backend mounted and migrated
+    bool sdMounted;
+    static fs::FS& filesystem(uint8_t backend);
+    static const char* name(uint8_t backend);
+    static uint64_t totalBytes(uint8_t backend);
+    static uint64_t usedBytes(uint8_t backend);
+    static bool mount(uint8_t backend, bool format);
+    static void unmount(uint8_t backend);
+    bool migrate(uint8_t previous);
+    bool restore(fs::FS& to);
+    static std::vector<std::string> list(fs::FS& fs, const char* dir = "/");
+    static bool copy(fs::FS& from, const std::string& fromPath, fs::FS& to, const std::string& toPath);
+    void benchmark(uint8_t backend);
+};
+
+extern StorageClass Storage;
+
+#endif /* STORAGE_H */
@@ -0,0 +1,212 @@
+#include "TieredStore.h"
+#include "CriticalRuntime.h"
+
+/**
+ * [INFO]
+ * Items are pushed to the hot tier only. Once a segment of the hot tier is sealed (a newer
+ * segment was started), 'maintain()' moves it to the end of the cold tier. The items of both
+ * tiers form one queue: the unconsumed items of the cold tier are older than those of the hot
+ * tier, so they are read and consumed first. Consumed segments are retained by both tiers, so
+ * the cold tier keeps the history of all items until its capacity is reached. Without a cold
+ * tier (e.g. no SD card inserted) the hot tier works on its own and drops consumed segments.
+ */
+
+/**
+ * @brief Constructor initializes a store of two tiers of segment stores
+ * @param hot store receiving all items, e.g. on the internal flash
+ * @param cold store receiving the sealed segments of the hot tier, e.g. on a removable SD card
+ */
+TieredStore::TieredStore(SegmentStore& hot, SegmentStore& cold) : hot(hot), cold(cold) {
+    this->coldAvailable = false;
+    this->semaphore = xSemaphoreCreateMutex();
+    if(semaphore == NULL) {
+        log_e("Not enough heap to use tiered store semaphore.");
+    }
+}
+
+/**
+ * @brief Loads the segments of both tiers. If the cold tier is not available, only the hot tier
+ * is used until the next check.
+ * @return true on success, false otherwise
+ */
+bool TieredStore::check() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Check Hot Tier:
+    if(!this->hot.check()) {
+        return false;
+    }
+
+    // Check Cold Tier:
+    this->coldAvailable = this->cold.check();
+    if(!this->coldAvailable) {
+        log_w("Cold tier not available, keeping items in hot tier only");
+    }
+    this->cold.retain(true);
+    this->hot.retain(this->coldAvailable); // keep consumed segments until they were migrated
+    return true;
+}
+
+/**
+ * @brief Deletes all items of the hot tier. Items of the cold tier are only consumed, so the
+ * history is kept.
+ * @return true on success, false otherwise
+ */
+bool TieredStore::reset() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    if(this->coldAvailable && !this->cold.pop(this->cold.size(), this->cold.count())) {
+        return false;
+    }
+    return this->hot.reset();
+}
+
+/**
+ * @brief Appends the given bytes to the hot tier
+ * @param buffer bytes to append
+ * @param len number of bytes in buffer
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool TieredStore::push(const uint8_t* buffer, size_t len, size_t items) {
+    return this->hot.push(buffer, len, items); // no need to lock, migrating only touches sealed segments
+}
+
+/**
+ * @brief Reads bytes without consuming them, starting 'offset' bytes after the oldest unconsumed
+ * byte. Reading starts in the cold tier and continues in the hot tier.
+ * @param offset number of bytes to skip
+ * @param buffer buffer to be filled, needs to hold at least 'len' bytes
+ * @param len maximum number of bytes to read
+ * @return number of bytes actually read (zero in case of error)
+ */
+size_t TieredStore::peek(size_t offset, uint8_t* buffer, size_t len) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+
+    // Read From Cold Tier:
+    size_t bytes = 0;
+    size_t coldSize = this->coldAvailable ? this->cold.size() : 0;
+    if(offset < coldSize) {
+        size_t chunk = std::min(len, coldSize - offset);
+        bytes = this->cold.peek(offset, buffer, chunk);
+        if(bytes < chunk) {
+            return bytes; // read error
+        }
+        offset = 0;
+    } else {
+        offset -= coldSize;
+    }
+
+    // Read From Hot Tier:
+    if(bytes < len) {
+        bytes += this->hot.peek(offset, buffer + bytes, len - bytes);
+    }
+    return bytes;
+}
+
+/**
+ * @brief Consumes bytes from the cold tier first and from the hot tier afterwards
+ * @param len number of bytes to consume
+ * @param items number of items the bytes represent
+ * @return true on success, false otherwise
+ */
+bool TieredStore::pop(size_t len, size_t items) {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+
+    // Consume From Cold Tier:
+    size_t coldSize = this->coldAvailable ? this->cold.size() : 0;
+    if(coldSize > 0) {
+        size_t bytes = std::min(len, coldSize);
+        size_t coldCount = this->cold.count();
+        size_t num = bytes == coldSize ? coldCount : std::min(items, coldCount);
+        if(!this->cold.pop(bytes, num)) {
+            return false;
+        }
+        len -= bytes;
+        items -= std::min(items, num);
+    }
+
+    // Consume From Hot Tier:
+    return len == 0 || this->hot.pop(len, items);
+}
+
+/**
+ * @brief Get the number of unconsumed bytes in both tiers. Holds the semaphore so a segment being
+ * migrated is counted exactly once.
+ * @return number of bytes
+ */
+size_t TieredStore::size() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return (this->coldAvailable ? this->cold.size() : 0) + this->hot.size();
+}
+
+/**
+ * @brief Get the number of unconsumed items in both tiers
+ * @return number of items
+ */
+size_t TieredStore::count() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return (this->coldAvailable ? this->cold.count() : 0) + this->hot.count();
+}
+
+/**
+ * @brief Get the number of bytes that can still be stored before the oldest items get deleted
+ * @return number of bytes
+ */
+size_t TieredStore::available() {
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return 0;
+    }
+    return this->coldAvailable ? this->cold.available() : this->hot.available();
+}
+
+/**
+ * @brief Get the file offset the next pushed byte is written at in the hot tier
+ * @return byte offset in the newest segment file of the hot tier
+ */
+size_t TieredStore::tail() {
+    return this->hot.tail();
+}
+
+/**
+ * @brief Migrates the sealed segments of the hot tier to the cold tier
+ * @return true on success, false otherwise
+ */
+bool TieredStore::maintain() {
+    if(!this->coldAvailable) {
+        return true;
+    }
+
+    CriticalRuntime run(this->semaphore);
+    if(!run.isValid()) {
+        log_e("Could not take semaphore");
+        return false;
+    }
+    return this->cold.migrate(this->hot);
+}
@@ -0,0 +1,27 @@
+#ifndef TIERED_STORE_H
+#define TIERED_STORE_H
+
+#include <atomic>
+#include "SegmentStore.h"
+
+class TieredStore : public RecordStore {
+public:
+    TieredStore(SegmentStore& hot, SegmentStore& cold);
+    bool check() override;
+    bool reset() override;
+    bool push(const uint8_t* buffer, size_t len, size_t items) override;
+    size_t peek(size_t offset, uint8_t* buffer, size_t len) override;
+    bool pop(size_t len, size_t items) override;
+    size_t size() override;
+    size_t count() override;
+    size_t available() override;
+    size_t tail() override;
+    bool maintain() override;
+private:
+    SegmentStore& hot; // small and fast, receives all items
+    SegmentStore& cold; // large, holds older items and the history of consumed items
+    std::atomic<bool> coldAvailable; // read by 'maintain()' before the semaphore is taken
+    SemaphoreHandle_t semaphore;
+};
+
+#endif /* TIERED_STORE_H */
@@ -0,0 +1,152 @@
+#include "TimeIndex.h"
+
+#define ENTRY_SIZE sizeof(time_index_entry_t)
+
+/**
+ * [INFO]
+ * The time index is a sparse index of a file that is only appended to at the end and consumed
+ * from the front. Every append adds one entry, i.e. one entry per cache flush (about every two
+ * minutes) instead of one per record. Positions are counted in bytes ever appended, so they stay
+ * valid while the front of the file is consumed: the offset of an entry within the file is its
+ * position minus the position of the front (end minus file size). Entries of consumed bytes are
+ * dropped with the next append. The timestamps of the appends increase, so the entry of a time is
+ * found by a binary search.
+ */
+
+/**
+ * Constructor initalizes the index on top of the given store
+ * @param store store holding the entries on disk (fixed-size records)
+ */
+TimeIndex::TimeIndex(RecordStore& store) : store(store), end(0) {}
+
+/**
+ * @brief Checks the store and restores the position of the end of the indexed file
+ * @param fileSize current size of the indexed file in bytes
+ * @return true on success, false otherwise
+ */
+bool TimeIndex::begin(size_t fileSize) {
+    // Initialize Store:
+    if(!this->store.check()) {
+        log_w("Time index broken or not found");
+        if(!this->reset()) {
+            return false;
+        }
+    }
+
+    // Restore End of Indexed File:
+    size_t num = this->store.size() / ENTRY_SIZE;
+    time_index_entry_t entry;
+    if(num == 0 || !this->read(num - 1, entry) || entry.length > fileSize) {
+        if(num > 0) {
+            log_w("Time index does not match data file, resetting");
+        }
+        if(!this->reset()) {
+            return false;
+        }
+        this->end.store(fileSize, std::memory_order_release);
+        return true;
+    }
+    this->end.store(entry.position + entry.length, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Adds an entry for bytes appended to the indexed file and drops the entries of bytes
+ * consumed meanwhile. The oldest entries are dropped as well if the store is full.
+ * @param timestamp time of the first record appended, seconds since epoch
+ * @param len number of bytes appended
+ * @param fileSize size of the indexed file after the append
+ * @return true on success, false otherwise
+ * @note Call right after each successful append, from the task appending to the indexed file and
+ * within the same lock (see 'lookup()')
+ */
+bool TimeIndex::append(uint32_t timestamp, size_t len, size_t fileSize) {
+    uint32_t position = this->end.load(std::memory_order_relaxed);
+    this->end.store(position + len, std::memory_order_release);
+    uint32_t head = position + len - fileSize;
+
+    // Drop Entries of Consumed Bytes:
+    time_index_entry_t entry;
+    size_t stale = 0;
+    size_t num = this->store.size() / ENTRY_SIZE;
+    while(stale < num && this->read(stale, entry) && (int32_t)(head - (entry.position + entry.length)) >= 0) {
+        stale++;
+    }
+    if(stale == 0 && this->store.available() < ENTRY_SIZE && num > 0) {
+        stale = 1; // store full, drop the oldest entry
+    }
+    if(stale > 0 && !this->store.pop(stale * ENTRY_SIZE, stale)) {
+        log_e("Failed to drop %u time index entries", stale);
+        return false;
+    }
+
+    // Add Entry:
+    entry = {timestamp, position, (uint32_t)len};
+    if(!this->store.push((const uint8_t*)&entry, ENTRY_SIZE, 1)) {
+        log_e("Failed to append time index entry");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the offset in the indexed file to start reading at to find the records taken at
+ * or after the given time, i.e. the beginning of the newest append started before that time
+ * @param timestamp seconds since epoch
+ * @param fileSize current size of the indexed file in bytes
+ * @return offset within the indexed file (0 if the time is not indexed)
+ * @note Call with appends to the indexed file serialized (e.g. holding the semaphore of the data
+ * file), so 'end' and 'fileSize' belong to the same append and no entry is dropped meanwhile
+ */
+size_t TimeIndex::lookup(uint32_t timestamp, size_t fileSize) {
+    uint32_t head = this->end.load(std::memory_order_acquire) - fileSize;
+
+    // Binary Search Newest Entry Not After Time:
+    size_t low = 0;
+    size_t high = this->store.size() / ENTRY_SIZE;
+    time_index_entry_t entry;
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+        if(!this->read(mid, entry)) {
+            return 0;
+        }
+        if(entry.timestamp <= timestamp) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if(low == 0 || !this->read(low - 1, entry)) {
+        return 0; // time before first entry, read everything
+    }
+
+    // Convert Position to Offset:
+    int32_t offset = (int32_t)(entry.position - head);
+    if(offset < 0 || (size_t)offset >= fileSize) {
+        return 0; // bytes consumed already or index out of date
+    }
+    return offset;
+}
+
+/**
+ * @brief Drops all entries
+ * @return true on success, false otherwise
+ */
+bool TimeIndex::reset() {
+    if(!this->store.reset()) {
+        log_e("Could not reset time index");
+        return false;
+    }
+    this->end.store(0, std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Reads the entry at the given index, the oldest entry has index 0
+ * @param index index of the entry
+ * @param entry entry to be filled
+ * @return true on success, false otherwise
+ */
+bool TimeIndex::read(size_t index, time_index_entry_t& entry) {
+    return this->store.peek(index * ENTRY_SIZE, (uint8_t*)&entry, ENTRY_SIZE) == ENTRY_SIZE;
+}
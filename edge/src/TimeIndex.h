@@ -0,0 +1,29 @@
+#ifndef TIME_INDEX_H
+#define TIME_INDEX_H
+
+#include <atomic>
+#include "Arduino.h"
+#include "RecordStore.h"
+
+#define TIME_INDEX_FORMAT 1 // format of the index entries on disk
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp; // time of the first record appended, seconds since epoch
+    uint32_t position;  // number of bytes appended to the indexed file before
+    uint32_t length;    // number of bytes appended at once
+} time_index_entry_t;
+
+class TimeIndex {
+public:
+    TimeIndex(RecordStore& store);
+    bool begin(size_t fileSize);
+    bool append(uint32_t timestamp, size_t len, size_t fileSize);
+    size_t lookup(uint32_t timestamp, size_t fileSize);
+    bool reset();
+private:
+    RecordStore& store;
+    std::atomic<uint32_t> end; // number of bytes ever appended to the indexed file (wraps around)
+    bool read(size_t index, time_index_entry_t& entry);
+};
+
+#endif /* TIME_INDEX_H */
@@ -152,4 +152,27 @@ std::string TimeManager::toTimeString(tm timeinfo) {
     return buffer;
 }
 
+/**
+ * @brief Converts the given (local) timeinfo to seconds since epoch
+ * @param timeinfo time struct to convert
+ * @return seconds since 1970-01-01T00:00:00 UTC, -1 on failure
+ */
+time_t TimeManager::toEpoch(tm timeinfo) {
+    timeinfo.tm_isdst = -1; // let mktime() decide on daylight saving time
+    return mktime(&timeinfo);
+}
+
+/**
+ * @brief Converts the given seconds since epoch to a (local) timeinfo
+ * @param epoch seconds since 1970-01-01T00:00:00 UTC
+ * @return time struct, default time (1970-01-01T00:00:00) on failure
+ */
+tm TimeManager::fromEpoch(time_t epoch) {
+    struct tm timeinfo;
+    if(localtime_r(&epoch, &timeinfo) == NULL) {
+        return getDefault();
+    }
+    return timeinfo;
+}
+
 TimeManager Time = TimeManager();
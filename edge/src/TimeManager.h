@@ -28,6 +28,8 @@ public:
     static std::string toString(tm timeinfo);
     static std::string toDateString(tm timeinfo);
     static std::string toTimeString(tm timeinfo);
+    static time_t toEpoch(tm timeinfo);
+    static tm fromEpoch(time_t epoch);
 };
 
 extern TimeManager Time;
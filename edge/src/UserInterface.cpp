@@ -1,5 +1,4 @@
 #include "UserInterface.h"
-#include <SPIFFS.h>
 #include <Update.h>
 #include "SD.h"
 #include "Config.h"
@@ -8,6 +7,7 @@
 #include "LogFile.h"
 #include "Pump.h"
 #include "Sensors.h"
+#include "Storage.h"
 #include "TimeManager.h"
 #include "WiFiManager.h"
 
@@ -41,6 +41,13 @@ String wdayToString(unsigned char wday) {
     return ret;
 }
 
+String modeToString(log_mode_t mode) {
+    if (mode == DEBUG) return "Debug";
+    else if (mode == INFO) return "Info";
+    else if (mode == WARNING) return "Warning";
+    else return "Error";
+}
+
 String readableSize(const size_t bytes) {
     if (bytes < 1024) return String(bytes) + " B";
     else if (bytes < (1024 * 1024)) return String(bytes / 1024.0) + " KB";
@@ -84,6 +91,12 @@ String processor(const String& var) {
     if (var == "THRESHOLD") {
         return String(Config.loadRainThresholdLevel());
     }
+    if (var == "LOG_FILE_LEVEL") {
+        return modeToString(LogFile.fileLevel());
+    }
+    if (var == "LOG_SERIAL_LEVEL") {
+        return modeToString(LogFile.serialLevel());
+    }
     if (var == "MAIL_ADDRESS") {
         return String("not used");
     }
@@ -105,11 +118,14 @@ String processor(const String& var) {
     if(var == "API_PASSWORD") {
         return String(Config.loadAPIPassword().c_str());
     }
-    if (var == "TOTAL_SPIFFS") {
-        return readableSize(SPIFFS.totalBytes());
+    if (var == "STORAGE_NAME") {
+        return Storage.name();
+    }
+    if (var == "TOTAL_STORAGE") {
+        return readableSize(Storage.totalBytes());
     }
-    if (var == "USED_SPIFFS") {
-        return readableSize(SPIFFS.usedBytes());
+    if (var == "USED_STORAGE") {
+        return readableSize(Storage.usedBytes());
     }
     if (var == "TOTAL_SD") {
         return readableSize(SD.totalBytes());
@@ -129,19 +145,23 @@ String processor(const String& var) {
 //===============================================================================================
 
 void _home(AsyncWebServerRequest *req) {
-    req->send(SPIFFS, "/index.html", String(), false, processor);
+    req->send(Storage.fs(), "/index.html", String(), false, processor);
 }
 
 void _favicon(AsyncWebServerRequest *req) {
-    req->send(SPIFFS, "/favicon.ico", "image/*", true); //image/x-icon
+    req->send(Storage.fs(), "/favicon.ico", "image/*", true); //image/x-icon
 }
 
 void _filesystem(AsyncWebServerRequest *req) {
-    req->send(SPIFFS, "/filesystem.html", String(), false, processor);
+    req->send(Storage.fs(), "/filesystem.html", String(), false, processor);
+}
+
+void _plot(AsyncWebServerRequest *req) {
+    req->send(Storage.fs(), "/plot.html", String(), false, processor);
 }
 
 void _reboot(AsyncWebServerRequest *req) {
-    req->send(SPIFFS, "/reboot.html", String(), false, processor);
+    req->send(Storage.fs(), "/reboot.html", String(), false, processor);
 }
 
 void fileUpload(AsyncWebServerRequest *req, String filename, size_t index, uint8_t *data, size_t len, bool final) {
@@ -196,6 +216,64 @@ void _api_status(AsyncWebServerRequest *req) {
     req->send(200, "text/plain", String(timestamp.c_str()));
 }
 
+void _api_wear(AsyncWebServerRequest *req) {
+    // Collect Counters:
+    JsonDocument doc = JsonDocument();
+    if(!GatewayClass::wearToJson(doc.to<JsonObject>())) {
+        req->send(500, "text/plain", "Could not read flash write counters");
+        return;
+    }
+
+    // Set Payload:
+    std::string payload;
+    serializeJsonPretty(doc, payload);
+    req->send(200, "application/json", payload.c_str());
+}
+
+void _api_data(AsyncWebServerRequest *req) {
+    // Check Parameters:
+    if(!req->hasParam("start", false, false) || !req->hasParam("stop", false, false)) {
+        log_d("missing start or stop");
+        req->send(400, "text/plain", "missing start or stop");
+        return;
+    }
+    uint32_t start = req->getParam("start", false, false)->value().toInt(); // seconds since epoch
+    uint32_t stop = req->getParam("stop", false, false)->value().toInt();
+
+    /* Example CSV:
+    TIME,FLOW,PRESSURE,LEVEL
+    2025-04-16T12:00:00,0,512,1024
+    2025-04-16T12:00:02,3,508,1020
+    ...
+    */
+
+    // Stream Records Chunk by Chunk:
+    std::shared_ptr<data_query_t> query = std::make_shared<data_query_t>(); // position reached, shared by the chunks
+    query->start = start;
+    query->stop = stop;
+    AsyncWebServerResponse* response = req->beginChunkedResponse("text/csv", [query](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        size_t len = 0;
+        if(index == 0) {
+            len = snprintf((char*)buffer, maxLen, "TIME,FLOW,PRESSURE,LEVEL\r\n");
+        }
+        bool called = DataFile.query(*query, [buffer, maxLen, &len](const sensor_data_t& data) {
+            char line[48];
+            int bytes = snprintf(line, sizeof(line), "%s,%d,%d,%d\r\n", TimeManager::toString(data.timestamp).c_str(), data.flow, data.pressure, data.level);
+            if(bytes <= 0 || len + bytes > maxLen) {
+                return false; // chunk full, continue at this record with the next chunk
+            }
+            memcpy(buffer + len, line, bytes);
+            len += bytes;
+            return true;
+        }, 0);
+        if(!called) {
+            return RESPONSE_TRY_AGAIN; // records are appended or stripped, do not block the web server
+        }
+        return len; // zero ends the response
+    });
+    req->send(response);
+}
+
 void _api_interval(AsyncWebServerRequest *req) {
     struct tm start;
     struct tm stop;
@@ -266,6 +344,27 @@ void _api_threshold(AsyncWebServerRequest *req) {
     }
 }
 
+void _api_loglevel(AsyncWebServerRequest *req) {
+    // Check Parameters:
+    if(!req->hasParam("file_level", true) || !req->hasParam("serial_level", true)) {
+        req->send(400, "text/plain", "missing file_level or serial_level");
+        return;
+    }
+    int fileLevel = req->getParam("file_level", true, false)->value().toInt();
+    int serialLevel = req->getParam("serial_level", true, false)->value().toInt();
+    if(fileLevel < INFO || fileLevel > DEBUG || serialLevel < INFO || serialLevel > DEBUG) {
+        req->send(400, "text/plain", "invalid log level");
+        return;
+    }
+
+    // Apply and Store Levels:
+    LogFile.setLevels((log_mode_t)fileLevel, (log_mode_t)serialLevel);
+    Config.storeLogFileLevel((uint8_t)fileLevel);
+    Config.storeLogSerialLevel((uint8_t)serialLevel);
+    LogFile.log(INFO, "Updated log levels.");
+    req->redirect("/"); // redirect to home
+}
+
 void _api_gateway(AsyncWebServerRequest *req) {
     // Check Address Parameter:
     String address;
@@ -364,18 +463,18 @@ void _api_listfiles(AsyncWebServerRequest *req) {
     }
     */
     
-    // Scan SPIFFS:
-    root = SPIFFS.open("/");
+    // Scan Storage Backend:
+    root = Storage.fs().open("/");
     if(!root) {
-        log_e("Failed to open SPIFFS root");
-        req->send(502, "text/plain", "Failed to open SPIFFS root");
+        log_e("Failed to open %s root", Storage.name());
+        req->send(502, "text/plain", "Failed to open storage root");
     }
 
     //JsonArray spiffs = doc["spiffs"].to<JsonArray>();
     foundfile = root.openNextFile();
     while(foundfile) {
         JsonObject file = files.createNestedObject();
-        file["system"] = "SPIFFS";
+        file["system"] = Storage.name();
         file["name"] = (char*)foundfile.name(); // cast to "char*" instead of "const char*" to initiate deep copy
         file["size"] = readableSize(foundfile.size());
         foundfile = root.openNextFile(); // iterate next
@@ -454,8 +553,8 @@ void _api_file(AsyncWebServerRequest *req) {
     };
 
     // System Action:
-    if(strcmp(filesystem, "SPIFFS") == 0) {
-        fileAction(SPIFFS);
+    if(strcmp(filesystem, Storage.name()) == 0) {
+        fileAction(Storage.fs());
     } else if(strcmp(filesystem, "SD") == 0) {
         fileAction(SD);
     } else {
@@ -486,12 +585,12 @@ void _api_upload(AsyncWebServerRequest *req) {
     log_d("Upload %s?system=%s&name=%s", url, filesystem, filepath);
 
     auto getFS = [](const char *filesystem) -> FS {
-        if(strcmp(filesystem, "SPIFFS") == 0) {
-            return SPIFFS;
+        if(strcmp(filesystem, Storage.name()) == 0) {
+            return Storage.fs();
         } else if(strcmp(filesystem, "SD") == 0) {
             return SD;
         } else {
-            return SPIFFS; // default fallback
+            return Storage.fs(); // default fallback
         }
     };
     FS fs = getFS(filesystem);
@@ -529,6 +628,7 @@ void _api_update(AsyncWebServerRequest *req) {
     // Reboot:
     req->redirect("/reboot"); // redirect to loading screen
     LogFile.log(INFO, "Device updated. Rebooting...");
+    LogFile.flush();
     delay(3000);
     ESP.restart();
 }
@@ -539,9 +639,13 @@ UserInterfaceClass::UserInterfaceClass() : led(LED_GREEN), server(UI_PORT) {
     server.on("/", HTTP_GET, _home);
     server.on("/favicon.ico", HTTP_GET, _favicon);
     server.on("/filesystem", HTTP_GET, _filesystem);
+    server.on("/plot", HTTP_GET, _plot);
     server.on("/reboot", HTTP_GET, _reboot);
     server.on("/api/status", HTTP_GET, _api_status);
+    server.on("/api/data", HTTP_GET, _api_data);
+    server.on("/api/wear", HTTP_GET, _api_wear);
     server.on("/api/interval", HTTP_POST, _api_interval);
+    server.on("/api/loglevel", HTTP_POST, _api_loglevel);
     server.on("/api/gateway", HTTP_POST, _api_gateway);
     server.on("/api/listfiles", HTTP_GET, _api_listfiles);
     server.on("/api/file", HTTP_GET | HTTP_DELETE, _api_file);
@@ -18,6 +18,7 @@
 #include "DataFile.h"
 #include "LogFile.h"
 #include "Config.h"
+#include "Storage.h"
 
 // Modules:
 #include "Button.h"
@@ -30,13 +31,18 @@
 // GLOBAL SETTINGS
 //===============================================================================================
 #define BAUD_RATE 115200
+#define SERIAL_TX_BUFFER_SIZE 1024 // bytes buffered for the serial port, so printing does not wait for the UART
 #define DEFAULT_STACK_SIZE (1024 * 4) // stack size in bytes
 #define SYNCHRONIZATION_PERIOD (1000 * 20)
 #define SERVICE_PERIOD (1000 * 60) // loop period in ms
 #define MEASUREMENT_PERIOD_SHORT 1000 // short loop period in ms (minimum of 400 ms!)
 #define MEASUREMENT_PERIOD_LONG 10000 // short loop period in ms
-#define BATCH_SIZE 60 // number of data points to be synced at once
+#define MEASUREMENT_PERIOD_MAX 60000 // longest loop period in ms (requested under storage pressure, see DATA_PRESSURE_LEVELS)
+#define BATCH_SIZE 180 // number of data points to be synced at once (multiple of DATA_FRAME_LENGTH)
+#define SKIP_BATCH_SIZE (10 * BATCH_SIZE) // number of data points summarized by rollups skipped at once
+#define ROLLUP_BATCH_SIZE 60 // number of rollups of each series to be synced at once
 #define MAX_ERROR_COUNT 5
+#define JITTER_REPORT_PERIODS 60 // number of measurement periods summarized in one jitter report
 
 //===============================================================================================
 // SCHEDULED TASKS
@@ -65,15 +71,15 @@ void buttonHandlerTask(void* parameter) {
         // Short Button Press:
         if(btnIndicator == SHORT_PRESS) {
             Button.resetIndicator(); // reset manually on short press
-            LogFile.log(INFO, "toggle user interface");
+            LogFile.log(INFO, LOG_UI_TOGGLE);
             if(!UserInterface.toggle()) {
-                LogFile.log(ERROR, "Failed to enable interface");
+                LogFile.log(ERROR, LOG_UI_TOGGLE_FAILED);
             }
         }
 
         // Long Button Press:
         if(btnIndicator == LONG_PRESS) {
-            LogFile.log(INFO, "toggle relais and operating mode");
+            LogFile.log(INFO, LOG_MODE_TOGGLE);
             Pump.toggle();
         }
     }
@@ -91,9 +97,9 @@ void buttonHandlerTask(void* parameter) {
  */
 void updaterTask(void* parameter) {
     // Fetch Firmware File:
-    LogFile.log(INFO, "Downloading firmware");
+    LogFile.log(INFO, LOG_FIRMWARE_DOWNLOADING);
     if(!Gateway.downloadFirmware()) {
-        LogFile.log(ERROR, "Failed to download firmware");
+        LogFile.log(ERROR, LOG_FIRMWARE_DOWNLOAD_FAILED);
         
         // Exit This Task:
         xTaskNotifyGive(syncLoopHandle); // notfiy sync loop task
@@ -101,7 +107,8 @@ void updaterTask(void* parameter) {
     }
 
     // Finalize Update:
-    LogFile.log(INFO, "Firmware installed. Rebooting...");
+    LogFile.log(INFO, LOG_FIRMWARE_INSTALLED);
+    LogFile.flush();
     delay(3000);
     ESP.restart();
 
@@ -125,14 +132,28 @@ void synchronizationTask(void* parameter) {
     TickType_t xLastWakeTime = xTaskGetTickCount(); // initalize tick time
     uint32_t syncLoopPeriod = SYNCHRONIZATION_PERIOD; // loop period in milliseconds
     uint32_t measurementLoopPeriod = MEASUREMENT_PERIOD_SHORT;
+    uint32_t modeMeasurementPeriod = MEASUREMENT_PERIOD_SHORT; // period for the state of the device
+    uint32_t pressureMeasurementPeriod = 0; // minimum period under storage pressure
+    upload_mode_t uploadMode = UPLOAD_RAW; // as asked for by the server with the previous response
+    auto updateMeasurementPeriod = [&measurementLoopPeriod, &modeMeasurementPeriod, &pressureMeasurementPeriod]() {
+        uint32_t newMeasurementLoopPeriod = std::max(modeMeasurementPeriod, pressureMeasurementPeriod);
+        if(newMeasurementLoopPeriod != measurementLoopPeriod) {
+            // measurement period updated, send integer notification to measurement task
+            measurementLoopPeriod = newMeasurementLoopPeriod;
+            log_d("Notify about new measurement period: %u ms", measurementLoopPeriod);
+            xTaskNotify(measurementLoopHandle, measurementLoopPeriod, eSetValueWithOverwrite);
+        }
+    };
     size_t lastFreeHeapSize = -1; // unsigned -1 = unsigned max value
+    bool dataChecked = false; // files checked for corrupted records since boot
     
     // Periodic Loop:
     uint8_t errorCount = 0; // gets reset to zero after a successful synchronization without early exit
     while (1) {
         // Initialize Loop Iteration:
         if(errorCount > MAX_ERROR_COUNT) {
-            LogFile.log(INFO, "Too many errors during synchronization. Rebooting...");
+            LogFile.log(INFO, LOG_SYNC_REBOOT);
+            LogFile.flush();
             ESP.restart();
         }
         errorCount++; // increment for each iteration
@@ -146,55 +167,98 @@ void synchronizationTask(void* parameter) {
         // Check Heap Size:
         size_t freeHeapSize = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
         if(freeHeapSize < lastFreeHeapSize) {
-            LogFile.log(DEBUG, "Largest region currently free in heap at "+std::to_string(freeHeapSize)+" bytes.");
+            LogFile.log(DEBUG, LOG_FREE_HEAP, {(int32_t)freeHeapSize});
             lastFreeHeapSize = freeHeapSize;
         }
 
+        // Relieve Storage Pressure:
+        // -> before connecting, so a backend outage coarsens the history instead of dropping samples
+        pressureMeasurementPeriod = DataFile.relieve();
+        updateMeasurementPeriod();
+
         // Connect to WiFi:
         if(!Wlan.connect()) {
-            LogFile.log(ERROR, "Cannot connect to network.");
+            LogFile.log(ERROR, LOG_NETWORK_FAILED);
             continue;
         }
 
         // Append Data to JSON:
-        std::vector<sensor_data_t> sensorData;
-        sensorData.reserve(BATCH_SIZE);
-        if(!DataFile.exportData(sensorData)) {
-            LogFile.log(ERROR, "Failed to export sensor values");
-            continue;
-        }
-        if(sensorData.size() == 0) { // check if any data got exported
-            LogFile.log(WARNING, "No data exported");
-            LogFile.log(INFO, "Resetting data file"); // reset file to fix possible broken file
-            DataFile.clear();
+        size_t dataCount = 0;
+        bool inserted = true;
+        if(uploadMode != UPLOAD_ROLLUPS) {
+            bool exported = DataFile.forEach(BATCH_SIZE, [&dataCount, &inserted](const sensor_data_t& data) {
+                inserted = Gateway.insertData(data);
+                dataCount += inserted;
+                return inserted;
+            });
+            if(!exported) {
+                LogFile.log(ERROR, LOG_EXPORT_DATA_FAILED);
+                if(!DataFile.recover()) { // drop corrupted records, keep the intact ones
+                    LogFile.log(WARNING, LOG_DATA_CORRUPTED);
+                }
+                continue;
+            }
+            if(!inserted) {
+                LogFile.log(ERROR, LOG_INSERT_DATA_FAILED);
+                continue;
+            }
+            if(dataCount == 0) { // check if any data got exported
+                LogFile.log(WARNING, LOG_NO_DATA);
+            }
+            if(dataCount == 0 && !dataChecked) { // once per boot, corruption found by exports is handled above
+                LogFile.log(INFO, LOG_DATA_CHECK); // drop corrupted records of a possibly broken file, keep the intact ones
+                if(!DataFile.recover()) {
+                    LogFile.log(WARNING, LOG_DATA_CORRUPTED);
+                }
+                dataChecked = true;
+            }
         }
-        if(!Gateway.insertData(sensorData)) {
-            LogFile.log(ERROR, "Failed to insert data");
-            continue;
+
+        // Append Rollups to JSON:
+        size_t rollupCounts[ROLLUP_SERIES] = {0, 0};
+        if(uploadMode != UPLOAD_RAW) {
+            for(size_t i = 0; i < ROLLUP_SERIES && inserted; i++) {
+                RollupSeries& rollups = DataFile.rollups((rollup_series_t)i);
+                size_t& rollupCount = rollupCounts[i];
+                rollups.forEach(ROLLUP_BATCH_SIZE, [&rollups, &rollupCount, &inserted](const rollup_record_t& rollup) {
+                    inserted = Gateway.insertRollup(rollup, rollups.resolution());
+                    rollupCount += inserted;
+                    return inserted;
+                });
+            }
+            if(!inserted) {
+                LogFile.log(ERROR, LOG_INSERT_ROLLUPS_FAILED);
+                continue;
+            }
         }
 
         // Append Logs to JSON:
         std::vector<log_message_t> logMessages;
         logMessages.reserve(20);
         if(!LogFile.exportLogs(logMessages)) {
-            LogFile.log(ERROR, "Failed to export log messages");
+            LogFile.log(ERROR, LOG_EXPORT_LOGS_FAILED);
             continue;
         }
         if(!Gateway.insertLogs(logMessages)) {
-            LogFile.log(ERROR, "Failed to insert logs");
+            LogFile.log(ERROR, LOG_INSERT_LOGS_FAILED);
             continue;
         }
 
         // Append Firmware Version to JSON:
         std::string version = Config.loadFirmwareVersion();
         if(!Gateway.insertFirmwareVersion(version)) {
-            LogFile.log(ERROR, "Failed to insert firmware version");
+            LogFile.log(ERROR, LOG_INSERT_VERSION_FAILED);
             continue;
         }
 
+        // Append Flash Write Counters to JSON:
+        if(!Gateway.insertWearStats()) {
+            LogFile.log(WARNING, LOG_INSERT_WEAR_FAILED); // telemetry only, sync anyway
+        }
+
         // Send Sync Request:
         if(!Gateway.synchronize()) {
-            LogFile.log(ERROR, "Failed to synchronize.");
+            LogFile.log(ERROR, LOG_SYNC_FAILED);
             continue;
         }
 
@@ -242,21 +306,19 @@ void synchronizationTask(void* parameter) {
                 syncLoopPeriod = newLoopPeriod;
                 log_i("Updated loop period to %u", syncLoopPeriod);
             }
+            if(sync.upload != uploadMode) {
+                uploadMode = sync.upload;
+                log_i("Updated upload mode to %u", uploadMode);
+            }
         }
 
         // Update Measurement Periods:
-        uint32_t newMeasurementLoopPeriod;
         if(sync.mode == SHORT) { // device is in hot state, switch to faster measurement intervals
-            newMeasurementLoopPeriod = MEASUREMENT_PERIOD_SHORT;
+            modeMeasurementPeriod = MEASUREMENT_PERIOD_SHORT;
         } else { // device in warm or cold state, switch to slower measurement intervals
-            newMeasurementLoopPeriod = MEASUREMENT_PERIOD_LONG;
-        }
-        if(newMeasurementLoopPeriod != measurementLoopPeriod) {
-            // measurement period updated, send integer notification to measurement task
-            measurementLoopPeriod = newMeasurementLoopPeriod;
-            log_d("Notify about new measurement period: %u ms", measurementLoopPeriod);
-            xTaskNotify(measurementLoopHandle, measurementLoopPeriod, eSetValueWithOverwrite);
+            modeMeasurementPeriod = MEASUREMENT_PERIOD_LONG;
         }
+        updateMeasurementPeriod();
 
         // Check for new Firmware Version:
         std::string available_version;
@@ -264,7 +326,7 @@ void synchronizationTask(void* parameter) {
             std::string deployed_version = Config.loadFirmwareVersion();
             log_d("Firmware versions -> Available: %s Deployed: %s",available_version.c_str(), deployed_version.c_str());
             if(deployed_version != available_version) {
-                LogFile.log(INFO, "New firmware version available");
+                LogFile.log(INFO, LOG_FIRMWARE_AVAILABLE);
                 
                 // Start Updater Task:
                 xTaskCreate(updaterTask,"updaterTask",2*DEFAULT_STACK_SIZE,NULL,0,NULL); // priority 0 (same as idle task) to prevent idle task from starvation
@@ -275,14 +337,34 @@ void synchronizationTask(void* parameter) {
         }
 
         // Shrink Data File:
-        if(!DataFile.shrink(sensorData.size())) {
-            LogFile.log(WARNING, "Failed to shrink data file");
+        if(!DataFile.shrink(dataCount)) {
+            LogFile.log(WARNING, LOG_SHRINK_DATA_FAILED);
+            continue;
+        }
+
+        // Shrink Rollups:
+        bool shrunk = true;
+        for(size_t i = 0; i < ROLLUP_SERIES; i++) {
+            shrunk &= DataFile.rollups((rollup_series_t)i).shrink(rollupCounts[i]);
+        }
+        if(!shrunk) {
+            LogFile.log(WARNING, LOG_SHRINK_ROLLUPS_FAILED);
+            continue;
+        }
+
+        // Skip Summarized Data:
+        // -> the server only needs the rollups, raw samples are kept in the history on the SD card (if any)
+        // -> only once the server confirmed it stored the rollups sent, otherwise the samples would be lost
+        size_t storedRollups = 0;
+        bool confirmed = Gateway.getStoredRollups(storedRollups) && storedRollups >= rollupCounts[ROLLUP_MINUTE] + rollupCounts[ROLLUP_HOUR];
+        if(uploadMode == UPLOAD_ROLLUPS && confirmed && !DataFile.skip(DataFile.rollups(ROLLUP_MINUTE).covered(), SKIP_BATCH_SIZE)) {
+            LogFile.log(WARNING, LOG_SKIP_DATA_FAILED);
             continue;
         }
 
         // Shrink Log File:
         if(!LogFile.shrink(logMessages.size())) {
-            LogFile.log(WARNING, "Failed to shrink log file");
+            LogFile.log(WARNING, LOG_SHRINK_LOGS_FAILED);
             continue;
         }
 
@@ -315,6 +397,34 @@ void serviceTask(void* parameter) {
     }
 }
 
+/**
+ * This function implements the logWriterTask and moves the messages queued by 'LogFile.log()' to
+ * serial and, in batches, to the log file. This keeps the flash and the serial port out of the
+ * tasks that log.
+ * @param parameter Pointer to a parameter struct (unused for now)
+ * @note Runs whenever a message is queued and at least every LOG_WAKE_PERIOD ms
+ */
+void logWriterTask(void* parameter) {
+    log_d("Created logWriterTask on Core %d", xPortGetCoreID());
+    while(1) {
+        LogFile.persist(LOG_WAKE_PERIOD / portTICK_PERIOD_MS); // blocking wait for the next message
+    }
+}
+
+/**
+ * This function implements the storageTask and moves the sensor values queued by the measurement
+ * task into the data file. Writing to flash can take a while (e.g. erasing a sector or waiting for
+ * the sync task to release a file), so this is kept out of the measurement task.
+ * @param parameter Pointer to a parameter struct (unused for now)
+ * @note Runs whenever a sensor value is queued
+ */
+void storageTask(void* parameter) {
+    log_d("Created storageTask on Core %d", xPortGetCoreID());
+    while(1) {
+        DataFile.persist(portMAX_DELAY); // blocking wait for the next sensor value
+    }
+}
+
 /**
  * This function implements the measurementTask and periodically measures the sensor values.
  * It is implemented as a periodic loop with a period length defined by MEASUREMENT_PERIOD_SHORT
@@ -327,6 +437,11 @@ void measurementTask(void* parameter) {
     // Initalize Task:
     TickType_t xLastWakeTime = xTaskGetTickCount(); // initalize tick time
     uint32_t measurementLoopPeriod = MEASUREMENT_PERIOD_SHORT;
+    unsigned long lastWakeUp = 0; // start of the previous cycle in microseconds
+    unsigned long jitterMax = 0; // largest deviation from the period in microseconds
+    unsigned long jitterSum = 0;
+    unsigned long readMax = 0; // longest sensor read out in microseconds
+    size_t jitterCount = 0;
     
     // Periodic Loop:
     while (1) {
@@ -336,16 +451,38 @@ void measurementTask(void* parameter) {
         if(xResult == pdTRUE) { // check for new notification
             // Sanity Checks:
             log_d("Got notified about new measurement period: %u", notification_value);
-            if(MEASUREMENT_PERIOD_SHORT <= notification_value && notification_value <= MEASUREMENT_PERIOD_LONG) {
+            if(MEASUREMENT_PERIOD_SHORT <= notification_value && notification_value <= MEASUREMENT_PERIOD_MAX) {
                 measurementLoopPeriod = notification_value;
-                log_d("New measurement period: %u ms");
+                log_d("New measurement period: %u ms", measurementLoopPeriod);
+                lastWakeUp = 0; // period changed, skip measuring jitter once
             }
         }
         TickType_t xFrequency = measurementLoopPeriod / portTICK_PERIOD_MS;
         xTaskDelayUntil(&xLastWakeTime,xFrequency); // wait for the next cycle
 
+        // Measure Jitter:
+        unsigned long wakeUp = micros();
+        if(lastWakeUp != 0) {
+            long deviation = (long)(wakeUp - lastWakeUp) - (long)measurementLoopPeriod * 1000;
+            unsigned long jitter = deviation < 0 ? -deviation : deviation;
+            jitterMax = std::max(jitterMax, jitter);
+            jitterSum += jitter;
+            jitterCount++;
+        }
+        lastWakeUp = wakeUp;
+
         // Read Sensor Data:
         Sensors.read();
+        readMax = std::max(readMax, micros() - wakeUp);
+
+        // Report Jitter:
+        if(jitterCount >= JITTER_REPORT_PERIODS) {
+            log_i("Measurement jitter: avg %lu us, max %lu us (read out max %lu us)", jitterSum / jitterCount, jitterMax, readMax);
+            jitterMax = 0;
+            jitterSum = 0;
+            readMax = 0;
+            jitterCount = 0;
+        }
     }
 }
 
@@ -360,6 +497,7 @@ void measurementTask(void* parameter) {
  */
 void setup() {
     delay(1000); // wait for hardware on PCB to wake up
+    Serial.setTxBufferSize(SERIAL_TX_BUFFER_SIZE); // log lines are only printed if they fit, see 'Log::collect()'
     Serial.begin(BAUD_RATE);
 
     // Initalize Log File:
@@ -367,6 +505,7 @@ void setup() {
         log_e("Failed to initialize wlan module");
         return;
     }
+    xTaskCreate(logWriterTask,"logWriterTask",DEFAULT_STACK_SIZE,NULL,0,NULL); // priority 0, logging must not delay other tasks
     if(!Wlan.init()) {
         log_e("Failed to initialize wlan module");
         return;
@@ -383,8 +522,11 @@ void setup() {
 
     // Initalize Data File:
     if(!DataFile.begin()) {
-        LogFile.log(ERROR, "Failed to initialize data file");
+        LogFile.log(ERROR, LOG_DATA_FILE_INIT_FAILED);
     }
+#ifdef STORAGE_BENCHMARK
+    Storage.benchmark(); // before any task writes to the file systems
+#endif
     
     // Enable Button Handler:
     xTaskCreate(buttonHandlerTask, "buttonHandlerTask", DEFAULT_STACK_SIZE, NULL, 1, &buttonHandlerHandle);
@@ -413,17 +555,18 @@ void setup() {
 
     // Initialize Web Server User Interface:
     if(!UserInterface.enable()) {
-        LogFile.log(ERROR, "Failed to enable ui");
+        LogFile.log(ERROR, LOG_UI_ENABLE_FAILED);
         return;
     }
 
     // Create and Start Scheduled Tasks:
+    xTaskCreate(storageTask,"storageTask",DEFAULT_STACK_SIZE,NULL,0,NULL); // priority 0, writing to flash must not delay measurements
     xTaskCreate(measurementTask,"measurementTask",DEFAULT_STACK_SIZE,NULL,1,&measurementLoopHandle);
     xTaskCreate(serviceTask,"serviceTask",DEFAULT_STACK_SIZE,NULL,1,NULL);
     xTaskCreate(synchronizationTask,"synchronizationLoop",2*DEFAULT_STACK_SIZE,NULL,0,&syncLoopHandle); // priority 0 (same as idle task) to prevent idle task from starvation
 
     // Finish Setup:
-    LogFile.log(INFO, "Device setup.");
+    LogFile.log(INFO, LOG_DEVICE_SETUP);
     vTaskDelete(NULL); // delete this task to prevent busy idling in empty loop()
 }
 